@@ -0,0 +1,187 @@
+//   XPLAnalogScan.h - XPLPro Add-on Library, background analog sampling shared by analog add-ons
+//   Created by the XPLPro contributors,  2026
+//
+//   To report problems, download updates and examples, suggest enhancements or get technical support, please visit:
+//      discord:  https://discord.gg/gzXetjEST4
+//      patreon:  www.patreon.com/curiosityworkshop
+
+// analogRead() waits ~110us for every conversion on AVR.  Instead, every service() call picks up the
+// conversion started on the previous call and starts the next channel, round robin, so each call costs a
+// few microseconds no matter how many pots and selectors are connected.  Other boards do one analogRead()
+// per call.
+//
+// XPLLadderSwitches uses the shared XPLAnalog instance, XPLPotentiometers does when XPLPOTS_BACKGROUNDSCAN is 1.
+// On AVR the first sample is taken with analogRead(), so the ADC runs with whatever analogReference() the sketch
+// set before the first check(), and the reference bits are left alone after that.  If the sketch calls
+// analogRead() itself in between, the conversion it interrupted is thrown away and started again.
+
+
+#ifndef XPLAnalogScan_h
+#define XPLAnalogScan_h
+
+#ifndef XPLANALOGSCAN_MAXCHANNELS
+    #define XPLANALOGSCAN_MAXCHANNELS  16               // shared by all analog add-ons
+#endif
+
+#ifndef XPLANALOGSCAN_BACKGROUND
+    #ifdef __AVR__
+        #define XPLANALOGSCAN_BACKGROUND 1
+    #else
+        #define XPLANALOGSCAN_BACKGROUND 0
+    #endif
+#endif
+
+
+/// @brief Round robin analog sampler shared by the analog add-ons
+class XPLAnalogScan
+{
+public:
+    XPLAnalogScan(void);
+
+    /// @brief Add a pin to the scan, or find it if it is already scanned
+    /// @return Channel ID or -1 if full
+    int addChannel(uint8_t inPin);
+
+    /// @brief Latest value of a channel, or -1 if it hasn't been sampled yet
+    int read(int inChannel);
+
+    /// @brief Increments every time a new sample arrives for the channel (wraps)
+    uint8_t sampleCount(int inChannel);
+
+    /// @brief Pick up the finished conversion and start the next one.  Called by the add-ons' check(), safe to call more often.
+    void service(void);
+
+    void clear(void);
+
+private:
+
+  int _channelCount;
+  int _current;                 // channel being converted, or -1 if none
+  uint8_t _mux;                 // channel selection written to ADMUX for it, to notice analogRead() calls in between
+
+  void _start(int inChannel);
+
+  struct XPLAnalogChannel
+  {
+      uint8_t pin;
+      uint8_t count;            // sample counter
+      int value;                // latest value or -1
+  };
+
+  struct XPLAnalogChannel _channels[XPLANALOGSCAN_MAXCHANNELS];
+
+};
+
+
+XPLAnalogScan::XPLAnalogScan(void)
+{
+    clear();
+
+}
+
+void XPLAnalogScan::clear(void)
+{
+    _channelCount = 0;
+    _current = -1;
+
+}
+
+int XPLAnalogScan::addChannel(uint8_t inPin)
+{
+    for (int i = 0; i < _channelCount; i++) if (_channels[i].pin == inPin) return i;
+
+    if (_channelCount >= XPLANALOGSCAN_MAXCHANNELS) return -1;
+
+    _channels[_channelCount].pin = inPin;
+    _channels[_channelCount].count = 0;
+    _channels[_channelCount].value = -1;
+
+    return _channelCount++;
+
+}
+
+int XPLAnalogScan::read(int inChannel)
+{
+    if (inChannel < 0 || inChannel >= _channelCount) return -1;
+
+    return _channels[inChannel].value;
+
+}
+
+uint8_t XPLAnalogScan::sampleCount(int inChannel)
+{
+    if (inChannel < 0 || inChannel >= _channelCount) return 0;
+
+    return _channels[inChannel].count;
+
+}
+
+void XPLAnalogScan::_start(int inChannel)
+{
+    _current = inChannel;
+
+#if XPLANALOGSCAN_BACKGROUND
+    // same channel selection as analogRead() in the AVR core, without waiting for the result
+    uint8_t pin = _channels[inChannel].pin;
+
+#if defined(analogPinToChannel)
+#if defined(__AVR_ATmega32U4__)
+    if (pin >= 18) pin -= 18;
+#endif
+    pin = analogPinToChannel(pin);
+#elif defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
+    if (pin >= 54) pin -= 54;
+#else
+    if (pin >= 14) pin -= 14;
+#endif
+
+#if defined(ADCSRB) && defined(MUX5)
+    ADCSRB = (ADCSRB & ~(1 << MUX5)) | (((pin >> 3) & 0x01) << MUX5);
+#endif
+    _mux = pin & 0x07;
+    ADMUX = (ADMUX & 0xC0) | _mux;                  // keep the reference analogRead() set up, right adjusted result
+    ADCSRA |= (1 << ADSC);
+#endif
+
+}
+
+void XPLAnalogScan::service(void)
+{
+    if (_channelCount == 0) return;
+
+#if XPLANALOGSCAN_BACKGROUND
+    if (_current < 0)
+    {
+        // the core sets the ADC up with the sketch's analog reference on the first analogRead()
+        _channels[0].value = analogRead(_channels[0].pin);
+        _channels[0].count++;
+        _start(_channelCount > 1 ? 1 : 0);
+        return;
+    }
+
+    if (ADCSRA & (1 << ADSC)) return;             // still converting
+
+    if ((ADMUX & 0x1F) != _mux)                     // the sketch did an analogRead() meanwhile, this result is its pin
+    {
+        _start(_current);
+        return;
+    }
+
+    uint8_t low = ADCL;                             // ADCL must be read first
+    uint8_t high = ADCH;
+    _channels[_current].value = (high << 8) | low;
+    _channels[_current].count++;
+
+    _start(_current + 1 < _channelCount ? _current + 1 : 0);
+#else
+    int next = _current + 1 < _channelCount ? _current + 1 : 0;
+    _start(next);
+    _channels[next].value = analogRead(_channels[next].pin);
+    _channels[next].count++;
+#endif
+
+}
+
+XPLAnalogScan XPLAnalog;            // shared by all analog add-ons
+
+#endif
@@ -0,0 +1,213 @@
+//   XPLDMASerial.h - XPLPro Add-on Library to receive through a DMA circular buffer on STM32 boards
+//   Created by the XPLPro contributors,  2026
+//
+//   To report problems, download updates and examples, suggest enhancements or get technical support, please visit:
+//      discord:  https://discord.gg/gzXetjEST4
+//      patreon:  www.patreon.com/curiosityworkshop
+
+// The usual serial port takes an interrupt for every byte received, which at high baud rates or with long string
+// frames can't keep up.  Here the DMA controller writes received bytes into a circular buffer by itself and the
+// library takes them out in blocks when xloop() runs, so the CPU does nothing while bytes arrive.
+//
+// The UART and its receive DMA channel are set up by the sketch (STM32CubeMX generated code or HAL calls), with the
+// DMA channel in circular mode.  Transmit uses the same UART without DMA.
+//
+//      extern UART_HandleTypeDef huart2;          // set up by your code, RX DMA circular
+//      XPLDMASerial dmaSerial(&huart2);
+//      XPLPro XP(&dmaSerial);
+//
+//      void setup()
+//      {
+//          MX_DMA_Init();
+//          MX_USART2_UART_Init();                  // at the baud rate the plugin uses for this port
+//          dmaSerial.begin();
+//          XP.setBlockSource(&dmaSerial);
+//          XP.begin(...);
+//      }
+//
+// The buffer has to hold everything that arrives between two xloop() calls, at 2 Mbaud that is 200 bytes per ms.  If more
+// arrives the DMA overwrites bytes that weren't read yet:  when it has gone past the read position, what is left is
+// skipped and counted in overruns().  A whole lap more between two looks can't be told apart, so size the buffer to the
+// loop time rather than count on this.  A framing, noise, parity or overrun error on the line makes the HAL stop the DMA,
+// reception is started again the next time the library reads and counted in errors().  Either way the library drops the
+// frame it was receiving instead of handing on one with bytes missing.
+// Reception runs in receive-to-idle mode, so HAL_UARTEx_RxEventCallback is called when the line goes quiet after a
+// burst.  The library doesn't need it, it is there to wake a task if you have one.  On STM32H7 and F7 put the
+// buffer in memory the data cache doesn't cover, or the CPU reads stale bytes.  See XPLProDMASerialExample for the
+// UART and DMA setup on a Nucleo board without STM32CubeMX.
+
+#ifndef XPLDMASerial_h
+#define XPLDMASerial_h
+
+#ifndef ARDUINO_ARCH_STM32
+#error XPLDMASerial.h is for STM32 boards only
+#endif
+
+// Parameters around the interface
+#ifndef XPLDMA_BUFFERSIZE
+    #define XPLDMA_BUFFERSIZE       1024                // receive buffer, at least the largest frame the plugin sends
+#endif
+
+#define XPLDMA_TXTIMEOUT            100                 // ms to wait for the UART to take a frame
+
+
+/// @brief Core class for the XPLPro DMA Serial Addon
+class XPLDMASerial : public Stream, public XPLBlockSource
+{
+public:
+    /// @brief Constructor
+    /// @param huart UART with a receive DMA channel in circular mode, initialized before begin()
+    XPLDMASerial(UART_HandleTypeDef *huart);
+
+    /// @brief Start receiving
+    /// @return 0 if the HAL wouldn't start the DMA (not initialized, busy)
+    int begin(void);
+
+    int available(void);
+    int read(void);
+    int peek(void);
+    size_t write(uint8_t inByte);
+    size_t write(const uint8_t *inBuffer, size_t inSize);
+    using Print::write;
+    void flush(void) {}
+
+    int receiveBlock(const char **data);
+    void receiveDone(int count);
+    unsigned long receiveLosses(void) { return _overruns + _errors; }
+
+    /// @brief Times the DMA overwrote bytes that weren't read yet, more than the buffer arrived between two reads
+    unsigned long overruns(void) { return _overruns; }
+
+    /// @brief Times reception was started again after a line error stopped it
+    unsigned long errors(void) { return _errors; }
+
+private:
+    unsigned int _writePosition(void);
+    unsigned int _receivePosition(void);
+
+    UART_HandleTypeDef *_huart;
+    uint8_t _buffer[XPLDMA_BUFFERSIZE];
+    unsigned int _readPosition;
+    unsigned int _lastWritePosition;    // where the DMA was the last time we looked
+    bool _receiving;                    // begin() started the DMA once, keep it running
+    unsigned long _overruns;
+    unsigned long _errors;
+};
+
+
+XPLDMASerial::XPLDMASerial(UART_HandleTypeDef *huart)
+{
+    _huart = huart;
+    _readPosition = 0;
+    _lastWritePosition = 0;
+    _receiving = false;
+    _overruns = 0;
+    _errors = 0;
+}
+
+int XPLDMASerial::begin(void)
+{
+    _readPosition = 0;
+    _lastWritePosition = 0;
+
+    if (HAL_UARTEx_ReceiveToIdle_DMA(_huart, _buffer, XPLDMA_BUFFERSIZE) != HAL_OK) return 0;
+    __HAL_DMA_DISABLE_IT(_huart->hdmarx, DMA_IT_HT);        // no half transfer interrupts, we poll
+
+    _receiving = true;
+    return 1;
+}
+
+// where the DMA writes next, from the number of transfers it has left in this lap
+unsigned int XPLDMASerial::_writePosition(void)
+{
+    unsigned int position = XPLDMA_BUFFERSIZE - __HAL_DMA_GET_COUNTER(_huart->hdmarx);
+
+    return position >= XPLDMA_BUFFERSIZE ? 0 : position;
+}
+
+// the write position after restarting reception if a line error stopped it, and skipping bytes the DMA overwrote
+unsigned int XPLDMASerial::_receivePosition(void)
+{
+    if (_receiving && _huart->RxState != HAL_UART_STATE_BUSY_RX)    // the HAL aborted the DMA on an error
+    {
+        __HAL_UART_CLEAR_PEFLAG(_huart);
+        __HAL_UART_CLEAR_FEFLAG(_huart);
+        __HAL_UART_CLEAR_NEFLAG(_huart);
+        __HAL_UART_CLEAR_OREFLAG(_huart);
+        _huart->ErrorCode = HAL_UART_ERROR_NONE;
+
+        if (!begin()) return _readPosition;                 // nothing to read, try again next time
+        _errors++;
+    }
+
+    unsigned int writePosition = _writePosition();
+    unsigned int unread = (_lastWritePosition + XPLDMA_BUFFERSIZE - _readPosition) % XPLDMA_BUFFERSIZE;
+    unsigned int arrived = (writePosition + XPLDMA_BUFFERSIZE - _lastWritePosition) % XPLDMA_BUFFERSIZE;
+
+    // the DMA went past the read position since we last looked, everything not read yet may be overwritten
+    if (unread + arrived >= XPLDMA_BUFFERSIZE)
+    {
+        _readPosition = writePosition;
+        _overruns++;
+    }
+    _lastWritePosition = writePosition;
+
+    return writePosition;
+}
+
+int XPLDMASerial::available(void)
+{
+    unsigned int writePosition = _receivePosition();
+
+    if (writePosition >= _readPosition) return writePosition - _readPosition;
+    return XPLDMA_BUFFERSIZE - _readPosition + writePosition;
+}
+
+int XPLDMASerial::read(void)
+{
+    unsigned int writePosition = _receivePosition();        // first, it can move the read position
+
+    if (_readPosition == writePosition) return -1;
+
+    uint8_t value = _buffer[_readPosition];
+    if (++_readPosition >= XPLDMA_BUFFERSIZE) _readPosition = 0;
+    return value;
+}
+
+int XPLDMASerial::peek(void)
+{
+    unsigned int writePosition = _receivePosition();
+
+    if (_readPosition == writePosition) return -1;
+    return _buffer[_readPosition];
+}
+
+int XPLDMASerial::receiveBlock(const char **data)
+{
+    unsigned int writePosition = _receivePosition();
+
+    *data = (const char *)&_buffer[_readPosition];
+
+    // up to the end of the buffer when the DMA has wrapped around, the rest comes with the next call
+    if (writePosition >= _readPosition) return writePosition - _readPosition;
+    return XPLDMA_BUFFERSIZE - _readPosition;
+}
+
+void XPLDMASerial::receiveDone(int count)
+{
+    _readPosition += count;
+    if (_readPosition >= XPLDMA_BUFFERSIZE) _readPosition -= XPLDMA_BUFFERSIZE;
+}
+
+size_t XPLDMASerial::write(uint8_t inByte)
+{
+    return write(&inByte, 1);
+}
+
+size_t XPLDMASerial::write(const uint8_t *inBuffer, size_t inSize)
+{
+    if (HAL_UART_Transmit(_huart, (uint8_t *)inBuffer, inSize, XPLDMA_TXTIMEOUT) != HAL_OK) return 0;
+    return inSize;
+}
+
+#endif
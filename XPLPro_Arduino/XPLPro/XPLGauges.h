@@ -0,0 +1,485 @@
+//   XPLGauges.h - XPLPro Add-on Library for stepper and servo driven gauges
+//   Created by the XPLPro contributors,  2026
+//
+//   To report problems, download updates and examples, suggest enhancements or get technical support, please visit:
+//      discord:  https://discord.gg/gzXetjEST4
+//      patreon:  www.patreon.com/curiosityworkshop
+
+// Binds a dataref handle to a stepper (step/dir driver) or a servo.  Steppers follow an acceleration and
+// max speed profile so they don't lose steps, servos are slew limited so they don't jitter.  A calibration
+// table maps dataref values to positions for non-linear dials.
+//
+// check() recalculates targets and motion profiles within a fixed time budget, run it every loop.
+// run() generates the step pulses and never blocks, call it as often as possible or from a timer interrupt.
+//
+// Define XPLGAUGES_USE_SERVO 0 before including this file if you don't use servos or your board has no Servo library.
+
+
+#ifndef XPLGauges_h
+#define XPLGauges_h
+
+#include "XPLInterpolator.h"
+
+#ifndef XPLGAUGES_USE_SERVO
+    #define XPLGAUGES_USE_SERVO 1
+#endif
+
+#if XPLGAUGES_USE_SERVO
+    #include <Servo.h>
+#endif
+
+// Parameters around the interface
+#define XPLGAUGES_STEPPER           0
+#define XPLGAUGES_SERVO             1
+
+#define XPLGAUGES_TIMEBUDGET        500                 // default maximum time spent in check(), in microseconds
+#define XPLGAUGES_HOMINGSPEED       200                 // steps per second while homing
+#define XPLGAUGES_NOITEM            -1
+
+#ifndef XPLGAUGES_MAXGAUGES
+    #define XPLGAUGES_MAXGAUGES     6                   //Default to 6.
+#endif
+
+#ifndef XPLGAUGES_MAXCALPOINTS
+    #define XPLGAUGES_MAXCALPOINTS  8                   // calibration points per gauge
+#endif
+
+
+/// @brief Core class for the XPLPro Gauges Addon
+class XPLGauges
+{
+public:
+    /// @brief Constructor
+    XPLGauges(void);
+
+    /// <summary>
+    /// @brief begin
+    /// </summary>
+    /// <param name="xplpro"></param>
+    /// <param name="interpolator">optional, needed for gauges following interpolated updates</param>
+    void begin(XPLProBase *xplpro, XPLInterpolator *interpolator = NULL);
+
+    /// @brief Add a stepper gauge driven through a step/dir driver
+    /// @param inMaxSpeed maximum speed in steps per second
+    /// @param inAcceleration acceleration in steps per second per second
+    /// @return Gauge ID or -1 if full
+    int addStepper(int inHandle, int inElement, int inPinStep, int inPinDir, float inMaxSpeed, float inAcceleration);
+
+    /// @brief Add a servo gauge
+    /// @param inMaxSlew maximum change in microseconds of pulse width per second
+    /// @return Gauge ID or -1 if full
+    int addServo(int inHandle, int inElement, int inPin, float inMaxSlew);
+
+    /// @brief Add a calibration point, dataref value -> position (steps or servo microseconds).  Add in ascending value order.
+    ///        Without calibration points the dataref value is used as the position directly.
+    int addCalibration(int inGauge, float inValue, long inPosition);
+
+    /// @brief Follow an XPLInterpolator item instead of regular updates
+    void setInterpolated(int inGauge, int inItem);
+
+    /// @brief Start homing a stepper: move backwards until inPinHome reads LOW (or -1 for none) or inMaxSteps
+    ///        have been done (against a mechanical stop), then call that position zero.  Does not block.
+    void home(int inGauge, int inPinHome, long inMaxSteps);
+
+    /// @brief true while the gauge is homing
+    int isHoming(int inGauge);
+
+    /// @brief Pass every inbound update through here from the inbound handler
+    /// @return Gauge ID if the update was used, -1 otherwise
+    int inbound(inStruct *inData);
+
+    /// @brief Set a gauge to a dataref value directly
+    void setValue(int inGauge, float inValue);
+
+    void setTimeBudget(unsigned long inMicros);
+
+    /// @brief Update targets and motion profiles.  Run every loop.
+    void check(void);
+
+    /// @brief Generate step pulses.  Run as often as possible or from a timer interrupt.
+    void run(void);
+
+    void clear(void);
+
+private:
+
+    XPLProBase* _XP;
+    XPLInterpolator* _interpolator;
+
+  int _gaugeCount;                  // how many are registered
+  int _nextGauge;                   // where check() continues when it ran out of time last loop
+  unsigned long _timeBudget;        // in microseconds
+
+  long _calibrate(int inGauge, float inValue);
+  void _updateStepper(int inGauge, unsigned long inTimeNow);
+  void _updateServo(int inGauge, unsigned long inTimeNow);
+  void _setMotion(int inGauge, unsigned long inStepInterval, int inDirection);
+
+  struct XPLCalPoint
+  {
+      float value;
+      long  position;
+  };
+
+  struct XPLGauge
+  {
+      int type;                     // XPLGAUGES_STEPPER or XPLGAUGES_SERVO
+      int handle;                   // handle to dataref
+      int element;                  // if the dataref is an array, which element
+      int item;                     // XPLInterpolator item or XPLGAUGES_NOITEM
+      float value;                  // last dataref value
+      long target;                  // target position
+      unsigned long prevTime;       // time of last profile update (micros)
+
+      int calCount;
+      struct XPLCalPoint cal[XPLGAUGES_MAXCALPOINTS];
+
+      // stepper
+      int pinStep;
+      int pinDir;
+      int pinHome;
+      int homing;
+      long homingSteps;
+      float maxSpeed;
+      float acceleration;
+      float speed;                  // current speed, steps per second, signed
+      volatile long position;       // current position in steps, updated by run()
+      volatile unsigned long stepInterval;    // microseconds between steps or 0 if stopped, set by check()
+      volatile int direction;       // 1 or -1
+      unsigned long prevStep;       // time of last step (micros)
+
+      // servo
+      float maxSlew;
+      float servoPos;               // current pulse width in microseconds
+#if XPLGAUGES_USE_SERVO
+      Servo servo;
+#endif
+  };
+
+  struct XPLGauge _gauges[XPLGAUGES_MAXGAUGES];
+
+};
+
+
+XPLGauges::XPLGauges(void)
+{
+
+   _timeBudget = XPLGAUGES_TIMEBUDGET;
+   _interpolator = NULL;
+   _gaugeCount = 0;
+
+};
+
+void XPLGauges::begin(XPLProBase* xplpro, XPLInterpolator* interpolator)
+{
+    _XP = xplpro;
+    _interpolator = interpolator;
+    clear();
+
+}
+
+void XPLGauges::clear(void)           // call this prior to adding gauges if not the first run
+{
+    _gaugeCount = 0;
+    _nextGauge = 0;
+
+}
+
+void XPLGauges::setTimeBudget(unsigned long inMicros)
+{
+    _timeBudget = inMicros;
+}
+
+int XPLGauges::addStepper(int inHandle, int inElement, int inPinStep, int inPinDir, float inMaxSpeed, float inAcceleration)
+{
+    if (_gaugeCount >= XPLGAUGES_MAXGAUGES) return -1;
+
+    struct XPLGauge* g = &_gauges[_gaugeCount];
+
+    g->type = XPLGAUGES_STEPPER;
+    g->handle = inHandle;
+    g->element = inElement;
+    g->item = XPLGAUGES_NOITEM;
+    g->value = 0;
+    g->target = 0;
+    g->calCount = 0;
+    g->pinStep = inPinStep;
+    g->pinDir = inPinDir;
+    g->pinHome = -1;
+    g->homing = 0;
+    g->maxSpeed = inMaxSpeed;
+    g->acceleration = inAcceleration;
+    g->speed = 0;
+    g->position = 0;
+    _setMotion(_gaugeCount, 0, 1);
+    g->prevStep = micros();
+    g->prevTime = micros();
+
+    pinMode(inPinStep, OUTPUT);
+    pinMode(inPinDir, OUTPUT);
+    digitalWrite(inPinStep, LOW);
+    digitalWrite(inPinDir, HIGH);
+
+    return _gaugeCount++;
+
+}
+
+int XPLGauges::addServo(int inHandle, int inElement, int inPin, float inMaxSlew)
+{
+#if XPLGAUGES_USE_SERVO
+    if (_gaugeCount >= XPLGAUGES_MAXGAUGES) return -1;
+
+    struct XPLGauge* g = &_gauges[_gaugeCount];
+
+    g->type = XPLGAUGES_SERVO;
+    g->handle = inHandle;
+    g->element = inElement;
+    g->item = XPLGAUGES_NOITEM;
+    g->value = 0;
+    g->calCount = 0;
+    g->homing = 0;
+    _setMotion(_gaugeCount, 0, 1);
+    g->maxSlew = inMaxSlew;
+    g->servoPos = 1500;                   // center
+    g->target = 1500;
+    g->prevTime = micros();
+
+    g->servo.attach(inPin);
+    g->servo.writeMicroseconds(1500);
+
+    return _gaugeCount++;
+#else
+    return -1;
+#endif
+
+}
+
+int XPLGauges::addCalibration(int inGauge, float inValue, long inPosition)
+{
+    if (inGauge < 0 || inGauge >= _gaugeCount) return -1;
+    if (_gauges[inGauge].calCount >= XPLGAUGES_MAXCALPOINTS) return -1;
+
+    _gauges[inGauge].cal[_gauges[inGauge].calCount].value = inValue;
+    _gauges[inGauge].cal[_gauges[inGauge].calCount].position = inPosition;
+
+    return _gauges[inGauge].calCount++;
+
+}
+
+void XPLGauges::setInterpolated(int inGauge, int inItem)
+{
+    if (inGauge < 0 || inGauge >= _gaugeCount) return;
+
+    _gauges[inGauge].item = inItem;
+
+}
+
+void XPLGauges::home(int inGauge, int inPinHome, long inMaxSteps)
+{
+    if (inGauge < 0 || inGauge >= _gaugeCount) return;
+    if (_gauges[inGauge].type != XPLGAUGES_STEPPER) return;
+
+    _gauges[inGauge].pinHome = inPinHome;
+    if (inPinHome >= 0) pinMode(inPinHome, INPUT_PULLUP);
+
+    noInterrupts();
+    _gauges[inGauge].position = 0;
+    interrupts();
+
+    _gauges[inGauge].homingSteps = inMaxSteps;
+    _gauges[inGauge].speed = 0;
+    _gauges[inGauge].homing = 1;
+
+}
+
+int XPLGauges::isHoming(int inGauge)
+{
+    if (inGauge < 0 || inGauge >= _gaugeCount) return 0;
+
+    return _gauges[inGauge].homing;
+
+}
+
+int XPLGauges::inbound(inStruct *inData)
+{
+    int ret = -1;
+
+    if (_interpolator != NULL) _interpolator->inbound(inData);
+
+    for (int i = 0; i < _gaugeCount; i++)
+    {
+        if (_gauges[i].item != XPLGAUGES_NOITEM) continue;
+        if (_gauges[i].handle != inData->handle || _gauges[i].element != inData->element) continue;
+
+        setValue(i, inData->inFloat != 0 ? inData->inFloat : (float)inData->inLong);
+        ret = i;
+    }
+
+    return ret;
+
+}
+
+void XPLGauges::setValue(int inGauge, float inValue)
+{
+    if (inGauge < 0 || inGauge >= _gaugeCount) return;
+
+    _gauges[inGauge].value = inValue;
+    _gauges[inGauge].target = _calibrate(inGauge, inValue);
+
+}
+
+long XPLGauges::_calibrate(int inGauge, float inValue)
+{
+    struct XPLGauge* g = &_gauges[inGauge];
+
+    if (g->calCount == 0) return (long)inValue;
+    if (g->calCount == 1 || inValue <= g->cal[0].value) return g->cal[0].position;
+
+    for (int i = 1; i < g->calCount; i++)
+    {
+        if (inValue > g->cal[i].value) continue;
+
+        // linear interpolation between the two surrounding calibration points
+        return g->cal[i - 1].position + (long)((inValue - g->cal[i - 1].value) * (g->cal[i].position - g->cal[i - 1].position)
+                                                / (g->cal[i].value - g->cal[i - 1].value));
+    }
+
+    return g->cal[g->calCount - 1].position;
+
+}
+
+void XPLGauges::check(void)
+{
+    unsigned long timeStart = micros();
+
+    for (int n = 0; n < _gaugeCount; n++)
+    {
+        if (micros() - timeStart >= _timeBudget) return;     // out of time, continue here next loop
+
+        int i = _nextGauge;
+        if (++_nextGauge >= _gaugeCount) _nextGauge = 0;
+
+        if (_gauges[i].item != XPLGAUGES_NOITEM && _interpolator != NULL) setValue(i, _interpolator->getValue(_gauges[i].item));
+
+        if (_gauges[i].type == XPLGAUGES_STEPPER) _updateStepper(i, micros());
+        else                                      _updateServo(i, micros());
+    }
+
+}
+
+void XPLGauges::_updateStepper(int inGauge, unsigned long inTimeNow)
+{
+    struct XPLGauge* g = &_gauges[inGauge];
+    float dt = (inTimeNow - g->prevTime) / 1000000.0;
+    long position;
+    long target;
+
+    g->prevTime = inTimeNow;
+
+    noInterrupts();
+    position = g->position;
+    interrupts();
+
+    if (g->homing)
+    {
+        if ((g->pinHome >= 0 && digitalRead(g->pinHome) == LOW) || -position >= g->homingSteps)
+        {
+            g->speed = 0;
+            noInterrupts();
+            g->stepInterval = 0;
+            g->position = 0;
+            interrupts();
+            g->homing = 0;
+            return;
+        }
+
+        _setMotion(inGauge, 1000000L / XPLGAUGES_HOMINGSPEED, -1);
+        return;
+    }
+
+    target = g->target;
+    long distance = target - position;
+    float stopDistance = g->speed * g->speed / (2 * g->acceleration);         // steps needed to stop from current speed
+
+    if (distance == 0 && fabs(g->speed) < g->acceleration * dt + 1)
+    {
+        g->speed = 0;
+        _setMotion(inGauge, 0, g->direction);
+        return;
+    }
+
+    // decelerate when moving away from the target or when we need the remaining distance to stop, otherwise accelerate towards it
+    if ((g->speed > 0 && (distance <= 0 || stopDistance >= distance)) || (g->speed < 0 && (distance >= 0 || stopDistance >= -distance)))
+    {
+        if (g->speed > 0) g->speed = max(g->speed - g->acceleration * dt, 0.0f);
+        else              g->speed = min(g->speed + g->acceleration * dt, 0.0f);
+    }
+    else
+    {
+        if (distance > 0) g->speed = min(g->speed + g->acceleration * dt, g->maxSpeed);
+        else              g->speed = max(g->speed - g->acceleration * dt, -g->maxSpeed);
+    }
+
+    float speed = fabs(g->speed);
+    if (speed < 1)
+    {
+        // starting from standstill, first step at the speed reached after one step
+        speed = sqrt(2 * g->acceleration);
+        if (speed > g->maxSpeed) speed = g->maxSpeed;
+        g->speed = distance > 0 ? speed : -speed;
+    }
+
+    _setMotion(inGauge, (unsigned long)(1000000.0 / speed), g->speed > 0 ? 1 : -1);
+
+}
+
+// run() may be called from a timer interrupt and reads both, on 8 bit boards it could see half of a write
+void XPLGauges::_setMotion(int inGauge, unsigned long inStepInterval, int inDirection)
+{
+    noInterrupts();
+    _gauges[inGauge].stepInterval = inStepInterval;
+    _gauges[inGauge].direction = inDirection;
+    interrupts();
+
+}
+
+void XPLGauges::_updateServo(int inGauge, unsigned long inTimeNow)
+{
+#if XPLGAUGES_USE_SERVO
+    struct XPLGauge* g = &_gauges[inGauge];
+    float maxMove = g->maxSlew * (inTimeNow - g->prevTime) / 1000000.0;
+    float distance = g->target - g->servoPos;
+
+    g->prevTime = inTimeNow;
+
+    if (distance == 0) return;
+
+    if (distance > maxMove)       g->servoPos += maxMove;
+    else if (distance < -maxMove) g->servoPos -= maxMove;
+    else                          g->servoPos = g->target;
+
+    g->servo.writeMicroseconds((int)g->servoPos);
+#endif
+
+}
+
+void XPLGauges::run(void)
+{
+    unsigned long timeNow = micros();
+
+    for (int i = 0; i < _gaugeCount; i++)
+    {
+        struct XPLGauge* g = &_gauges[i];
+
+        if (g->stepInterval == 0 || timeNow - g->prevStep < g->stepInterval) continue;
+
+        digitalWrite(g->pinDir, g->direction > 0 ? HIGH : LOW);
+        digitalWrite(g->pinStep, HIGH);
+        g->prevStep = timeNow;
+        g->position += g->direction;
+        digitalWrite(g->pinStep, LOW);
+    }
+
+}
+
+#endif
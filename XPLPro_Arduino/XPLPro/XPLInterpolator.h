@@ -0,0 +1,165 @@
+//   XPLInterpolator.h - XPLPro Add-on Library for smooth gauges using value + rate (dead reckoning) updates
+//   Created by the XPLPro contributors,  2026
+//
+//   To report problems, download updates and examples, suggest enhancements or get technical support, please visit:
+//      discord:  https://discord.gg/gzXetjEST4
+//      patreon:  www.patreon.com/curiosityworkshop
+
+// The plugin sends a value together with its rate of change, and only sends again when extrapolating
+// would be off by more than the requested tolerance.  getValue() extrapolates locally every loop so
+// needles move smoothly with a fraction of the packets a regular subscription would need.
+
+
+#ifndef XPLInterpolator_h
+#define XPLInterpolator_h
+
+// Parameters around the interface
+#define XPLINTERPOLATOR_MAXEXTRAPOLATION  1000          // default: stop extrapolating after this many ms without an update (link lost, sim paused).
+                                                        // The plugin assumes this (XPL_DR_MAXEXTRAPOLATION) when it decides whether to send.
+
+#ifndef XPLINTERPOLATOR_MAXITEMS
+    #define XPLINTERPOLATOR_MAXITEMS     10             //Default to 10.
+#endif
+
+
+/// @brief Core class for the XPLPro Interpolator Addon
+class XPLInterpolator
+{
+public:
+    /// @brief Constructor
+    XPLInterpolator(void);
+
+    /// <summary>
+    /// @brief begin
+    /// </summary>
+    /// <param name="xplpro"></param>
+    void begin(XPLProBase *xplpro);
+
+    /// @brief Subscribe to value + rate updates.  Call from the registration callback after registering the dataref.
+    /// @return Item ID for getValue, or -1 if full
+    int addHandle(int inHandle, float inTolerance);
+    int addHandle(int inHandle, int inElement, float inTolerance);
+
+    /// @brief Pass every inbound update through here from the inbound handler
+    /// @return Item ID if the update belongs to an interpolated item, -1 otherwise
+    int inbound(inStruct *inData);
+
+    /// @brief Current extrapolated value
+    float getValue(int inItem);
+
+    /// @brief Last rate of change received, per second
+    float getRate(int inItem);
+
+    /// @brief Change how long values are extrapolated without an update, in ms.  The plugin assumes XPLINTERPOLATOR_MAXEXTRAPOLATION,
+    ///        shorter than that and a needle can stand still while the value is still moving.
+    void setMaxExtrapolation(unsigned long inTime);
+
+    void clear(void);
+
+private:
+
+    XPLProBase* _XP;
+
+  int _itemCount;                     // how many are registered
+  unsigned long _maxExtrapolation;    // in milliseconds
+
+
+  struct XPLInterpolatedItem
+  {
+      int handle;                   // handle to dataref
+      int element;                  // if the dataref is an array, which element
+      float value;                  // last value received
+      float rate;                   // last rate of change received, per second
+      unsigned long timeReceived;   // millis() when value arrived
+  };
+
+  struct XPLInterpolatedItem _items[XPLINTERPOLATOR_MAXITEMS];
+
+};
+
+
+XPLInterpolator::XPLInterpolator(void)
+{
+
+   _maxExtrapolation = XPLINTERPOLATOR_MAXEXTRAPOLATION;
+   _itemCount = 0;
+
+};
+
+void XPLInterpolator::begin(XPLProBase* xplpro)
+{
+    _XP = xplpro;
+    clear();
+
+}
+
+void XPLInterpolator::clear(void)           // call this prior to adding handles if not the first run
+{
+    _itemCount = 0;
+
+}
+
+void XPLInterpolator::setMaxExtrapolation(unsigned long inTime)
+{
+    _maxExtrapolation = inTime;
+}
+
+int XPLInterpolator::addHandle(int inHandle, float inTolerance)
+{
+    return addHandle(inHandle, 0, inTolerance);
+
+}
+
+int XPLInterpolator::addHandle(int inHandle, int inElement, float inTolerance)
+{
+    if (_itemCount >= XPLINTERPOLATOR_MAXITEMS || inHandle < 0) return -1;
+
+    _items[_itemCount].handle = inHandle;
+    _items[_itemCount].element = inElement;
+    _items[_itemCount].value = 0;
+    _items[_itemCount].rate = 0;
+    _items[_itemCount].timeReceived = millis();
+
+    _XP->requestInterpolatedUpdates(inHandle, 0, inTolerance, inElement);
+
+    return _itemCount++;
+
+
+}
+
+int XPLInterpolator::inbound(inStruct *inData)
+{
+    for (int i = 0; i < _itemCount; i++)
+    {
+        if (_items[i].handle != inData->handle || _items[i].element != inData->element) continue;
+
+        _items[i].value = inData->inFloat;
+        _items[i].rate = inData->inRate;
+        _items[i].timeReceived = millis();
+        return i;
+    }
+
+    return -1;
+
+}
+
+float XPLInterpolator::getValue(int inItem)
+{
+    if (inItem < 0 || inItem >= _itemCount) return 0;
+
+    unsigned long elapsed = millis() - _items[inItem].timeReceived;
+    if (elapsed > _maxExtrapolation) elapsed = _maxExtrapolation;
+
+    return _items[inItem].value + _items[inItem].rate * elapsed / 1000.0;
+
+}
+
+float XPLInterpolator::getRate(int inItem)
+{
+    if (inItem < 0 || inItem >= _itemCount) return 0;
+
+    return _items[inItem].rate;
+
+}
+
+#endif
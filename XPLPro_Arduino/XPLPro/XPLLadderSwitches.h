@@ -0,0 +1,267 @@
+//   XPLLadderSwitches.h - XPLPro Add-on Library for multi-position switches on a resistor ladder (one analog pin each)
+//   Created by the XPLPro contributors,  2026
+//
+//   To report problems, download updates and examples, suggest enhancements or get technical support, please visit:
+//      discord:  https://discord.gg/gzXetjEST4
+//      patreon:  www.patreon.com/curiosityworkshop
+
+// Rotary selectors (magnetos, nav source, lights) wired as a voltage divider give a different analog value for
+// every position.  Each position owns a window around its expected value, a new position has to be clear of
+// the window edge by the hysteresis and read the same for a few samples before it is accepted, so wipers
+// passing between contacts don't cause spurious writes.  Pins are sampled in the background by XPLAnalogScan.h.
+
+
+#ifndef XPLLadderSwitches_h
+#define XPLLadderSwitches_h
+
+#include "XPLAnalogScan.h"
+
+// Parameters around the interface
+#define XPLLADDER_SENDTOHANDLER   0                   // Default is to send position changes to the supplied handler.  This always occurs regardless.
+#define XPLLADDER_DATAREFWRITE    1                   // Write the position number (0 based) to the dataref
+#define XPLLADDER_COMMANDTRIGGER  2                   // Trigger the command set for the new position with setCommand
+
+#define XPLLADDER_HYSTERESIS      8                   // default ADC counts a reading has to be inside a position window
+#define XPLLADDER_SETTLECOUNT     3                   // consecutive samples in the same position before it is accepted
+#define XPLLADDER_ADCMAX          1023
+
+#ifndef XPLLADDER_MAXLADDERS
+    #define XPLLADDER_MAXLADDERS      6               //Default to 6.
+#endif
+
+#ifndef XPLLADDER_MAXPOSITIONS
+    #define XPLLADDER_MAXPOSITIONS    8               //Default to 8 positions per switch.
+#endif
+
+
+/// @brief Core class for the XPLPro Ladder Switches Addon
+class XPLLadderSwitches
+{
+public:
+    /// @brief Constructor
+    /// @param ladderHandler, Function called when a switch changes position, or NULL if not needed
+    XPLLadderSwitches(void (*ladderHandler)(int pin, int position));
+
+    /// <summary>
+    /// @brief begin
+    /// </summary>
+    /// <param name="xplpro"></param>
+    void begin(XPLProBase *xplpro);
+
+    /// @brief Add a switch with evenly spaced positions, position 0 reading 0 and the last reading full scale
+    /// @return Switch ID or -1 if full
+    int addPin(int inPin, int inMode, int inHandle, int inPositions);
+    int addPin(int inPin, int inMode, int inHandle, int inElement, int inPositions);
+
+    /// @brief Override the expected ADC reading for a position, for ladders that aren't evenly spaced
+    void setPosition(int inSwitch, int inPosition, int inValue);
+
+    /// @brief Command to trigger when the switch enters inPosition, for XPLLADDER_COMMANDTRIGGER
+    void setCommand(int inSwitch, int inPosition, int inHandle);
+
+    void setHysteresis(int inCounts);
+
+    /// @brief Current position or -1 if not known yet
+    int getPosition(int inSwitch);
+
+    int getHandle(int inPin);
+
+    /// @brief Check for position changes.  Run regularly
+    void check(void);
+
+    void clear(void);
+
+private:
+
+    XPLProBase* _XP;
+
+  int _ladderCount;             // how many are registered
+  int _hysteresis;
+
+  void (*_ladderHandler)(int inPin, int inPosition) = NULL;  // this function will be called when a switch changes position, if not NULL
+
+  int _decode(int inSwitch, int inValue);
+
+  struct XPLLadder
+  {
+      int arduinoPin;               // connected pin
+      int channel;                  // XPLAnalogScan channel
+      uint8_t prevSample;           // sample counter at last check
+      int8_t position;              // accepted position or -1
+      int8_t candidate;             // position being settled
+      uint8_t settle;               // samples the candidate has been seen
+      uint8_t positions;            // number of positions
+      uint8_t mode;
+      int handle;                   // handle to dataref
+      int element;                  // if the dataref is an array, which element
+      int value[XPLLADDER_MAXPOSITIONS];        // expected reading for each position
+      int command[XPLLADDER_MAXPOSITIONS];      // command handle for each position, XPLLADDER_COMMANDTRIGGER
+  };
+
+  struct XPLLadder _ladders[XPLLADDER_MAXLADDERS];
+
+};
+
+
+XPLLadderSwitches::XPLLadderSwitches(void (*ladderHandler)(int inPin, int inPosition))
+{
+
+   _ladderHandler = ladderHandler;
+   _hysteresis = XPLLADDER_HYSTERESIS;
+
+
+};
+
+void XPLLadderSwitches::begin(XPLProBase* xplpro)
+{
+    _XP = xplpro;
+    clear();
+
+}
+
+void XPLLadderSwitches::clear(void)           // call this prior to adding pins if not the first run
+{
+    _ladderCount = 0;
+
+}
+
+void XPLLadderSwitches::setHysteresis(int inCounts)
+{
+    _hysteresis = inCounts;
+}
+
+int XPLLadderSwitches::addPin(int inPin, int inMode, int inHandle, int inPositions)
+{
+    return addPin(inPin, inMode, inHandle, 0, inPositions);
+
+}
+
+int XPLLadderSwitches::addPin(int inPin, int inMode, int inHandle, int inElement, int inPositions)
+{
+    if (_ladderCount >= XPLLADDER_MAXLADDERS) return -1;
+    if (inPositions < 2 || inPositions > XPLLADDER_MAXPOSITIONS) return -1;
+
+    struct XPLLadder* l = &_ladders[_ladderCount];
+
+    l->arduinoPin = inPin;
+    l->channel = XPLAnalog.addChannel(inPin);
+    l->prevSample = XPLAnalog.sampleCount(l->channel);
+    l->position = -1;                         // This will force update to the plugin
+    l->candidate = -1;
+    l->settle = 0;
+    l->positions = inPositions;
+    l->mode = inMode;
+    l->handle = inHandle;
+    l->element = inElement;
+
+    for (int i = 0; i < inPositions; i++)
+    {
+        l->value[i] = (long)i * XPLLADDER_ADCMAX / (inPositions - 1);
+        l->command[i] = -1;
+    }
+
+    return _ladderCount++;
+
+}
+
+void XPLLadderSwitches::setPosition(int inSwitch, int inPosition, int inValue)
+{
+    if (inSwitch < 0 || inSwitch >= _ladderCount || inPosition < 0 || inPosition >= _ladders[inSwitch].positions) return;
+
+    _ladders[inSwitch].value[inPosition] = inValue;
+
+}
+
+void XPLLadderSwitches::setCommand(int inSwitch, int inPosition, int inHandle)
+{
+    if (inSwitch < 0 || inSwitch >= _ladderCount || inPosition < 0 || inPosition >= _ladders[inSwitch].positions) return;
+
+    _ladders[inSwitch].command[inPosition] = inHandle;
+
+}
+
+int XPLLadderSwitches::getPosition(int inSwitch)
+{
+    if (inSwitch < 0 || inSwitch >= _ladderCount) return -1;
+
+    return _ladders[inSwitch].position;
+
+}
+
+int XPLLadderSwitches::getHandle(int inPin)
+{
+    for (int i = 0; i < _ladderCount; i++) if (_ladders[i].arduinoPin == inPin) return _ladders[i].handle;
+    return -1;
+
+}
+
+int XPLLadderSwitches::_decode(int inSwitch, int inValue)
+{
+    struct XPLLadder* l = &_ladders[inSwitch];
+
+    for (int i = 0; i < l->positions; i++)
+    {
+        // window reaches halfway to the neighbouring positions, less the hysteresis
+        int low  = i > 0                ? (l->value[i - 1] + l->value[i]) / 2 + _hysteresis : -1;
+        int high = i < l->positions - 1 ? (l->value[i] + l->value[i + 1]) / 2 - _hysteresis : XPLLADDER_ADCMAX + 1;
+
+        if (inValue > low && inValue < high) return i;
+    }
+
+    return -1;          // in between positions
+
+}
+
+void XPLLadderSwitches::check(void)
+{
+
+  XPLAnalog.service();
+
+  for (int i = 0; i < _ladderCount; i++)
+  {
+      struct XPLLadder* l = &_ladders[i];
+
+      uint8_t sample = XPLAnalog.sampleCount(l->channel);
+      if (sample == l->prevSample) continue;            // nothing new
+      l->prevSample = sample;
+
+      int position = _decode(i, XPLAnalog.read(l->channel));
+
+      if (position < 0 || position == l->position)
+      {
+          l->candidate = -1;
+          continue;
+      }
+
+      if (position != l->candidate)
+      {
+          l->candidate = position;
+          l->settle = 1;
+          continue;
+      }
+
+      if (++l->settle < XPLLADDER_SETTLECOUNT) continue;
+
+      l->position = position;
+      l->candidate = -1;
+
+      switch (l->mode)
+      {
+
+      case XPLLADDER_DATAREFWRITE:
+          _XP->datarefWrite(l->handle, position, l->element);
+          break;
+
+      case XPLLADDER_COMMANDTRIGGER:
+          if (l->command[position] >= 0) _XP->commandTrigger(l->command[position]);
+          break;
+
+      }
+
+      if (_ladderHandler != NULL) _ladderHandler(l->arduinoPin, position);
+
+   }
+
+}
+
+#endif
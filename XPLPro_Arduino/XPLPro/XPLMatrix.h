@@ -0,0 +1,334 @@
+//   XPLMatrix.h - XPLPro Add-on Library for keypad matrices (CDU/FMC, transponder, radio pads)
+//   Created by the XPLPro contributors,  2026
+//
+//   To report problems, download updates and examples, suggest enhancements or get technical support, please visit:
+//      discord:  https://discord.gg/gzXetjEST4
+//      patreon:  www.patreon.com/curiosityworkshop
+
+// Rows are pulled LOW one at a time, columns are read with their pullups enabled.  On AVR the pins are
+// driven and read through the port registers directly and all columns of a row are debounced in parallel
+// (vertical counters), so a full 8x8 pass takes a few tens of microseconds.
+//
+// With a diode in series with every key any number of keys can be held at once (n-key rollover).  Without
+// diodes, changes that can't be told apart from ghost keys are held back until the ambiguity clears.
+
+
+#ifndef XPLMatrix_h
+#define XPLMatrix_h
+
+// Parameters around the interface
+#define XPLMATRIX_SENDTOHANDLER   0                   // Default is to send key events to the supplied handler.  This always occurs regardless.
+#define XPLMATRIX_DATAREFWRITE    1                   // Update dataref with key status
+#define XPLMATRIX_COMMANDTRIGGER  2                   // Trigger command when pressed
+#define XPLMATRIX_COMMANDSTARTEND 3                   // Start command when pressed, end command when released
+#define XPLMATRIX_DATAREFWRITE_INVERT 4               // same as datarefwrite but invert the signal
+
+#define XPLMATRIX_PRESSED      0
+#define XPLMATRIX_RELEASED     1
+
+#define XPLMATRIX_SCANINTERVAL 1000                   // microseconds between passes.  A key must be stable for 4 passes.
+#define XPLMATRIX_SETTLETIME   3                      // microseconds for the columns to settle after selecting a row
+
+#ifndef XPLMATRIX_MAXROWS
+    #define XPLMATRIX_MAXROWS     8
+#endif
+
+#ifndef XPLMATRIX_MAXCOLS
+    #define XPLMATRIX_MAXCOLS     8                   // up to 16
+#endif
+
+#ifndef XPLMATRIX_MAXKEYS
+    #define XPLMATRIX_MAXKEYS     64                  // keys bound to a dataref or command.  Costs ~7 bytes each.
+#endif
+
+#ifndef XPLMATRIX_DIRECTIO
+    #ifdef __AVR__
+        #define XPLMATRIX_DIRECTIO 1
+    #else
+        #define XPLMATRIX_DIRECTIO 0                  // other cores fall back to digitalRead / digitalWrite
+    #endif
+#endif
+
+#if XPLMATRIX_MAXCOLS > 8
+typedef uint16_t xplmatrix_row_t;
+#else
+typedef uint8_t xplmatrix_row_t;
+#endif
+
+
+/// @brief Core class for the XPLPro Matrix Addon
+class XPLMatrix
+{
+public:
+    /// @brief Constructor
+    /// @param keyHandler, Function called when a key changes, or NULL if not needed
+    XPLMatrix(void (*keyHandler)(int row, int col, int keyValue));
+
+    /// <summary>
+    /// @brief begin
+    /// </summary>
+    /// <param name="xplpro"></param>
+    /// <param name="rowPins">pins connected to the rows</param>
+    /// <param name="colPins">pins connected to the columns</param>
+    /// <param name="diodes">true if every key has a diode, enables n-key rollover</param>
+    void begin(XPLProBase *xplpro, const uint8_t *rowPins, uint8_t rowCount, const uint8_t *colPins, uint8_t colCount, bool diodes);
+
+    int addKey(uint8_t inRow, uint8_t inCol, uint8_t inMode, int inHandle);
+    int addKey(uint8_t inRow, uint8_t inCol, uint8_t inMode, int inHandle, int inElement);
+
+    int getHandle(uint8_t inRow, uint8_t inCol);
+
+    /// @brief XPLMATRIX_PRESSED or XPLMATRIX_RELEASED
+    int getKey(uint8_t inRow, uint8_t inCol);
+
+    /// @brief Scan the matrix and act on any changes.  Run regularly
+    void check(void);
+
+    void clear(void);
+
+private:
+
+    XPLProBase* _XP;
+
+  uint8_t _rowCount;
+  uint8_t _colCount;
+  bool _diodes;
+  int _keyCount;                // how many are bound
+  unsigned long _prevScan;
+
+  void (*_keyHandler)(int inRow, int inCol, int inValue) = NULL;  // this function will be called when a key changes, if not NULL
+
+  void _keyEvent(uint8_t inRow, uint8_t inCol, int inValue);
+  xplmatrix_row_t _readRow(uint8_t inRow);
+
+  uint8_t _rowPins[XPLMATRIX_MAXROWS];
+  uint8_t _colPins[XPLMATRIX_MAXCOLS];
+
+#if XPLMATRIX_DIRECTIO
+  volatile uint8_t* _rowOut[XPLMATRIX_MAXROWS];
+  volatile uint8_t* _rowMode[XPLMATRIX_MAXROWS];
+  uint8_t _rowMask[XPLMATRIX_MAXROWS];
+  volatile uint8_t* _colIn[XPLMATRIX_MAXCOLS];
+  uint8_t _colMask[XPLMATRIX_MAXCOLS];
+#endif
+
+  // debounced state (bit set = pressed) and two bit vertical counters, one bit per column
+  xplmatrix_row_t _state[XPLMATRIX_MAXROWS];
+  xplmatrix_row_t _cnt0[XPLMATRIX_MAXROWS];
+  xplmatrix_row_t _cnt1[XPLMATRIX_MAXROWS];
+
+  struct XPLKey
+  {
+      uint8_t row;
+      uint8_t col;
+      uint8_t mode;
+      int  handle;
+      int element;
+  };
+
+  struct XPLKey _keys[XPLMATRIX_MAXKEYS];
+
+};
+
+
+XPLMatrix::XPLMatrix(void (*keyHandler)(int inRow, int inCol, int inValue))
+{
+
+  _keyHandler = keyHandler;
+  _rowCount = 0;
+  _colCount = 0;
+
+};
+
+void XPLMatrix::begin(XPLProBase* xplpro, const uint8_t* rowPins, uint8_t rowCount, const uint8_t* colPins, uint8_t colCount, bool diodes)
+{
+    _XP = xplpro;
+    _diodes = diodes;
+    _rowCount = rowCount > XPLMATRIX_MAXROWS ? XPLMATRIX_MAXROWS : rowCount;
+    _colCount = colCount > XPLMATRIX_MAXCOLS ? XPLMATRIX_MAXCOLS : colCount;
+    _prevScan = micros();
+
+    for (uint8_t r = 0; r < _rowCount; r++)
+    {
+        _rowPins[r] = rowPins[r];
+        pinMode(_rowPins[r], INPUT_PULLUP);           // unselected rows float high
+        _state[r] = 0;
+        _cnt0[r] = 0;
+        _cnt1[r] = 0;
+#if XPLMATRIX_DIRECTIO
+        _rowOut[r]  = portOutputRegister(digitalPinToPort(_rowPins[r]));
+        _rowMode[r] = portModeRegister(digitalPinToPort(_rowPins[r]));
+        _rowMask[r] = digitalPinToBitMask(_rowPins[r]);
+#endif
+    }
+
+    for (uint8_t c = 0; c < _colCount; c++)
+    {
+        _colPins[c] = colPins[c];
+        pinMode(_colPins[c], INPUT_PULLUP);
+#if XPLMATRIX_DIRECTIO
+        _colIn[c]   = portInputRegister(digitalPinToPort(_colPins[c]));
+        _colMask[c] = digitalPinToBitMask(_colPins[c]);
+#endif
+    }
+
+    clear();
+
+}
+
+void XPLMatrix::clear(void)           // call this prior to adding keys if not the first run
+{
+    _keyCount = 0;
+
+}
+
+int XPLMatrix::addKey(uint8_t inRow, uint8_t inCol, uint8_t inMode, int inHandle)
+{
+    return addKey(inRow, inCol, inMode, inHandle, 0);
+
+}
+
+int XPLMatrix::addKey(uint8_t inRow, uint8_t inCol, uint8_t inMode, int inHandle, int inElement)
+{
+    if (_keyCount >= XPLMATRIX_MAXKEYS) return -1;
+    if (inRow >= _rowCount || inCol >= _colCount) return -1;
+
+    _keys[_keyCount].row = inRow;
+    _keys[_keyCount].col = inCol;
+    _keys[_keyCount].mode = inMode;
+    _keys[_keyCount].handle = inHandle;
+    _keys[_keyCount].element = inElement;
+
+    return _keyCount++;
+
+}
+
+int XPLMatrix::getHandle(uint8_t inRow, uint8_t inCol)
+{
+    for (int i = 0; i < _keyCount; i++) if (_keys[i].row == inRow && _keys[i].col == inCol) return _keys[i].handle;
+    return -1;
+
+}
+
+int XPLMatrix::getKey(uint8_t inRow, uint8_t inCol)
+{
+    if (inRow >= _rowCount || inCol >= _colCount) return XPLMATRIX_RELEASED;
+
+    return (_state[inRow] >> inCol) & 1 ? XPLMATRIX_PRESSED : XPLMATRIX_RELEASED;
+
+}
+
+xplmatrix_row_t XPLMatrix::_readRow(uint8_t inRow)
+{
+    xplmatrix_row_t sample = 0;
+
+#if XPLMATRIX_DIRECTIO
+    uint8_t oldSREG = SREG;                       // the port registers may be shared with pins touched from interrupts
+    cli();
+    *_rowOut[inRow]  &= ~_rowMask[inRow];         // pullup off, then drive low
+    *_rowMode[inRow] |= _rowMask[inRow];
+    SREG = oldSREG;
+
+    delayMicroseconds(XPLMATRIX_SETTLETIME);
+
+    for (uint8_t c = 0; c < _colCount; c++)
+        if (!(*_colIn[c] & _colMask[c])) sample |= (xplmatrix_row_t)1 << c;
+
+    oldSREG = SREG;
+    cli();
+    *_rowMode[inRow] &= ~_rowMask[inRow];         // back to input, then pullup on
+    *_rowOut[inRow]  |= _rowMask[inRow];
+    SREG = oldSREG;
+#else
+    pinMode(_rowPins[inRow], OUTPUT);
+    digitalWrite(_rowPins[inRow], LOW);
+
+    delayMicroseconds(XPLMATRIX_SETTLETIME);
+
+    for (uint8_t c = 0; c < _colCount; c++)
+        if (digitalRead(_colPins[c]) == LOW) sample |= (xplmatrix_row_t)1 << c;
+
+    pinMode(_rowPins[inRow], INPUT_PULLUP);
+#endif
+
+    return sample;
+
+}
+
+void XPLMatrix::check(void)
+{
+    xplmatrix_row_t newState[XPLMATRIX_MAXROWS];
+
+    unsigned long timeNow = micros();
+    if (timeNow - _prevScan < XPLMATRIX_SCANINTERVAL) return;
+    _prevScan = timeNow;
+
+    for (uint8_t r = 0; r < _rowCount; r++)
+    {
+        // vertical counter debounce: a column toggles once it differs from the debounced state for 4 passes in a row
+        xplmatrix_row_t delta = _readRow(r) ^ _state[r];
+        _cnt1[r] = (_cnt1[r] ^ _cnt0[r]) & delta;
+        _cnt0[r] = ~_cnt0[r] & delta;
+        newState[r] = _state[r] ^ (delta & ~(_cnt0[r] | _cnt1[r]));
+    }
+
+    if (!_diodes)
+    {
+        // without diodes, two rows sharing two or more pressed columns may contain a ghost key.  Hold those rows back.
+        for (uint8_t r = 0; r < _rowCount; r++)
+            for (uint8_t r2 = r + 1; r2 < _rowCount; r2++)
+            {
+                xplmatrix_row_t common = newState[r] & newState[r2];
+                if (common & (common - 1))
+                {
+                    newState[r] = _state[r];
+                    newState[r2] = _state[r2];
+                }
+            }
+    }
+
+    for (uint8_t r = 0; r < _rowCount; r++)
+    {
+        xplmatrix_row_t changed = newState[r] ^ _state[r];
+        _state[r] = newState[r];
+
+        for (uint8_t c = 0; changed; c++, changed >>= 1)
+            if (changed & 1) _keyEvent(r, c, (_state[r] >> c) & 1 ? XPLMATRIX_PRESSED : XPLMATRIX_RELEASED);
+    }
+
+}
+
+void XPLMatrix::_keyEvent(uint8_t inRow, uint8_t inCol, int inValue)
+{
+    for (int i = 0; i < _keyCount; i++)
+    {
+        if (_keys[i].row != inRow || _keys[i].col != inCol) continue;
+
+        switch (_keys[i].mode)
+        {
+
+        case XPLMATRIX_DATAREFWRITE:
+            _XP->datarefWrite(_keys[i].handle, inValue, _keys[i].element);
+            break;
+
+        case XPLMATRIX_DATAREFWRITE_INVERT:
+            _XP->datarefWrite(_keys[i].handle, !inValue, _keys[i].element);
+            break;
+
+        case XPLMATRIX_COMMANDTRIGGER:
+            if (inValue == XPLMATRIX_PRESSED) _XP->commandTrigger(_keys[i].handle);
+            break;
+
+        case XPLMATRIX_COMMANDSTARTEND:
+            if (inValue == XPLMATRIX_PRESSED)     _XP->commandStart(_keys[i].handle);
+            if (inValue == XPLMATRIX_RELEASED)    _XP->commandEnd(_keys[i].handle);
+            break;
+
+        }
+    }
+
+    if (_keyHandler != NULL) _keyHandler(inRow, inCol, inValue);
+
+}
+
+#endif
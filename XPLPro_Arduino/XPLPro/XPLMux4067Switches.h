@@ -35,7 +35,7 @@ public:
     /// @param muxHandler, function called when pin activity is detected, or NULL
     XPLMux4067Switches(uint8_t inPinSig, uint8_t inPinS0, uint8_t inPinS1, uint8_t inPinS2, uint8_t inPinS3, void (*muxHandler)(uint8_t muxChannel, uint8_t muxValue));
 
-    void begin(XPLPro* xplpro);
+    void begin(XPLProBase* xplpro);
 
     int8_t addPin(uint8_t inPin, uint8_t inMode, unsigned int inHandle);
 
@@ -49,7 +49,7 @@ public:
     
 private:
 
-  XPLPro* _XP;          
+  XPLProBase* _XP;          
   unsigned int _maxSwitches;
   unsigned int _switchCount;
 
@@ -93,7 +93,7 @@ XPLMux4067Switches::XPLMux4067Switches(uint8_t inPinSig, uint8_t inPinS0, uint8_
  
 };
 
-void XPLMux4067Switches::begin(XPLPro* xplpro)
+void XPLMux4067Switches::begin(XPLProBase* xplpro)
 {
     _XP = xplpro;
     clear();
@@ -5,6 +5,8 @@
 //      discord:  https://discord.gg/gzXetjEST4
 //      patreon:  www.patreon.com/curiosityworkshop
 
+// 18 October 2026 -- Pins can be sampled in the background through XPLAnalogScan.h instead of blocking on analogRead(),
+//                    define XPLPOTS_BACKGROUNDSCAN 1 before including this file
 // 22 March 2024 -- Small bug fix with addpin overload adding pincount twice
 // 15 March 2024 -- Added support for dataref arrays
 
@@ -13,6 +15,14 @@
 #ifndef XPLPotentiometers_h
 #define XPLPotentiometers_h
 
+#ifndef XPLPOTS_BACKGROUNDSCAN
+    #define XPLPOTS_BACKGROUNDSCAN  0               // 1 to sample in the background with XPLAnalogScan.h, 0 to use analogRead()
+#endif
+
+#if XPLPOTS_BACKGROUNDSCAN
+    #include "XPLAnalogScan.h"
+#endif
+
 // Parameters around the interface
 #define XPLPOTS_SENDTOHANDLER   0                   // Default is to send switch events to the supplied handler.  This always occurs regardless.
 #define XPLPOTS_DATAREFWRITE    1                   // Update dataref with switch status 
@@ -37,7 +47,7 @@ public:
     /// @brief begin
     /// </summary>
     /// <param name="xplpro"></param>
-    void begin(XPLPro *xplpro);
+    void begin(XPLProBase *xplpro);
 
     int addPin(int inPin, int inMode, int inHandle, int inPrecision, int inLow, int inHigh, int outLow, int outHigh);
     int addPin(int inPin, int inMode, int inHandle, int inElement, int inPrecision, int inLow, int inHigh, int outLow, int outHigh);
@@ -52,7 +62,7 @@ public:
     
 private:
  
-    XPLPro* _XP;
+    XPLProBase* _XP;
   
   int _potCount;             // how many are registered
   int _updateRate;              // in milliseconds
@@ -64,6 +74,9 @@ private:
   struct XPLPot
   {
       int arduinoPin;                // connected pin
+#if XPLPOTS_BACKGROUNDSCAN
+      int channel;                  // XPLAnalogScan channel
+#endif
       int prevValue;              //  last known value
       int handle;                  // handle to dataref
       int element;                  // if the dataref is an array, which element
@@ -87,7 +100,7 @@ XPLPotentiometers::XPLPotentiometers(void (*potHandler)(int inPotID, float inVal
 
 };
 
-void XPLPotentiometers::begin(XPLPro* xplpro)
+void XPLPotentiometers::begin(XPLProBase* xplpro)
 {
     _XP = xplpro;
     clear();
@@ -116,6 +129,9 @@ int XPLPotentiometers::addPin(int inPin, int inMode, int inHandle, int inElement
     if (_potCount >= XPLPOTS_MAXPOTS) return -1;
 
     _pots[_potCount].arduinoPin = inPin;
+#if XPLPOTS_BACKGROUNDSCAN
+    _pots[_potCount].channel = XPLAnalog.addChannel(inPin);
+#endif
     _pots[_potCount].precision = inPrecision;
     _pots[_potCount].mode = inMode;
     _pots[_potCount].handle = inHandle;
@@ -142,10 +158,18 @@ void XPLPotentiometers::check(void)
  
   unsigned long timeNow = millis();
 
+#if XPLPOTS_BACKGROUNDSCAN
+  XPLAnalog.service();
+#endif
  
   for (int i = 0; i < _potCount; i++)
   {
+#if XPLPOTS_BACKGROUNDSCAN
+      int pinValue = XPLAnalog.read(_pots[i].channel);
+      if (pinValue < 0) continue;                   // not sampled yet
+#else
       int pinValue = analogRead(_pots[i].arduinoPin);
+#endif
 
       if (_pots[i].precision)  pinValue = ((int)(pinValue / _pots[i].precision) * _pots[i].precision);
 
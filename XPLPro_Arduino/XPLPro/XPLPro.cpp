@@ -2,27 +2,78 @@
 // Created by Curiosity Workshop, Michael Gerlicher, 2023-2024.
 #include "XPLPro.h"
 
-XPLPro::XPLPro(Stream *device)
+// longest float Xdtostrf makes:  sign, 39 digits, point, decimals and the terminator
+#define XPL_NUMBERSIZE (42 + XPL_FLOATPRECISION)
+
+XPLProBase::XPLProBase(Stream *device, char *sendBuffer, int sendBufferSize, char *receiveBuffer, int receiveBufferSize)
 {
+    _sendBuffer = sendBuffer;
+    _sendBufferSize = sendBufferSize;
+    _receiveBuffer = receiveBuffer;
+    _receiveBufferSize = receiveBufferSize;
     _streamPtr = device;
     _streamPtr->setTimeout(XPL_RX_TIMEOUT);
+    _blockSource = NULL;
+    _blockLosses = 0;
 }
 
-void XPLPro::begin(const char *devicename, void (*initFunction)(void), void (*stopFunction)(void), void (*inboundHandler)(inStruct *))
+void XPLProBase::begin(const char *devicename, void (*initFunction)(void), void (*stopFunction)(void), void (*inboundHandler)(inStruct *))
 {
     _deviceName = (char *)devicename;
     _connectionStatus = 0;
+    _pluginVersion = 0;
+    _pluginFeatures = 0;
     _receiveBuffer[0] = 0;
+    _receiveBufferBytesReceived = 0;
+    _rawRemaining = 0;
+    _rawReceived = 0;
+#if XPL_STRINGBUFFERS
+    for (int i = 0; i < XPL_STRINGBUFFERS; i++) _strings[i].buffer = NULL;
+#endif
     _registerFlag = 0;
     _xplInitFunction = initFunction;
     _xplStopFunction = stopFunction;
     _xplInboundHandler = inboundHandler;
+    _xplCommandEventHandler = NULL;
+    _inData.gated = false;
+    _inData.decimals = -1;
+#if XPL_STATS
+    enableStats(0);
+#endif
+#if XPL_EVENTQUEUE_SIZE
+    _eventFirst = 0;
+    _eventCount = 0;
+    _dispatchBudget = XPL_EVENTQUEUE_SIZE;
+#endif
 }
 
-int XPLPro::xloop(void)
+int XPLProBase::xloop(void)
 {
+#if XPL_STATS
+    if (_stats.interval)
+    {
+        unsigned long now = micros();
+        unsigned long loopTime = now - _stats.lastLoop;
+        _stats.lastLoop = now;
+        _stats.loops++;
+        _stats.loopSum += loopTime;
+        if (loopTime > _stats.loopMax) _stats.loopMax = loopTime;
+
+        if (millis() - _stats.lastReport >= _stats.interval && _connectionStatus) _sendStats();
+    }
+#endif
     // handle incoming serial data
+#if XPL_EVENTQUEUE_SIZE
+    // take in what is waiting before running any handlers, so a slow handler doesn't let the receive buffer overrun.
+    // Once the queue is full the rest stays in the stream until dispatch() makes room.
+    for (int i = 0; i < XPL_EVENTQUEUE_SIZE && _eventCount < XPL_EVENTQUEUE_SIZE && _streamPtr->available(); i++) _processSerial();
+#if XPL_STATS
+    if (_eventCount >= XPL_EVENTQUEUE_SIZE && _streamPtr->available()) _stats.queueFull++;
+#endif
+    if (_dispatchBudget) dispatch(_dispatchBudget);
+#else
     _processSerial();
+#endif
     // when device is registered, perform handle registrations
     if (_registerFlag)
     {
@@ -34,18 +85,17 @@ int XPLPro::xloop(void)
 }
 
 // TODO: is a return value necessary? These could also be void like for the datarefs
-int XPLPro::commandTrigger(cmd_handle commandHandle, int triggerCount)
+int XPLProBase::commandTrigger(cmd_handle commandHandle, int triggerCount)
 {
     if (commandHandle < 0)
     {
         return XPL_HANDLE_INVALID;
     }
-    sprintf(_sendBuffer, "%c%c,%i,%i%c", XPL_PACKETHEADER, XPLCMD_COMMANDTRIGGER, commandHandle, triggerCount, XPL_PACKETTRAILER);
-    _transmitPacket();
+    _transmitPacket(snprintf(_sendBuffer, _sendBufferSize, "%c%c,%i,%i%c", XPL_PACKETHEADER, XPLCMD_COMMANDTRIGGER, commandHandle, triggerCount, XPL_PACKETTRAILER));
     return 0;
 }
 
-int XPLPro::commandStart(cmd_handle commandHandle)
+int XPLProBase::commandStart(cmd_handle commandHandle)
 {
     if (commandHandle < 0)
     {
@@ -55,7 +105,7 @@ int XPLPro::commandStart(cmd_handle commandHandle)
     return 0;
 }
 
-int XPLPro::commandEnd(cmd_handle commandHandle)
+int XPLProBase::commandEnd(cmd_handle commandHandle)
 {
     if (commandHandle < 0)
     {
@@ -65,117 +115,176 @@ int XPLPro::commandEnd(cmd_handle commandHandle)
     return 0;
 }
 
-int XPLPro::connectionStatus()
+int XPLProBase::requestCommandEvents(cmd_handle commandHandle)
+{
+    if (commandHandle < 0)
+    {
+        return XPL_HANDLE_INVALID;
+    }
+    if (!hasFeature(XPLFEATURE_COMMANDEVENTS)) return -2;      // older plugin, it wouldn't know the request
+
+    _sendPacketVoid(XPLREQUEST_COMMANDEVENTS, commandHandle);
+    return 0;
+}
+
+int XPLProBase::connectionStatus()
 {
     return _connectionStatus;
 }
 
-int XPLPro::sendDebugMessage(const char *msg)
+int XPLProBase::pluginVersion()
+{
+    return _pluginVersion;
+}
+
+int XPLProBase::hasFeature(unsigned long feature)
+{
+    return (_pluginFeatures & feature) == feature;
+}
+
+int XPLProBase::sendDebugMessage(const char *msg)
 {
     _sendPacketString(XPLCMD_PRINTDEBUG, msg);
     return 1;
 }
 
-int XPLPro::sendSpeakMessage(const char *msg)
+int XPLProBase::sendSpeakMessage(const char *msg)
 {
     _sendPacketString(XPLCMD_SPEAK, msg);
     return 1;
 }
 
-void XPLPro::flightLoopPause(void)              // experimental!  Do not use!
+void XPLProBase::flightLoopPause(void)              // plugin holds back updates to this device until flightLoopResume
 {
     _sendPacketVoid(XPLCMD_FLIGHTLOOPPAUSE, 0);
 
 }
 
-void XPLPro::flightLoopResume(void)
+void XPLProBase::flightLoopResume(void)
 {
     _sendPacketVoid(XPLCMD_FLIGHTLOOPRESUME, 0);
 }
 
+void XPLProBase::enableStats(unsigned long interval)
+{
+#if XPL_STATS
+    memset(&_stats, 0, sizeof(_stats));
+    _stats.interval = interval;
+    _stats.lastReport = millis();
+    _stats.lastLoop = micros();
+#endif
+}
+
+#if XPL_STATS
+void XPLProBase::_sendStats()
+{
+    _transmitPacket(snprintf(_sendBuffer, _sendBufferSize, "%c%c,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu%c",
+        XPL_PACKETHEADER,
+        XPLCMD_DEVICESTATS,
+        _stats.loops,
+        _stats.loops ? _stats.loopSum / _stats.loops : 0,
+        _stats.loopMax,
+        _stats.rxWait,
+        _stats.callback,
+        _stats.rxDropped,
+        _stats.framesTx + 1,        // including this one
+        _stats.framesRx,
+        _stats.queueFull,
+        XPL_PACKETTRAILER));
+
+    // start the next interval
+    unsigned long interval = _stats.interval;
+    enableStats(interval);
+}
+#endif
+
 // these could be done better:
 
-void XPLPro::datarefWrite(dref_handle handle, int value)
+void XPLProBase::datarefWrite(dref_handle handle, int value)
 {
     if (handle < 0)
     {
         return;
     }
-    sprintf(_sendBuffer, "%c%c,%i,%i%c", XPL_PACKETHEADER, XPLCMD_DATAREFUPDATEINT, handle, value, XPL_PACKETTRAILER);
-    _transmitPacket();
+    _transmitPacket(snprintf(_sendBuffer, _sendBufferSize, "%c%c,%i,%i%c", XPL_PACKETHEADER, XPLCMD_DATAREFUPDATEINT, handle, value, XPL_PACKETTRAILER));
 }
 
-void XPLPro::datarefWrite(dref_handle handle, int value, int arrayElement)
+void XPLProBase::datarefWrite(dref_handle handle, int value, int arrayElement)
 {
     if (handle < 0)
     {
         return;
     }
-    sprintf(_sendBuffer, "%c%c,%i,%i,%i%c", XPL_PACKETHEADER, XPLCMD_DATAREFUPDATEINTARRAY, handle, value, arrayElement, XPL_PACKETTRAILER);
-    _transmitPacket();
+    _transmitPacket(snprintf(_sendBuffer, _sendBufferSize, "%c%c,%i,%i,%i%c", XPL_PACKETHEADER, XPLCMD_DATAREFUPDATEINTARRAY, handle, value, arrayElement, XPL_PACKETTRAILER));
 }
 
-void XPLPro::datarefWrite(dref_handle handle, long value)
+void XPLProBase::datarefWrite(dref_handle handle, long value)
 {
     if (handle < 0)
     {
         return;
     }
-    sprintf(_sendBuffer, "%c%c,%i,%ld%c", XPL_PACKETHEADER, XPLCMD_DATAREFUPDATEINT, handle, value, XPL_PACKETTRAILER);
-    _transmitPacket();
+    _transmitPacket(snprintf(_sendBuffer, _sendBufferSize, "%c%c,%i,%ld%c", XPL_PACKETHEADER, XPLCMD_DATAREFUPDATEINT, handle, value, XPL_PACKETTRAILER));
 }
 
-void XPLPro::datarefWrite(dref_handle handle, long value, int arrayElement)
+void XPLProBase::datarefWrite(dref_handle handle, long value, int arrayElement)
 {
     if (handle < 0)
     {
         return;
     }
-    sprintf(_sendBuffer, "%c%c,%i,%ld,%i%c", XPL_PACKETHEADER, XPLCMD_DATAREFUPDATEINTARRAY, handle, value, arrayElement, XPL_PACKETTRAILER);
-    _transmitPacket();
+    _transmitPacket(snprintf(_sendBuffer, _sendBufferSize, "%c%c,%i,%ld,%i%c", XPL_PACKETHEADER, XPLCMD_DATAREFUPDATEINTARRAY, handle, value, arrayElement, XPL_PACKETTRAILER));
 }
 
-void XPLPro::datarefWrite(dref_handle handle, float value)
+void XPLProBase::datarefWrite(dref_handle handle, float value)
 {
     if (handle < 0) return;
 
-    char* s = _sendBuffer;
-    s += sprintf(_sendBuffer, "%c%c,%i,",
+    char number[XPL_NUMBERSIZE];
+    Xdtostrf(value, 0, XPL_FLOATPRECISION, number);
+    _transmitPacket(snprintf(_sendBuffer, _sendBufferSize, "%c%c,%i,%s%c",
         XPL_PACKETHEADER,
         XPLCMD_DATAREFUPDATEFLOAT,
-        handle);
-    s += Xdtostrf(value, 0, XPL_FLOATPRECISION, s);
-    sprintf(s, "%c",
-        XPL_PACKETTRAILER);
-    _transmitPacket();
+        handle,
+        number,
+        XPL_PACKETTRAILER));
 }
 
-void XPLPro::datarefWrite(dref_handle handle, float value, int arrayElement)
+void XPLProBase::datarefWrite(dref_handle handle, float value, int arrayElement)
 {
     if (handle < 0) return;
 
-    char* s = _sendBuffer;
-    s += sprintf(_sendBuffer, "%c%c,%i,",
+    char number[XPL_NUMBERSIZE];
+    Xdtostrf(value, 0, XPL_FLOATPRECISION, number);
+    _transmitPacket(snprintf(_sendBuffer, _sendBufferSize, "%c%c,%i,%s,%i%c",
         XPL_PACKETHEADER,
         XPLCMD_DATAREFUPDATEFLOATARRAY,
-        handle);
-    s += Xdtostrf(value, 0, XPL_FLOATPRECISION, s);
-    sprintf(s, ",%i%c",
+        handle,
+        number,
         arrayElement,
-        XPL_PACKETTRAILER);
+        XPL_PACKETTRAILER));
+}
+
+void XPLProBase::datarefWriteFixed(dref_handle handle, long value, int decimals)
+{
+    datarefWriteFixed(handle, value, decimals, 0);
+}
 
-    _transmitPacket();
+void XPLProBase::datarefWriteFixed(dref_handle handle, long value, int decimals, int arrayElement)
+{
+    if (handle < 0) return;
+
+    _transmitPacket(snprintf(_sendBuffer, _sendBufferSize, "%c%c,%i,%ld,%i,%i%c", XPL_PACKETHEADER, XPLCMD_DATAREFUPDATEFIXED, handle, value, decimals, arrayElement, XPL_PACKETTRAILER));
 }
 
-void XPLPro::datarefTouch(dref_handle handle)
+void XPLProBase::datarefTouch(dref_handle handle)
 {
     if (handle < 0)   return;
    
-    sprintf(_sendBuffer, "%c%c,%i%c", XPL_PACKETHEADER, XPLREQUEST_DATAREFTOUCH, handle, XPL_PACKETTRAILER);
-    _transmitPacket();
+    _transmitPacket(snprintf(_sendBuffer, _sendBufferSize, "%c%c,%i%c", XPL_PACKETHEADER, XPLREQUEST_DATAREFTOUCH, handle, XPL_PACKETTRAILER));
 }
 
-void XPLPro::_sendname()
+void XPLProBase::_sendname()
 {
     // register device on request only when we have a valid name
     if (_deviceName != NULL)
@@ -184,7 +293,7 @@ void XPLPro::_sendname()
     }
 }
 
-void XPLPro::_sendVersion()
+void XPLProBase::_sendVersion()
 {
     // register device on request only when we have a valid name
     if (_deviceName != NULL)
@@ -195,7 +304,21 @@ void XPLPro::_sendVersion()
     }
 }
 
-void XPLPro::sendResetRequest()
+void XPLProBase::_sendCapabilities()
+{
+    _transmitPacket(snprintf(_sendBuffer, _sendBufferSize, "%c%c,%i,%lu%c", XPL_PACKETHEADER, XPLRESPONSE_CAPABILITIES, XPL_PROTOCOL_VERSION, (unsigned long)XPL_FEATURES, XPL_PACKETTRAILER));
+}
+
+void XPLProBase::_sendFrameSize()
+{
+    // tell the plugin how big our buffers are, it defaults to 200 when this isn't sent
+    if (_deviceName != NULL)
+    {
+        _transmitPacket(snprintf(_sendBuffer, _sendBufferSize, "%c%c,%i,%i%c", XPL_PACKETHEADER, XPLRESPONSE_FRAMESIZE, _receiveBufferSize, _sendBufferSize, XPL_PACKETTRAILER));
+    }
+}
+
+void XPLProBase::sendResetRequest()
 {
     // request a reset only when we have a valid name
     if (_deviceName != NULL)
@@ -204,41 +327,216 @@ void XPLPro::sendResetRequest()
     }
 }
 
-void XPLPro::_processSerial()
+void XPLProBase::setBlockSource(XPLBlockSource *source)
 {
-    // read until package header found or buffer empty
-    while (_streamPtr->available() && _receiveBuffer[0] != XPL_PACKETHEADER)
+    _blockSource = source;
+    _blockLosses = source ? source->receiveLosses() : 0;
+}
+
+void XPLProBase::_processSerial()
+{
+    int frameDone = 0;
+#if XPL_STATS
+    unsigned long startTime = _stats.interval ? micros() : 0;
+#endif
+    // the rest of a started frame never came, start over with the next header
+    if ((_receiveBufferBytesReceived || _rawRemaining) && millis() - _frameStartTime > XPL_RX_TIMEOUT)
     {
-        _receiveBuffer[0] = (char)_streamPtr->read();
+#if XPL_STATS
+        _stats.rxDropped += _receiveBufferBytesReceived + _rawReceived;
+#endif
+        _receiveBufferBytesReceived = 0;
+        _rawRemaining = 0;
     }
-    // return when buffer empty and header not found
-    if (_receiveBuffer[0] != XPL_PACKETHEADER)
+    // take in what is waiting, up to the end of one frame
+    if (_blockSource)
     {
-        return;
+        const char *data;
+        int count;
+        while (!frameDone && (count = _blockSource->receiveBlock(&data)) > 0)
+        {
+            // bytes went missing before this block, what came of the frame being received doesn't belong to it
+            if (_blockSource->receiveLosses() != _blockLosses)
+            {
+                _blockLosses = _blockSource->receiveLosses();
+#if XPL_STATS
+                _stats.rxDropped += _receiveBufferBytesReceived + (_rawRemaining ? _rawReceived : 0);
+#endif
+                _receiveBufferBytesReceived = 0;
+                _rawRemaining = 0;
+            }
+            _blockSource->receiveDone(_receiveBytes(data, count, &frameDone));
+        }
     }
-    // read rest of package until trailer
-    _receiveBufferBytesReceived = _streamPtr->readBytesUntil(XPL_PACKETTRAILER, (char *)&_receiveBuffer[1], XPLMAX_PACKETSIZE_RECEIVE - 1);
-    // if no further chars available, delete package
-    if (_receiveBufferBytesReceived == 0)
+    else
     {
-        _receiveBuffer[0] = 0;
-        return;
+        while (!frameDone && _streamPtr->available() > 0)
+        {
+            char c = (char)_streamPtr->read();
+            _receiveBytes(&c, 1, &frameDone);
+        }
+    }
+#if XPL_STATS
+    if (_stats.interval) _stats.rxWait += micros() - startTime;
+#endif
+}
+
+// Framer, never waits for bytes that haven't arrived.  Stops after the end of a frame and returns the number of bytes used.
+int XPLProBase::_receiveBytes(const char *data, int count, int *frameDone)
+{
+    int i = 0;
+
+    while (i < count)
+    {
+        char c = data[i++];
+
+        // raw bytes after a string frame
+        if (_rawRemaining)
+        {
+            if (_rawReceived < _rawCapacity) _rawTarget[_rawReceived++] = c;
+            if (--_rawRemaining == 0)
+            {
+                _finishRaw();
+                *frameDone = 1;
+                return i;
+            }
+            continue;
+        }
+
+        // skip anything between frames
+        if (_receiveBufferBytesReceived == 0)
+        {
+            if (c != XPL_PACKETHEADER)
+            {
+#if XPL_STATS
+                _stats.rxDropped++;
+#endif
+                continue;
+            }
+            _frameStartTime = millis();
+        }
+
+        // frame doesn't fit with its terminator, drop it
+        if (_receiveBufferBytesReceived >= _receiveBufferSize - 1)
+        {
+#if XPL_STATS
+            _stats.rxDropped += _receiveBufferBytesReceived + 1;
+#endif
+            _receiveBufferBytesReceived = 0;
+            continue;
+        }
+
+        _receiveBuffer[_receiveBufferBytesReceived++] = c;
+
+        if (c == XPL_PACKETTRAILER)
+        {
+            _receiveBuffer[_receiveBufferBytesReceived] = 0; // old habits die hard.
+            _receiveBufferBytesReceived = 0;
+            _processPacket();
+            if (!_rawRemaining)
+            {
+                *frameDone = 1;
+                return i;
+            }
+        }
+    }
+
+    return i;
+}
+
+// String frames are followed by length raw bytes, the framer collects them, into the sketch's buffer if it registered one
+void XPLProBase::_receiveRaw(int length)
+{
+    _rawTarget = _receiveBuffer;
+    _rawCapacity = _receiveBufferSize;
+#if XPL_STRINGBUFFERS
+    int offset = _inData.strOffset < 0 ? 0 : _inData.strOffset;
+
+    _rawString = NULL;
+    for (int i = 0; i < XPL_STRINGBUFFERS; i++)
+    {
+        if (_strings[i].buffer == NULL || _strings[i].handle != _inData.handle) continue;
+
+        _rawString = &_strings[i];
+        _rawTarget = &_strings[i].buffer[offset];
+        _rawCapacity = _strings[i].size - 1 - offset;       // room for the terminator
+        if (_rawCapacity < 0) _rawCapacity = 0;
+        break;
+    }
+#endif
+    _rawReceived = 0;
+    _rawRemaining = length;
+    _frameStartTime = millis();
+    if (length <= 0)
+    {
+        _rawRemaining = 0;
+        _finishRaw();
+    }
+}
+
+void XPLProBase::_finishRaw()
+{
+    _inData.strLength = _rawReceived;
+    _inData.inStr = _rawTarget;
+#if XPL_STRINGBUFFERS
+    if (_rawString != NULL)
+    {
+        // the sketch's buffer holds the whole string now, patch or not
+        if (_inData.strOffset < 0) _rawString->buffer[_rawReceived] = 0;
+        _inData.inStr = _rawString->buffer;
+        _inData.strLength = strlen(_rawString->buffer);
+        _inData.strOffset = -1;
+        _rawString->updated = true;
     }
-    // add package trailer and zero byte to frame
-    _receiveBuffer[++_receiveBufferBytesReceived] = XPL_PACKETTRAILER;
-    _receiveBuffer[++_receiveBufferBytesReceived] = 0; // old habits die hard.
-    // at this point we should have a valid frame
-    _processPacket();
+#endif
+#if XPL_EVENTQUEUE_SIZE
+    _dropEvents(_inData.handle);        // a queued gated marker for the string must not run after it
+#endif
+    _runInboundHandler(&_inData);       // strings are in the receive buffer, they can't wait in the queue
 }
 
-int XPLPro::_receiveNSerial(int inSize)
+#if XPL_STRINGBUFFERS
+int XPLProBase::registerStringBuffer(dref_handle handle, char *buffer, int bufferSize)
 {
-    if (inSize > XPLMAX_PACKETSIZE_RECEIVE) inSize = XPLMAX_PACKETSIZE_RECEIVE;
+    int slot = -1;
+
+    if (handle < 0 || buffer == NULL || bufferSize < 1) return XPL_HANDLE_INVALID;
+
+    for (int i = 0; i < XPL_STRINGBUFFERS; i++)
+    {
+        if (_strings[i].buffer != NULL && _strings[i].handle == handle) { slot = i; break; }      // replace
+        if (_strings[i].buffer == NULL && slot < 0) slot = i;
+    }
+    if (slot < 0) return -1;
 
-    return Serial.readBytes(_receiveBuffer, inSize);
+    buffer[0] = 0;
+    _strings[slot].handle = handle;
+    _strings[slot].buffer = buffer;
+    _strings[slot].size = bufferSize;
+    _strings[slot].updated = false;
+
+    // strings for this dataref don't go through the receive buffer, the plugin sends them up to the size of this one
+    if (hasFeature(XPLFEATURE_FRAMESIZE))
+        _transmitPacket(snprintf(_sendBuffer, _sendBufferSize, "%c%c,%i,%i%c", XPL_PACKETHEADER, XPLREQUEST_STRINGSIZE, handle, bufferSize, XPL_PACKETTRAILER));
+
+    return 0;
 }
 
-void XPLPro::_processPacket()
+bool XPLProBase::stringUpdated(dref_handle handle)
+{
+    for (int i = 0; i < XPL_STRINGBUFFERS; i++)
+    {
+        if (_strings[i].buffer == NULL || _strings[i].handle != handle) continue;
+
+        bool updated = _strings[i].updated;
+        _strings[i].updated = false;
+        return updated;
+    }
+    return false;
+}
+#endif
+
+void XPLProBase::_processPacket()
 {
    
     // check whether we have a valid frame
@@ -246,18 +544,37 @@ void XPLPro::_processPacket()
     {
         return;
     }
+#if XPL_STATS
+    _stats.framesRx++;
+#endif
     // branch on received command
     switch (_receiveBuffer[1])
     {
     // plane unloaded or XP exiting
     case XPL_EXITING:
         _connectionStatus = false;
+#if XPL_EVENTQUEUE_SIZE
+        _eventCount = 0;                // handles are about to become invalid
+#endif
         _xplStopFunction();
         break;
 
     // register device
     case XPLCMD_SENDNAME:
+        // plugins that know about capabilities send their version and features, older ones just [N]
+        _pluginVersion = 0;
+        _pluginFeatures = 0;
+        if (_receiveBuffer[2] == ',')
+        {
+            long features;
+            _parseInt(&_pluginVersion, _receiveBuffer, 2);
+            _parseInt(&features, _receiveBuffer, 3);
+            _pluginFeatures = (unsigned long)features & XPL_FEATURES;
+        }
+
         _sendVersion();
+        if (_pluginVersion >= 1) _sendCapabilities();
+        if (hasFeature(XPLFEATURE_FRAMESIZE)) _sendFrameSize();       // before the name, so the plugin knows it by the time it considers us found
         _sendname();
         _connectionStatus = true; // not considered active till you know my name
         _registerFlag = 0;
@@ -267,6 +584,12 @@ void XPLPro::_processPacket()
     // plugin is ready for registrations.
     case XPLCMD_SENDREQUEST:
         _registerFlag = 1; // use a flag to signal registration so recursion doesn't occur
+#if XPL_EVENTQUEUE_SIZE
+        _eventCount = 0;                // handles are assigned again
+#endif
+#if XPL_STRINGBUFFERS
+        for (int i = 0; i < XPL_STRINGBUFFERS; i++) _strings[i].buffer = NULL;       // handles are assigned again
+#endif
         break;
 
     // get handle from response to registered dataref
@@ -284,8 +607,9 @@ void XPLPro::_processPacket()
         _parseInt(&_inData.handle, _receiveBuffer, 2);
         _parseInt(&_inData.inLong, _receiveBuffer, 3);
         _inData.inFloat = 0;
+        _inData.inRate = 0;
         _inData.element = 0;
-        _xplInboundHandler(&_inData);
+        _callInboundHandler();
         break;
 
     // int array dataref received
@@ -294,16 +618,36 @@ void XPLPro::_processPacket()
         _parseInt(&_inData.inLong, _receiveBuffer, 3);
         _parseInt(&_inData.element, _receiveBuffer, 4);
         _inData.inFloat = 0;
-        _xplInboundHandler(&_inData);
+        _inData.inRate = 0;
+        _callInboundHandler();
+        break;
+
+    // fixed point dataref received
+    case XPLCMD_DATAREFUPDATEFIXED:
+        _parseInt(&_inData.handle, _receiveBuffer, 2);
+        _parseInt(&_inData.inLong, _receiveBuffer, 3);
+        _parseInt(&_inData.decimals, _receiveBuffer, 4);
+        _parseInt(&_inData.element, _receiveBuffer, 5);
+#if XPL_FLOATS
+        _inData.inFloat = _inData.inLong;
+        for (int i = 0; i < _inData.decimals; i++) _inData.inFloat /= 10;
+#else
+        _inData.inFloat = 0;
+#endif
+        _inData.inRate = 0;
+        _callInboundHandler();
+        _inData.decimals = -1;
         break;
 
+#if XPL_FLOATS
     // float dataref received
     case XPLCMD_DATAREFUPDATEFLOAT:
         _parseInt(&_inData.handle, _receiveBuffer, 2);
         _parseFloat(&_inData.inFloat, _receiveBuffer, 3);
         _inData.inLong = 0;
+        _inData.inRate = 0;
         _inData.element = 0;
-        _xplInboundHandler(&_inData);
+        _callInboundHandler();
         break;
 
     // float array dataref received
@@ -312,19 +656,63 @@ void XPLPro::_processPacket()
         _parseFloat(&_inData.inFloat, _receiveBuffer, 3);
         _parseInt(&_inData.element, _receiveBuffer, 4);
         _inData.inLong = 0;
-        _xplInboundHandler(&_inData);
+        _inData.inRate = 0;
+        _callInboundHandler();
+        break;
+
+    // value + rate dataref received
+    case XPLCMD_DATAREFUPDATERATE:
+        _parseInt(&_inData.handle, _receiveBuffer, 2);
+        _parseFloat(&_inData.inFloat, _receiveBuffer, 3);
+        _parseFloat(&_inData.inRate, _receiveBuffer, 4);
+        _parseInt(&_inData.element, _receiveBuffer, 5);
+        _inData.inLong = 0;
+        _callInboundHandler();
         break;
+#endif
    
+    // gate closed
+    case XPLCMD_DATAREFGATED:
+        _parseInt(&_inData.handle, _receiveBuffer, 2);
+        _inData.inLong = 0;
+        _inData.inFloat = 0;
+        _inData.inRate = 0;
+        _inData.element = 0;
+        _inData.gated = true;
+        _callInboundHandler();
+        _inData.gated = false;
+        break;
+
     case XPLCMD_DATAREFUPDATESTRING:
         _parseInt(&_inData.handle, _receiveBuffer, 2);
         _parseInt(&_inData.strLength, _receiveBuffer, 3);
-        _receiveNSerial(_inData.strLength);
-        _inData.inStr = _receiveBuffer;
-        
-        _xplInboundHandler(&_inData);
+        _inData.strOffset = -1;
+        _inData.element = 0;
+        _receiveRaw(_inData.strLength);
+        break;
+
+    // part of a string dataref
+    case XPLCMD_DATAREFUPDATESTRINGPATCH:
+        _parseInt(&_inData.handle, _receiveBuffer, 2);
+        _parseInt(&_inData.strOffset, _receiveBuffer, 3);
+        _parseInt(&_inData.strLength, _receiveBuffer, 4);
+        _inData.element = 0;
+        _receiveRaw(_inData.strLength);
         break;
        
 
+    // a command began or ended
+    case XPLCMD_COMMANDEVENT:
+        if (_xplCommandEventHandler)
+        {
+            int commandHandle;
+            int phase;
+            _parseInt(&commandHandle, _receiveBuffer, 2);
+            _parseInt(&phase, _receiveBuffer, 3);
+            _xplCommandEventHandler(commandHandle, phase);
+        }
+        break;
+
     // obsolete?            reserve for the time being...
   //  case XPLREQUEST_REFRESH:
   //      break;
@@ -336,34 +724,144 @@ void XPLPro::_processPacket()
     _receiveBuffer[0] = 0;
 }
 
-void XPLPro::_sendPacketVoid(int command, int handle) // just a command with a handle
+void XPLProBase::_callInboundHandler()
+{
+#if XPL_EVENTQUEUE_SIZE
+    // a newer value for something already queued replaces it
+    for (int i = 0; i < _eventCount; i++)
+    {
+        inStruct *event = &_events[(_eventFirst + i) % XPL_EVENTQUEUE_SIZE];
+        if (event->handle == _inData.handle && event->element == _inData.element)
+        {
+            *event = _inData;
+            event->inStr = NULL;
+            return;
+        }
+    }
+
+    // full, which xloop() doesn't let happen, only frames read while waiting for a registration can get here.
+    // Running the handler in the middle of receiving could take long enough to overrun the receive buffer, drop the oldest.
+    if (_eventCount >= XPL_EVENTQUEUE_SIZE)
+    {
+        _eventFirst = (_eventFirst + 1) % XPL_EVENTQUEUE_SIZE;
+        _eventCount--;
+#if XPL_STATS
+        _stats.queueFull++;
+#endif
+    }
+
+    inStruct *event = &_events[(_eventFirst + _eventCount) % XPL_EVENTQUEUE_SIZE];
+    *event = _inData;
+    event->inStr = NULL;
+    event->strLength = 0;
+    _eventCount++;
+#else
+    _runInboundHandler(&_inData);
+#endif
+}
+
+void XPLProBase::_runInboundHandler(inStruct *inData)
+{
+#if XPL_STATS
+    if (_stats.interval)
+    {
+        unsigned long startTime = micros();
+        _xplInboundHandler(inData);
+        _stats.callback += micros() - startTime;
+        return;
+    }
+#endif
+    _xplInboundHandler(inData);
+}
+
+#if XPL_EVENTQUEUE_SIZE
+int XPLProBase::dispatch(int maxEvents)
+{
+    int count = 0;
+
+    while (_eventCount && count < maxEvents)
+    {
+        inStruct event = _events[_eventFirst];       // copy, the handler may cause more events to be queued
+        _eventFirst = (_eventFirst + 1) % XPL_EVENTQUEUE_SIZE;
+        _eventCount--;
+
+        _runInboundHandler(&event);
+        count++;
+    }
+
+    return count;
+}
+
+int XPLProBase::dispatchFor(unsigned long maxMicros)
+{
+    unsigned long startTime = micros();
+    int count = 0;
+
+    while (_eventCount && (count == 0 || micros() - startTime < maxMicros)) count += dispatch(1);
+
+    return count;
+}
+
+void XPLProBase::setDispatchBudget(int maxEvents)
+{
+    _dispatchBudget = maxEvents;
+}
+
+int XPLProBase::eventsPending()
+{
+    return _eventCount;
+}
+
+void XPLProBase::_dropEvents(int handle)
+{
+    int kept = 0;
+
+    for (int i = 0; i < _eventCount; i++)
+    {
+        inStruct *event = &_events[(_eventFirst + i) % XPL_EVENTQUEUE_SIZE];
+
+        if (event->handle == handle) continue;
+        if (kept != i) _events[(_eventFirst + kept) % XPL_EVENTQUEUE_SIZE] = *event;
+        kept++;
+    }
+
+    _eventCount = kept;
+}
+#endif
+
+void XPLProBase::_sendPacketVoid(int command, int handle) // just a command with a handle
 {
     // check for valid handle
     if (handle < 0)
     {
         return;
     }
-    sprintf(_sendBuffer, "%c%c,%i%c", XPL_PACKETHEADER, command, handle, XPL_PACKETTRAILER);
-    _transmitPacket();
+    _transmitPacket(snprintf(_sendBuffer, _sendBufferSize, "%c%c,%i%c", XPL_PACKETHEADER, command, handle, XPL_PACKETTRAILER));
 }
 
-void XPLPro::_sendPacketString(int command, const char *str) // for a string
+void XPLProBase::_sendPacketString(int command, const char *str) // for a string
 {
-    sprintf(_sendBuffer, "%c%c,\"%s\"%c", XPL_PACKETHEADER, command, str, XPL_PACKETTRAILER);
-    _transmitPacket();
+    _transmitPacket(snprintf(_sendBuffer, _sendBufferSize, "%c%c,\"%s\"%c", XPL_PACKETHEADER, command, str, XPL_PACKETTRAILER));
 }
 
-void XPLPro::_transmitPacket(void)
+bool XPLProBase::_transmitPacket(int length)
 {
+    // a frame cut off by snprintf would only confuse the plugin, leave it out
+    if (length < 0 || length >= _sendBufferSize) return false;
+
     _streamPtr->write(_sendBuffer);
-    if (strlen(_sendBuffer) == 64)
+#if XPL_STATS
+    _stats.framesTx++;
+#endif
+    if (length == 64)
     {
         // apparently a bug in arduino with some boards when we transmit exactly 64 bytes. That took a while to track down...
         _streamPtr->print(" ");
     }
+    return true;
 }
 
-int XPLPro::_parseString(char *outBuffer, char *inBuffer, int parameter, int maxSize)// todo:  Confirm 0 length strings ("") dont cause issues
+int XPLProBase::_parseString(char *outBuffer, char *inBuffer, int parameter, int maxSize)// todo:  Confirm 0 length strings ("") dont cause issues
 {
     int cBeg;
     int pos = 0;
@@ -399,7 +897,7 @@ int XPLPro::_parseString(char *outBuffer, char *inBuffer, int parameter, int max
     return 0;
 }
 
-int XPLPro::_parseInt(int *outTarget, char *inBuffer, int parameter)
+int XPLProBase::_parseInt(int *outTarget, char *inBuffer, int parameter)
 {
     int cBeg;
     int pos = 0;
@@ -429,7 +927,7 @@ int XPLPro::_parseInt(int *outTarget, char *inBuffer, int parameter)
     return 0;
 }
 
-int XPLPro::_parseInt(long *outTarget, char *inBuffer, int parameter)
+int XPLProBase::_parseInt(long *outTarget, char *inBuffer, int parameter)
 {
     int cBeg;
     int pos = 0;
@@ -453,7 +951,8 @@ int XPLPro::_parseInt(long *outTarget, char *inBuffer, int parameter)
     return 0;
 }
 
-int XPLPro::_parseFloat(float *outTarget, char *inBuffer, int parameter)
+#if XPL_FLOATS
+int XPLProBase::_parseFloat(float *outTarget, char *inBuffer, int parameter)
 {
     int cBeg;
     int pos = 0;
@@ -476,8 +975,9 @@ int XPLPro::_parseFloat(float *outTarget, char *inBuffer, int parameter)
     inBuffer[pos] = holdChar;
     return 0;
 }
+#endif
 
-int XPLPro::registerDataRef(XPString_t *datarefName)
+int XPLProBase::registerDataRef(XPString_t *datarefName)
 {
     long int startTime;
 
@@ -487,11 +987,11 @@ int XPLPro::registerDataRef(XPString_t *datarefName)
         return XPL_HANDLE_INVALID;
     }
 #if XPL_USE_PROGMEM
-    sprintf(_sendBuffer, "%c%c,\"%S\"%c", XPL_PACKETHEADER, XPLREQUEST_REGISTERDATAREF, (wchar_t *)datarefName, XPL_PACKETTRAILER);
+    int length = snprintf(_sendBuffer, _sendBufferSize, "%c%c,\"%S\"%c", XPL_PACKETHEADER, XPLREQUEST_REGISTERDATAREF, (wchar_t *)datarefName, XPL_PACKETTRAILER);
 #else
-    sprintf(_sendBuffer, "%c%c,\"%s\"%c", XPL_PACKETHEADER, XPLREQUEST_REGISTERDATAREF, (char *)datarefName, XPL_PACKETTRAILER);
+    int length = snprintf(_sendBuffer, _sendBufferSize, "%c%c,\"%s\"%c", XPL_PACKETHEADER, XPLREQUEST_REGISTERDATAREF, (char *)datarefName, XPL_PACKETTRAILER);
 #endif
-    _transmitPacket();
+    if (!_transmitPacket(length)) return XPL_HANDLE_INVALID;       // name too long for the transmit buffer
 
     _handleAssignment = XPL_HANDLE_INVALID;
     startTime = millis(); // for timeout function
@@ -502,15 +1002,15 @@ int XPLPro::registerDataRef(XPString_t *datarefName)
     return _handleAssignment;
 }
 
-int XPLPro::registerCommand(XPString_t *commandName)
+int XPLProBase::registerCommand(XPString_t *commandName)
 {
     long int startTime = millis(); // for timeout function
 #if XPL_USE_PROGMEM
-    sprintf(_sendBuffer, "%c%c,\"%S\"%c", XPL_PACKETHEADER, XPLREQUEST_REGISTERCOMMAND, (wchar_t *)commandName, XPL_PACKETTRAILER);
+    int length = snprintf(_sendBuffer, _sendBufferSize, "%c%c,\"%S\"%c", XPL_PACKETHEADER, XPLREQUEST_REGISTERCOMMAND, (wchar_t *)commandName, XPL_PACKETTRAILER);
 #else
-    sprintf(_sendBuffer, "%c%c,\"%s\"%c", XPL_PACKETHEADER, XPLREQUEST_REGISTERCOMMAND, (char *)commandName, XPL_PACKETTRAILER);
+    int length = snprintf(_sendBuffer, _sendBufferSize, "%c%c,\"%s\"%c", XPL_PACKETHEADER, XPLREQUEST_REGISTERCOMMAND, (char *)commandName, XPL_PACKETTRAILER);
 #endif
-    _transmitPacket();
+    if (!_transmitPacket(length)) return XPL_HANDLE_INVALID;       // name too long for the transmit buffer
     _handleAssignment = XPL_HANDLE_INVALID;
     while (millis() - startTime < XPL_RESPONSE_TIMEOUT && _handleAssignment < 0)
     {
@@ -519,82 +1019,155 @@ int XPLPro::registerCommand(XPString_t *commandName)
     return _handleAssignment;
 }
 
-void XPLPro::requestUpdates(int handle, int rate, float precision)
+void XPLProBase::requestUpdates(int handle, int rate, float precision)
 {
     if (handle < 0) return;
 
-    char* s = _sendBuffer;
-    s += sprintf(_sendBuffer, "%c%c,%i,%i,",
+    char number[XPL_NUMBERSIZE];
+    Xdtostrf(precision, 0, XPL_FLOATPRECISION, number);
+    _transmitPacket(snprintf(_sendBuffer, _sendBufferSize, "%c%c,%i,%i,%s%c",
         XPL_PACKETHEADER,
         XPLREQUEST_UPDATES,
         handle,
-        rate);
-    s += Xdtostrf(precision, 0, XPL_FLOATPRECISION, s);
-    sprintf(s, "%c",
-        XPL_PACKETTRAILER);
-    _transmitPacket();
+        rate,
+        number,
+        XPL_PACKETTRAILER));
 }
 
-void XPLPro::requestUpdates(int handle, int rate, float precision, int arrayElement)
+void XPLProBase::requestUpdates(int handle, int rate, float precision, int arrayElement)
 {
     if (handle < 0) return;
 
-    char* s = _sendBuffer;
-    s += sprintf(_sendBuffer, "%c%c,%i,%i,",
+    char number[XPL_NUMBERSIZE];
+    Xdtostrf(precision, 0, XPL_FLOATPRECISION, number);
+    _transmitPacket(snprintf(_sendBuffer, _sendBufferSize, "%c%c,%i,%i,%s,%i%c",
         XPL_PACKETHEADER,
         XPLREQUEST_UPDATESARRAY,
         handle,
-        rate);
-    s += Xdtostrf(precision, 0, XPL_FLOATPRECISION, s);
-    sprintf(s, ",%i%c",
+        rate,
+        number,
         arrayElement,
-        XPL_PACKETTRAILER);
-
-    _transmitPacket();
+        XPL_PACKETTRAILER));
 }
 
 
-void XPLPro::requestUpdatesType(int handle, int type, int rate, float precision)
+void XPLProBase::requestUpdatesType(int handle, int type, int rate, float precision)
 {
     if (handle < 0) return;
 
-    char* s = _sendBuffer;
-    s += sprintf(_sendBuffer, "%c%c,%i,%i,%i,",
+    char number[XPL_NUMBERSIZE];
+    Xdtostrf(precision, 0, XPL_FLOATPRECISION, number);
+    _transmitPacket(snprintf(_sendBuffer, _sendBufferSize, "%c%c,%i,%i,%i,%s%c",
         XPL_PACKETHEADER,
         XPLREQUEST_UPDATES_TYPE,
         handle,
         type,
-        rate);
-    s += Xdtostrf(precision, 0, XPL_FLOATPRECISION, s);
-    sprintf(s, "%c",
-        XPL_PACKETTRAILER);
-    _transmitPacket();
+        rate,
+        number,
+        XPL_PACKETTRAILER));
 }
 
-void XPLPro::requestUpdatesType(int handle, int type, int rate, float precision, int arrayElement)
+void XPLProBase::requestUpdatesType(int handle, int type, int rate, float precision, int arrayElement)
 {
     if (handle < 0) return;
 
-    char* s = _sendBuffer;
-    s += sprintf(_sendBuffer, "%c%c,%i,%i,%i",
+    char number[XPL_NUMBERSIZE];
+    Xdtostrf(precision, 0, XPL_FLOATPRECISION, number);
+    _transmitPacket(snprintf(_sendBuffer, _sendBufferSize, "%c%c,%i,%i,%i,%s,%i%c",
         XPL_PACKETHEADER,
         XPLREQUEST_UPDATES_TYPE_ARRAY,
         handle,
         type,
-        rate);
-    s += Xdtostrf(precision, 0, XPL_FLOATPRECISION, s);
-    sprintf(s, ",%i%c",
+        rate,
+        number,
+        arrayElement,
+        XPL_PACKETTRAILER));
+}
+
+
+void XPLProBase::requestInterpolatedUpdates(int handle, int rate, float tolerance)
+{
+    requestInterpolatedUpdates(handle, rate, tolerance, 0);
+}
+
+void XPLProBase::requestInterpolatedUpdates(int handle, int rate, float tolerance, int arrayElement)
+{
+    if (handle < 0) return;
+
+    char number[XPL_NUMBERSIZE];
+    Xdtostrf(tolerance, 0, XPL_FLOATPRECISION, number);
+    _transmitPacket(snprintf(_sendBuffer, _sendBufferSize, "%c%c,%i,%i,%s,%i%c",
+        XPL_PACKETHEADER,
+        XPLREQUEST_UPDATES_DR,
+        handle,
+        rate,
+        number,
         arrayElement,
-        XPL_PACKETTRAILER);
+        XPL_PACKETTRAILER));
+}
+
+
+void XPLProBase::requestFixedUpdates(int handle, int rate, int decimals)
+{
+    requestFixedUpdates(handle, rate, decimals, 0);
+}
+
+void XPLProBase::requestFixedUpdates(int handle, int rate, int decimals, int arrayElement)
+{
+    if (handle < 0) return;
+
+    _transmitPacket(snprintf(_sendBuffer, _sendBufferSize, "%c%c,%i,%i,%i,%i%c", XPL_PACKETHEADER, XPLREQUEST_UPDATES_FIXED, handle, rate, decimals, arrayElement, XPL_PACKETTRAILER));
+}
 
-    _transmitPacket();
+void XPLProBase::requestStringPatches(int handle, int rate, long resyncInterval)
+{
+    if (handle < 0) return;
+
+    _transmitPacket(snprintf(_sendBuffer, _sendBufferSize, "%c%c,%i,%i,%ld%c", XPL_PACKETHEADER, XPLREQUEST_UPDATES_STRINGDIFF, handle, rate, resyncInterval, XPL_PACKETTRAILER));
 }
 
+int XPLProBase::applyString(inStruct *inData, char *buffer, int bufferSize)
+{
+    int offset = inData->strOffset < 0 ? 0 : inData->strOffset;
+    int length = inData->strLength;
+
+    if (inData->inStr == NULL || length < 0 || bufferSize < 1 || offset >= bufferSize - 1) return 0;
+    if (inData->inStr == buffer) return 1;                          // registered with registerStringBuffer, already there
+
+    if (offset + length > bufferSize - 1) length = bufferSize - 1 - offset;
+
+    memcpy(&buffer[offset], inData->inStr, length);
+    if (inData->strOffset < 0) buffer[length] = 0;                  // whole string, patches never change the length
+
+    return 1;
+}
+
+void XPLProBase::requestGate(int handle, int gateHandle, int condition, float threshold)
+{
+    requestGate(handle, gateHandle, condition, threshold, 0);
+}
+
+void XPLProBase::requestGate(int handle, int gateHandle, int condition, float threshold, int gateElement)
+{
+    if (handle < 0 || gateHandle < 0) return;
+
+    char number[XPL_NUMBERSIZE];
+    Xdtostrf(threshold, 0, XPL_FLOATPRECISION, number);
+    _transmitPacket(snprintf(_sendBuffer, _sendBufferSize, "%c%c,%i,%i,%i,%s,%i%c",
+        XPL_PACKETHEADER,
+        XPLREQUEST_GATE,
+        handle,
+        gateHandle,
+        condition,
+        number,
+        gateElement,
+        XPL_PACKETTRAILER));
+}
 
 
-void XPLPro::setScaling(int handle, int inLow, int inHigh, int outLow, int outHigh)     // Currently only active for OUTBOUND (from arduino) data
+void XPLProBase::setScaling(int handle, int inLow, int inHigh, int outLow, int outHigh)     // Currently only active for OUTBOUND (from arduino) data
 {
-    sprintf(_sendBuffer, "%c%c,%i,%i,%i,%i,%i%c",
+    _transmitPacket(snprintf(_sendBuffer, _sendBufferSize, "%c%c,%i,%i,%i,%i,%i%c",
             XPL_PACKETHEADER,
             XPLREQUEST_SCALING,
             handle,
@@ -602,13 +1175,12 @@ void XPLPro::setScaling(int handle, int inLow, int inHigh, int outLow, int outHi
             inHigh,
             outLow,
             outHigh,
-            XPL_PACKETTRAILER);
-    _transmitPacket();
+            XPL_PACKETTRAILER));
 }
 
 // Re-creation of dtostrf for non-AVR boards
 // Returns: number of chars added after <sout> ('\0' not included)
-int XPLPro::Xdtostrf(double val, signed char width, unsigned char prec, char* sout)
+int XPLProBase::Xdtostrf(double val, signed char width, unsigned char prec, char* sout)
 {
 #ifdef __AVR_ARCH__
     dtostrf(val, width, prec, sout);
@@ -616,6 +1188,6 @@ int XPLPro::Xdtostrf(double val, signed char width, unsigned char prec, char* so
 #else
     char fmt[20];
     sprintf(fmt, "%%%d.%df", width, prec);
-    return sprintf(sout, fmt, val);
+    return snprintf(sout, XPL_NUMBERSIZE, fmt, val);
 #endif
 }
@@ -45,7 +45,10 @@
 // Package buffer size for send and receive buffer each.
 // If you need a few extra bytes of RAM it could be reduced, but it needs to
 // be as long as the longest dataref name + 10.  If you are using datarefs
-// that transfer strings it needs to be big enough for those too.  (default 200, should be less than 256)
+// that transfer strings it needs to be big enough for those too.  (default 200)
+// Both sizes are sent to the plugin when it connects, boards with more RAM (Teensy, ESP32, RP2040...) can use
+// larger frames for long strings, up to 2048.  Smaller than 200 is not recommended, the plugin won't go below that.
+// These are the sizes of the usual XPLPro class, use XPLProT<transmit size, receive size> to size them in the sketch instead.
 #ifndef XPLMAX_PACKETSIZE_TRANSMIT
 #define XPLMAX_PACKETSIZE_TRANSMIT 200
 #endif
@@ -54,6 +57,40 @@
 #define XPLMAX_PACKETSIZE_RECEIVE 200
 #endif
 
+// Smallest sizes XPLProT accepts.  The plugin sends frames of up to 200 bytes whatever the board says, and every frame the
+// library sends fits in 100 apart from registrations with long names, which fail instead of being cut off.
+#define XPLMIN_PACKETSIZE_TRANSMIT 100
+#define XPLMIN_PACKETSIZE_RECEIVE 200
+
+// Loop time and link counters that can be reported to the plugin with enableStats().
+// Costs a few bytes of RAM and a micros() call per loop when enabled at runtime,  set to 1 to build it in.  (default 0)
+#ifndef XPL_STATS
+#define XPL_STATS 0
+#endif
+
+// Float dataref updates from the plugin are parsed with atof, which is slow and large on 8 bit boards.  Sketches that
+// only use int datarefs and requestFixedUpdates can set this to 0 to leave float parsing out, float updates are then
+// ignored.  (default 1)
+#ifndef XPL_FLOATS
+#define XPL_FLOATS 1
+#endif
+
+// String datarefs that can have their own buffer in the sketch, see registerStringBuffer.
+// Each costs about 7 bytes of RAM on AVR, 0 leaves it out.  (default 0)
+#ifndef XPL_STRINGBUFFERS
+#define XPL_STRINGBUFFERS 0
+#endif
+
+// Inbound events (dataref values) waiting for the inbound handler.  With a queue, xloop() takes in all waiting frames
+// first and runs the handler afterwards, or call dispatch() from your own loop to control how much time handlers get.
+// When the queue is full, frames wait in the serial port's buffer until dispatch() makes room.
+// A newer value for the same dataref element replaces the queued one.  Strings still go to the handler right away and
+// drop what is queued for the same dataref.
+// Each entry costs about 25 bytes of RAM on AVR, 0 leaves it out.  (default 0)
+#ifndef XPL_EVENTQUEUE_SIZE
+#define XPL_EVENTQUEUE_SIZE 0
+#endif
+
 //////////////////////////////////////////////////////////////
 // All other defines in this header must not be modified
 //////////////////////////////////////////////////////////////
@@ -72,7 +109,7 @@ typedef int  cmd_handle;
 
 // Parameters around the interface
 #define XPL_BAUDRATE 115200   // Baudrate needed to match plugin
-#define XPL_RX_TIMEOUT 500    // Timeout for reception of one frame
+#define XPL_RX_TIMEOUT 500    // Timeout for reception of one frame, a frame not complete by then is dropped
 #define XPL_PACKETHEADER '['  // Frame start character
 #define XPL_PACKETTRAILER ']' // Frame end character
 #define XPL_HANDLE_INVALID -1 // invalid handle
@@ -81,6 +118,8 @@ typedef int  cmd_handle;
 #define XPLCMD_SENDNAME 'N'                // plugin request name from arduino
 #define XPLRESPONSE_NAME 'n'               // Arduino responds with device name as initialized in the "begin" function
 #define XPLRESPONSE_VERSION 'v'             // Arduino responds with build date and time (when sketch was compiled)
+#define XPLRESPONSE_FRAMESIZE 'f'           // Arduino responds with the size of its receive and transmit buffers
+#define XPLRESPONSE_CAPABILITIES 'F'        // Arduino responds with its protocol version and feature bits, only to plugins that sent theirs with XPLCMD_SENDNAME
 #define XPLCMD_SENDREQUEST 'Q'             // plugin sends this when it is ready to register bindings
 #define XPLCMD_FLIGHTLOOPPAUSE	    'p'		// stop flight loop while we register
 #define XPLCMD_FLIGHTLOOPRESUME  	'q'		// 
@@ -95,6 +134,37 @@ typedef int  cmd_handle;
 #define XPLREQUEST_UPDATESARRAY 't'        // arduino is asking the plugin to update the specified array dataref with rate and divider parameters
 #define XPLREQUEST_UPDATES_TYPE 'y'       // 3/25/2024 update:  some datarefs (looking at you Zibo...) return multiple data types, We can force which one to receive here.
 #define XPLREQUEST_UPDATES_TYPE_ARRAY 'w'
+#define XPLREQUEST_UPDATES_DR 'h'          // arduino is asking the plugin to send value + rate whenever our extrapolation would be off by more than a tolerance
+#define XPLREQUEST_UPDATES_STRINGDIFF 'l'  // arduino is asking the plugin to send a string dataref as patches of what changed, see requestStringPatches
+#define XPLREQUEST_GATE 'a'                // arduino is asking the plugin to hold back updates of a dataref while another dataref (the gate) is false, see requestGate
+#define XPLREQUEST_UPDATES_FIXED '8'       // arduino is asking the plugin to send updates as fixed point integers, see requestFixedUpdates
+#define XPLREQUEST_COMMANDEVENTS '0'       // arduino wants to know when a command begins and ends, see requestCommandEvents
+#define XPLREQUEST_STRINGSIZE 'L'          // arduino tells the plugin how long strings for a string dataref can be, see registerStringBuffer
+
+// Protocol version and optional features.  The plugin sends its version and features with XPLCMD_SENDNAME and the
+// arduino answers with its own, a feature is only used when both sides have it.  Plugins that send neither are version 0.
+#define XPL_PROTOCOL_VERSION 1
+#define XPLFEATURE_FRAMESIZE     0x0001     // frame sizes beyond 200 and string sizes per dataref, see XPLMAX_PACKETSIZE_RECEIVE
+#define XPLFEATURE_BATCHING      0x0002     // several updates in one frame
+#define XPLFEATURE_BINARYFRAMES  0x0004     // binary instead of text frames
+#define XPLFEATURE_BAUDUPGRADE   0x0008     // switch to a faster baud rate after connecting
+#define XPLFEATURE_GROUPS        0x0010     // group subscriptions
+#define XPLFEATURE_SESSION       0x0020     // session tokens, resume without registering again
+#define XPLFEATURE_FIXEDPOINT    0x0040     // fixed point updates and writes, see requestFixedUpdates
+#define XPLFEATURE_COMMANDEVENTS 0x0080     // command begin / end events, see requestCommandEvents
+#define XPL_FEATURES (XPLFEATURE_FRAMESIZE | XPLFEATURE_FIXEDPOINT | XPLFEATURE_COMMANDEVENTS)  // what this library version supports
+
+#define XPL_FIXED_MAXDECIMALS 6             // most decimals for fixed point values
+
+// phases passed to the command event handler, the values come from the Xplane SDK
+#define XPL_COMMAND_BEGIN 0
+#define XPL_COMMAND_END 2
+
+// conditions for requestGate, the gate is open (updates flow) when the gate dataref is ... the threshold
+#define XPL_GATE_GREATER 0
+#define XPL_GATE_LESS 1
+#define XPL_GATE_EQUAL 2
+#define XPL_GATE_NOTEQUAL 3
 
 // these are the data types for the above requests that we can send.  These values come directly from the Xplane SDK.  The Dataref needs to support the type of data
 //          that we are requesting here, refer to the documentation for the dataref.  The XPLDirectError.log also reports the type of data each registered dataref
@@ -114,12 +184,35 @@ typedef int  cmd_handle;
 #define XPLCMD_DATAREFUPDATEFLOAT '2'      // Float DataRef update
 #define XPLCMD_DATAREFUPDATEINTARRAY '3'   // Int array DataRef update
 #define XPLCMD_DATAREFUPDATEFLOATARRAY '4' // Float array DataRef Update
+#define XPLCMD_DATAREFUPDATERATE '5'       // Value + rate of change per second DataRef update, see requestInterpolatedUpdates
+#define XPLCMD_DATAREFUPDATEFIXED '6'      // Fixed point DataRef update, both ways:  handle, value * 10^decimals, decimals, element
 #define XPLCMD_DATAREFUPDATESTRING '9'     // String DataRef update
+#define XPLCMD_DATAREFUPDATESTRINGPATCH '7' // Part of a string DataRef changed:  handle, offset, length, then the bytes
+#define XPLCMD_DATAREFGATED 'x'            // Gate closed, DataRef value is meaningless until the next update (inStruct.gated is set)
 #define XPLCMD_COMMANDTRIGGER 'k'          // Trigger command n times
 #define XPLCMD_COMMANDSTART 'i'            // Begin command (Button pressed)
 #define XPLCMD_COMMANDEND 'j'              // End command (Button released)
+#define XPLCMD_COMMANDEVENT 'E'            // A command began or ended in XPlane:  handle, phase.  See requestCommandEvents
+#define XPLCMD_DEVICESTATS 'o'             // Loop time and link counters for the last interval, see enableStats
 #define XPL_EXITING 'X'                    // XPlane sends this to the arduino device during normal shutdown of XPlane. It may not happen if xplane crashes.
 
+/// @brief A receive side that hands over blocks of bytes instead of one byte at a time, a DMA buffer for instance.
+///        See XPLDMASerial.h and setBlockSource.
+class XPLBlockSource
+{
+public:
+    /// @brief Bytes waiting in one piece
+    /// @param data Set to the first byte waiting
+    /// @return Number of bytes at data, 0 if nothing is waiting
+    virtual int receiveBlock(const char **data) = 0;
+
+    /// @brief The first count bytes of the last block were taken
+    virtual void receiveDone(int count) = 0;
+
+    /// @brief Times received bytes were lost so far (overruns, line errors), the frame being received is dropped when it goes up
+    virtual unsigned long receiveLosses(void) { return 0; }
+};
+
 struct inStruct // potentially 'class'
 {
     dref_handle handle;
@@ -127,17 +220,18 @@ struct inStruct // potentially 'class'
     int element;
     long inLong;
     float inFloat;
+    float inRate;       // rate of change per second, for interpolated updates only
     int strLength;      // if string data, length of string data
+    int strOffset;      // if string data, where inStr goes in the string for a patch, or -1 for the whole string.  See applyString
     char* inStr;
+    bool gated;         // true when the gate for this dataref closed (bus dead, avionics off...), blank the display.  See requestGate
+    int decimals;       // fixed point updates:  inLong is the value * 10^decimals, -1 for other updates.  See requestFixedUpdates
 };
 
-/// @brief Core class for the XPLPro Arduino library
-class XPLPro
+/// @brief Core class for the XPLPro Arduino library.  Declare an XPLPro, or an XPLProT to choose the buffer sizes, add-ons take either.
+class XPLProBase
 {
 public:
-    /// @brief Constructor
-    /// @param device Device to use (should be &Serial)
-    XPLPro(Stream *device);
 
     /// @brief Register device and set callback functions
     /// @param devicename Device name
@@ -150,6 +244,32 @@ public:
     /// @return True if connection to XPlane established
     int connectionStatus();
 
+#if XPL_EVENTQUEUE_SIZE
+    /// @brief Run the inbound handler for queued events, oldest first
+    /// @param maxEvents Most events to handle in this call
+    /// @return Number of events handled
+    int dispatch(int maxEvents);
+
+    /// @brief Run the inbound handler for queued events until the time budget is used up.  At least one event is handled if any are queued.
+    /// @param maxMicros Time budget in microseconds
+    /// @return Number of events handled
+    int dispatchFor(unsigned long maxMicros);
+
+    /// @brief How many events xloop() handles after reading the serial port, 0 to leave it all to dispatch().  (default XPL_EVENTQUEUE_SIZE)
+    void setDispatchBudget(int maxEvents);
+
+    /// @brief Number of events waiting
+    int eventsPending();
+#endif
+
+    /// @brief Protocol version of the plugin, 0 for plugins older than the capability exchange
+    int pluginVersion();
+
+    /// @brief Check whether a protocol feature is in use, ie both the plugin and this library support it
+    /// @param feature One of the XPLFEATURE_ bits
+    /// @return True if the feature can be used
+    int hasFeature(unsigned long feature);
+
     /// @brief Trigger a command once
     /// @param commandHandle of the command to trigger
     /// @return 0: OK, -1: command was not registered
@@ -171,6 +291,17 @@ public:
     /// @return 0: OK, -1: command was not registered
     int commandEnd(cmd_handle commandHandle);
 
+    /// @brief Ask the plugin to report when a command begins and ends, whoever runs it:  the user, another plugin or this device.
+    ///        Call from the registration callback after registering the command.  Needs a plugin with XPLFEATURE_COMMANDEVENTS.
+    /// @param commandHandle Handle of the command
+    /// @return 0: OK, -1: command was not registered, -2: the plugin doesn't send command events
+    int requestCommandEvents(cmd_handle commandHandle);
+
+    /// @brief Set the function called for command events, with the command handle and XPL_COMMAND_BEGIN or XPL_COMMAND_END.
+    ///        It is called straight from xloop(), events are never merged or queued.
+    /// @param handler Function to call, NULL to ignore the events
+    void setCommandEventHandler(void (*handler)(cmd_handle commandHandle, int phase)) { _xplCommandEventHandler = handler; };
+
     /// @brief Write an integer DataRef.
     /// @param handle Handle of the DataRef to write
     /// @param value Value to write to the DataRef
@@ -205,6 +336,7 @@ public:
     void datarefWrite(dref_handle handle, float value, int arrayElement);
    
     /// @brief Force plugin to update dataref value.  Experimental and probably redundant, use sparingly!
+    ///        For string patches this asks for the whole string.
     /// @param handle Handle of the DataRef to write
     void datarefTouch(dref_handle handle);
 
@@ -236,6 +368,93 @@ public:
     /// @param arrayElement Array element to subscribe to
     void requestUpdatesType(dref_handle handle, int type, int rate, float precision, int arrayElement);
 
+    /// @brief Request value + rate updates from the plugin.  Updates are only sent when extrapolating
+    ///        the last value with its rate would be off by more than the tolerance, see XPLInterpolator.h
+    /// @param handle Handle of the DataRef to subscribe to
+    /// @param rate Maximum rate for updates to reduce traffic
+    /// @param tolerance Maximum error allowed before the plugin sends a fresh value
+    void requestInterpolatedUpdates(dref_handle handle, int rate, float tolerance);
+
+    /// @brief Request value + rate updates from the plugin for an array DataRef
+    /// @param handle Handle of the DataRef to subscribe to
+    /// @param rate Maximum rate for updates to reduce traffic
+    /// @param tolerance Maximum error allowed before the plugin sends a fresh value
+    /// @param arrayElement Array element to subscribe to
+    void requestInterpolatedUpdates(dref_handle handle, int rate, float tolerance, int arrayElement);
+
+    /// @brief Request DataRef updates as fixed point integers instead of floats.  inLong is the value * 10^decimals and
+    ///        inData->decimals is set, inFloat is the value (0 with XPL_FLOATS 0).  Parsing an integer is much faster than
+    ///        a float on 8 bit boards.  Needs a plugin with XPLFEATURE_FIXEDPOINT, older ones ignore the request.
+    /// @param handle Handle of the DataRef to subscribe to
+    /// @param rate Maximum rate for updates to reduce traffic
+    /// @param decimals Decimals kept, 0 to XPL_FIXED_MAXDECIMALS.  Updates are only sent when the scaled value changes.
+    void requestFixedUpdates(dref_handle handle, int rate, int decimals);
+
+    /// @brief Request fixed point DataRef updates for an array DataRef
+    /// @param handle Handle of the DataRef to subscribe to
+    /// @param rate Maximum rate for updates to reduce traffic
+    /// @param decimals Decimals kept, 0 to XPL_FIXED_MAXDECIMALS
+    /// @param arrayElement Array element to subscribe to
+    void requestFixedUpdates(dref_handle handle, int rate, int decimals, int arrayElement);
+
+    /// @brief Write a DataRef from a fixed point value, the plugin writes value / 10^decimals.  Avoids formatting floats.
+    /// @param handle Handle of the DataRef to write
+    /// @param value Value * 10^decimals
+    /// @param decimals Decimals in value, 0 to XPL_FIXED_MAXDECIMALS
+    void datarefWriteFixed(dref_handle handle, long value, int decimals);
+
+    /// @brief Write an array DataRef element from a fixed point value
+    /// @param handle Handle of the DataRef to write
+    /// @param value Value * 10^decimals
+    /// @param decimals Decimals in value, 0 to XPL_FIXED_MAXDECIMALS
+    /// @param arrayElement Array element to write to
+    void datarefWriteFixed(dref_handle handle, long value, int decimals, int arrayElement);
+
+    /// @brief Request updates of a string DataRef (CDU lines...) as patches of the characters that changed instead of
+    ///        the whole string.  Keep a copy of the string on the board and pass every update through applyString.
+    /// @param handle Handle of the DataRef to subscribe to
+    /// @param rate Maximum rate for updates to reduce traffic
+    /// @param resyncInterval The whole string is sent every resyncInterval ms in case a patch was lost, 0 for never
+    void requestStringPatches(dref_handle handle, int rate, long resyncInterval);
+
+    /// @brief Apply a string update, whole or patch, to the board side copy of the string.  Call from the inbound handler.
+    /// @param inData As received by the inbound handler
+    /// @param buffer Board side copy of the string, kept null terminated
+    /// @param bufferSize Size of buffer including the terminator
+    /// @return 1 if inData was a string update and the buffer changed, 0 otherwise.  Nothing to do for registerStringBuffer buffers.
+    static int applyString(inStruct *inData, char *buffer, int bufferSize);
+
+#if XPL_STRINGBUFFERS
+    /// @brief Have updates of a string DataRef written straight into a buffer of the sketch instead of the receive buffer,
+    ///        patches included.  The buffer is kept null terminated and can be longer than XPLMAX_PACKETSIZE_RECEIVE, the
+    ///        plugin is told how long strings for this DataRef can be.  The inbound handler still gets called, with inStr
+    ///        pointing to the buffer.
+    ///        Call from the registration callback after registering the DataRef, the buffers are forgotten when registering again.
+    /// @param handle Handle of the string DataRef
+    /// @param buffer Buffer for the string, it must stay valid while connected
+    /// @param bufferSize Size of buffer including the terminator
+    /// @return 0: OK, -1: all XPL_STRINGBUFFERS are in use
+    int registerStringBuffer(dref_handle handle, char *buffer, int bufferSize);
+
+    /// @brief Check whether the buffer of a string DataRef changed since the last call, for sketches that don't use the inbound handler for strings
+    /// @param handle Handle of the string DataRef
+    /// @return True once after every update
+    bool stringUpdated(dref_handle handle);
+#endif
+
+    /// @brief Hold back updates of a subscribed DataRef while a gate DataRef is false, bus voltage for instance.
+    ///        When the gate closes the inbound handler is called once with inStruct.gated set, when it opens
+    ///        again the current value is sent.  Call after requestUpdates.
+    /// @param handle Handle of the subscribed DataRef
+    /// @param gateHandle Handle of the DataRef that opens and closes the gate
+    /// @param condition XPL_GATE_GREATER, XPL_GATE_LESS, XPL_GATE_EQUAL or XPL_GATE_NOTEQUAL
+    /// @param threshold Value the gate DataRef is compared with
+    void requestGate(dref_handle handle, dref_handle gateHandle, int condition, float threshold);
+
+    /// @brief Hold back updates of a subscribed DataRef while an element of an array gate DataRef is false
+    /// @param gateElement Array element of the gate DataRef
+    void requestGate(dref_handle handle, dref_handle gateHandle, int condition, float threshold, int gateElement);
+
     /// @brief set scaling factor for a DataRef (offload mapping to the plugin)
     void setScaling(dref_handle handle, int inLow, int inHigh, int outLow, int outHigh);
 
@@ -263,9 +482,24 @@ public:
     /// @brief Request a reset from the plugin
     void sendResetRequest(void);
 
+    /// @brief Ask the plugin to hold back dataref updates to this device, for instance while registering.  X-Plane keeps running.
     void flightLoopPause(void);
+
+    /// @brief Resume updates after flightLoopPause
     void flightLoopResume(void);
 
+    /// @brief Measure loop time, time spent receiving and in the inbound handler, dropped bytes and frames,
+    ///        and report them to the plugin.  Shown per device in the plugin status window.
+    /// @param interval Reporting interval in ms, 0 to stop measuring
+    void enableStats(unsigned long interval);
+
+    /// @brief Take received bytes from a block source instead of reading the stream byte by byte.  Writes still go to the stream.
+    /// @param source Usually the same object as the stream, NULL to read the stream again
+    void setBlockSource(XPLBlockSource *source);
+
+    /// @brief The stream given to the constructor
+    Stream *stream() { return _streamPtr; }
+
     /// @brief Cyclic loop handler, must be called in idle task
     /// @return Connection status
     int xloop();
@@ -274,35 +508,123 @@ public:
     
 private:
     void _processSerial();
-    int _receiveNSerial(int inSize);
+    int _receiveBytes(const char *data, int count, int *frameDone);
+    void _receiveRaw(int length);
+    void _finishRaw();
     void _processPacket();
-    void _transmitPacket();
+    bool _transmitPacket(int length);                     // length as returned by snprintf, false if it didn't fit
     void _sendname();
     void _sendVersion();
+    void _sendFrameSize();
+    void _sendCapabilities();
     void _sendPacketVoid(int command, int handle);        // just a command with a handle
     void _sendPacketString(int command, const char *str); // send a string
     int _parseInt(int *outTarget, char *inBuffer, int parameter);
     int _parseInt(long *outTarget, char *inBuffer, int parameter);
+#if XPL_FLOATS
     int _parseFloat(float *outTarget, char *inBuffer, int parameter);
+#endif
     int _parseString(char *outBuffer, char *inBuffer, int parameter, int maxSize);
     int Xdtostrf(double val, signed char width, unsigned char prec, char* sout);
+    void _callInboundHandler();
+    void _runInboundHandler(inStruct *inData);
+#if XPL_EVENTQUEUE_SIZE
+    void _dropEvents(int handle);
+#endif
+#if XPL_STATS
+    void _sendStats();
+#endif
 
     Stream *_streamPtr;
     const char *_deviceName;
     bool _registerFlag;
     bool _connectionStatus;
+    int _pluginVersion;
+    unsigned long _pluginFeatures;  // features both sides have
     inStruct _inData;
 
-    char _sendBuffer[XPLMAX_PACKETSIZE_TRANSMIT];
-    char _receiveBuffer[XPLMAX_PACKETSIZE_RECEIVE];
-    uint8_t _receiveBufferBytesReceived;
+    char *_sendBuffer;
+    char *_receiveBuffer;
+    int _sendBufferSize;
+    int _receiveBufferSize;
+    int _receiveBufferBytesReceived;    // of the frame being received, 0 between frames
+    int _rawRemaining;                  // raw bytes still to come after a string frame
+    int _rawReceived;
+    char *_rawTarget;                   // where they go, the receive buffer or a registered string buffer
+    int _rawCapacity;
+    unsigned long _frameStartTime;      // millis() when the frame being received started
+    XPLBlockSource *_blockSource;
+    unsigned long _blockLosses;         // receiveLosses() when last looked at
 
     void (*_xplInitFunction)(void);  // this function will be called when the plugin is ready to receive binding requests
     void (*_xplStopFunction)(void);  // this function will be called with the plugin receives message or detects xplane flight model inactive
     void (*_xplInboundHandler)(inStruct *); // this function will be called when the plugin sends dataref values
+    void (*_xplCommandEventHandler)(cmd_handle, int);  // this function will be called when a command begins or ends
 
     dref_handle _handleAssignment;
+
+#if XPL_STRINGBUFFERS
+    struct XPLStringBuffer
+    {
+        dref_handle handle;
+        char *buffer;               // NULL if the entry is free
+        int size;
+        bool updated;
+    } _strings[XPL_STRINGBUFFERS];
+    XPLStringBuffer *_rawString;    // registered buffer of the string being received, or NULL
+#endif
+
+#if XPL_EVENTQUEUE_SIZE
+    inStruct _events[XPL_EVENTQUEUE_SIZE];  // ring buffer
+    int _eventFirst;
+    int _eventCount;
+    int _dispatchBudget;
+#endif
+
+#if XPL_STATS
+    struct
+    {
+        unsigned long interval;     // reporting interval in ms, 0 if not measuring
+        unsigned long lastReport;   // millis() of the last report
+        unsigned long lastLoop;     // micros() at the last xloop() call
+        unsigned long loops;        // the rest are for the current interval
+        unsigned long loopSum;      // us
+        unsigned long loopMax;      // us
+        unsigned long rxWait;       // us spent taking in received bytes
+        unsigned long callback;     // us spent in the inbound handler
+        unsigned long rxDropped;    // bytes thrown away: noise between frames, timeouts, overruns
+        unsigned long framesTx;
+        unsigned long framesRx;
+        unsigned long queueFull;    // loops that left frames in the stream for lack of room in the event queue, and values dropped for it
+    } _stats;
+#endif
+
+protected:
+    /// @brief Constructor, buffers are supplied by XPLProT
+    XPLProBase(Stream *device, char *sendBuffer, int sendBufferSize, char *receiveBuffer, int receiveBufferSize);
  
 };
 
+/// @brief XPLPro with buffer sizes chosen in the sketch.  On small boards XPLProT<100, 200> leaves more RAM for display
+///        libraries if the datarefs have short names, larger boards can take long strings in one frame.
+///        The sizes are sent to the plugin when it connects.
+template <int TransmitSize, int ReceiveSize>
+class XPLProT : public XPLProBase
+{
+    static_assert(TransmitSize >= XPLMIN_PACKETSIZE_TRANSMIT, "XPLProT transmit size is below XPLMIN_PACKETSIZE_TRANSMIT");
+    static_assert(ReceiveSize >= XPLMIN_PACKETSIZE_RECEIVE, "XPLProT receive size is below XPLMIN_PACKETSIZE_RECEIVE");
+
+public:
+    /// @brief Constructor
+    /// @param device Device to use (should be &Serial)
+    XPLProT(Stream *device) : XPLProBase(device, _transmitBuffer, TransmitSize, _receiveBufferStorage, ReceiveSize) {}
+
+private:
+    char _transmitBuffer[TransmitSize];
+    char _receiveBufferStorage[ReceiveSize];
+};
+
+/// @brief The usual configuration, buffers are XPLMAX_PACKETSIZE_TRANSMIT and XPLMAX_PACKETSIZE_RECEIVE
+typedef XPLProT<XPLMAX_PACKETSIZE_TRANSMIT, XPLMAX_PACKETSIZE_RECEIVE> XPLPro;
+
 #endif
\ No newline at end of file
@@ -0,0 +1,299 @@
+//   XPLProESP32.h - XPLPro Add-on Library to split the link and input scanning over the two ESP32 cores
+//   Created by the XPLPro contributors,  2026
+//
+//   To report problems, download updates and examples, suggest enhancements or get technical support, please visit:
+//      discord:  https://discord.gg/gzXetjEST4
+//      patreon:  www.patreon.com/curiosityworkshop
+
+// Normally xloop(), the switch/pot/mux check() calls and the displays all share loop(), so a burst of updates
+// from the plugin makes the inputs late.  With this add-on one FreeRTOS task owns the serial link and runs xloop(),
+// another one calls your scan function at a fixed rate, and loop() is left for the displays.
+//
+// Add-ons called from the scan function are given inputs() instead of the XPLPro.  It formats their writes and
+// commands into a lock-free queue and the link task sends them between its own frames, so only one task ever
+// touches the serial port.  The registration and shutdown callbacks run while the scan task is held off, so pins
+// can be added there as usual.  The inbound handler runs in the link task.
+//
+//      XPLPro XP(&Serial);
+//      XPLProESP32 XPcores(&XP);
+//      XPLSwitches switches(NULL);
+//
+//      void setup()
+//      {
+//          Serial.begin(XPL_BAUDRATE);
+//          switches.begin(XPcores.inputs());
+//          XPcores.begin("My Panel", &xplRegister, &xplShutdown, &xplInboundHandler, &scanInputs, 5);
+//      }
+//
+//      void loop()       { }                      // displays, or nothing.  Don't call XP.xloop() here.
+//      void scanInputs() { switches.check(); }    // every 5 ms on the other core
+
+#ifndef XPLProESP32_h
+#define XPLProESP32_h
+
+#ifndef ARDUINO_ARCH_ESP32
+#error XPLProESP32.h is for ESP32 boards only
+#endif
+
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+
+// Parameters around the interface
+#ifndef XPLESP32_QUEUESIZE
+    #define XPLESP32_QUEUESIZE      1024                // bytes of frames waiting to go out from the scan task, power of 2
+#endif
+
+#ifndef XPLESP32_STACKSIZE
+    #define XPLESP32_STACKSIZE      4096                // per task
+#endif
+
+#define XPLESP32_LINKPRIORITY       2                   // above loop() (1), so displays don't hold up the link
+#define XPLESP32_SCANPRIORITY       3                   // above the link, the scan is short and has to be on time
+
+
+/// @brief Lock-free queue for one writing and one reading task, used as a Stream.  Frames are taken whole or not at all.
+class XPLQueueStream : public Stream
+{
+public:
+    XPLQueueStream(void);
+
+    size_t write(uint8_t inByte);
+    size_t write(const uint8_t *inBuffer, size_t inSize);
+    using Print::write;
+
+    int available(void);
+    int read(void);
+    int peek(void);
+    void flush(void) {}
+
+    /// @brief Reader side:  send everything queued to another stream
+    /// @return Number of bytes sent
+    int forward(Stream *inStream);
+
+    /// @brief Frames thrown away because the queue was full
+    unsigned long dropped(void) { return _dropped; }
+
+private:
+    uint8_t _buffer[XPLESP32_QUEUESIZE];
+    std::atomic<unsigned int> _head;            // written by the writer only
+    std::atomic<unsigned int> _tail;            // written by the reader only
+    unsigned long _dropped;
+};
+
+/// @brief XPLPro that only sends, for the scan task.  It never receives, so it has no use for a receive buffer of the
+///        size XPLProT insists on.
+class XPLSendOnly : public XPLProBase
+{
+public:
+    XPLSendOnly(Stream *device) : XPLProBase(device, _transmitBuffer, XPLMAX_PACKETSIZE_TRANSMIT, _receiveBufferStorage, sizeof(_receiveBufferStorage)) {}
+
+private:
+    char _transmitBuffer[XPLMAX_PACKETSIZE_TRANSMIT];
+    char _receiveBufferStorage[4];
+};
+
+
+/// @brief Core class for the XPLPro ESP32 Addon
+class XPLProESP32
+{
+public:
+    /// @brief Constructor
+    /// @param xplpro The XPLPro on the serial port.  Don't call its xloop(), the link task does.
+    XPLProESP32(XPLProBase *xplpro);
+
+    /// @brief Same as XPLPro begin, then starts the tasks.
+    /// @param scanFunction Called every scanInterval ms on the scan task, call the add-on check() functions from here
+    /// @param scanInterval ms between scans
+    /// @param linkCore Core for the link task, the scan task gets the other one.  Single core chips ignore this.
+    void begin(const char *devicename, void (*initFunction)(void), void (*stopFunction)(void), void (*inboundHandler)(inStruct *),
+               void (*scanFunction)(void), unsigned long scanInterval, int linkCore = 0);
+
+    /// @brief Give this to add-ons that are checked in the scan function.  Only for writes and commands, register on the XPLPro.
+    XPLProBase* inputs(void) { return &_inputs; }
+
+    /// @brief Return connection status
+    int connectionStatus(void) { return _XP->connectionStatus(); }
+
+    /// @brief Scans that took longer than the scan interval
+    unsigned long scanOverruns(void) { return _scanOverruns; }
+
+    /// @brief Frames from the scan task thrown away because the link couldn't keep up
+    unsigned long framesDropped(void) { return _outbound.dropped(); }
+
+private:
+    static void _linkTask(void *inParameter);
+    static void _scanTask(void *inParameter);
+    static void _initTrampoline(void);
+    static void _stopTrampoline(void);
+
+    static XPLProESP32 *_instance;              // for the trampolines, there is only one serial link
+
+    XPLProBase* _XP;
+    XPLQueueStream _outbound;
+    XPLSendOnly _inputs;                        // writes into _outbound
+
+    void (*_initFunction)(void);
+    void (*_stopFunction)(void);
+    void (*_scanFunction)(void);
+    unsigned long _scanInterval;
+    volatile unsigned long _scanOverruns;
+
+    SemaphoreHandle_t _scanLock;                // held by the scan task during a scan, and around the callbacks
+};
+
+XPLProESP32 *XPLProESP32::_instance = NULL;
+
+
+XPLQueueStream::XPLQueueStream(void)
+{
+    _head = 0;
+    _tail = 0;
+    _dropped = 0;
+}
+
+size_t XPLQueueStream::write(uint8_t inByte)
+{
+    return write(&inByte, 1);
+}
+
+size_t XPLQueueStream::write(const uint8_t *inBuffer, size_t inSize)
+{
+    unsigned int head = _head.load(std::memory_order_relaxed);
+    unsigned int tail = _tail.load(std::memory_order_acquire);
+
+    if (inSize > XPLESP32_QUEUESIZE - (head - tail))
+    {
+        _dropped++;
+        return 0;
+    }
+
+    for (size_t i = 0; i < inSize; i++) _buffer[(head + i) & (XPLESP32_QUEUESIZE - 1)] = inBuffer[i];
+
+    _head.store(head + inSize, std::memory_order_release);     // the reader sees the whole frame or none of it
+    return inSize;
+}
+
+int XPLQueueStream::available(void)
+{
+    return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_relaxed);
+}
+
+int XPLQueueStream::read(void)
+{
+    unsigned int tail = _tail.load(std::memory_order_relaxed);
+
+    if (_head.load(std::memory_order_acquire) == tail) return -1;
+
+    uint8_t value = _buffer[tail & (XPLESP32_QUEUESIZE - 1)];
+    _tail.store(tail + 1, std::memory_order_release);
+    return value;
+}
+
+int XPLQueueStream::peek(void)
+{
+    unsigned int tail = _tail.load(std::memory_order_relaxed);
+
+    if (_head.load(std::memory_order_acquire) == tail) return -1;
+    return _buffer[tail & (XPLESP32_QUEUESIZE - 1)];
+}
+
+int XPLQueueStream::forward(Stream *inStream)
+{
+    unsigned int head = _head.load(std::memory_order_acquire);
+    unsigned int tail = _tail.load(std::memory_order_relaxed);
+    int count = head - tail;
+
+    while (tail != head)
+    {
+        // up to the end of the buffer, then from the start
+        unsigned int start = tail & (XPLESP32_QUEUESIZE - 1);
+        unsigned int length = XPLESP32_QUEUESIZE - start;
+        if (length > head - tail) length = head - tail;
+
+        inStream->write(&_buffer[start], length);
+        tail += length;
+    }
+
+    _tail.store(tail, std::memory_order_release);
+    return count;
+}
+
+
+XPLProESP32::XPLProESP32(XPLProBase *xplpro) : _inputs(&_outbound)
+{
+    _XP = xplpro;
+    _scanOverruns = 0;
+    _scanLock = NULL;
+}
+
+void XPLProESP32::begin(const char *devicename, void (*initFunction)(void), void (*stopFunction)(void), void (*inboundHandler)(inStruct *),
+                        void (*scanFunction)(void), unsigned long scanInterval, int linkCore)
+{
+    _instance = this;
+    _initFunction = initFunction;
+    _stopFunction = stopFunction;
+    _scanFunction = scanFunction;
+    _scanInterval = scanInterval ? scanInterval : 1;
+    _scanLock = xSemaphoreCreateMutex();
+
+    _XP->begin(devicename, &_initTrampoline, &_stopTrampoline, inboundHandler);
+
+#if portNUM_PROCESSORS > 1
+    xTaskCreatePinnedToCore(_linkTask, "XPLProLink", XPLESP32_STACKSIZE, this, XPLESP32_LINKPRIORITY, NULL, linkCore);
+    xTaskCreatePinnedToCore(_scanTask, "XPLProScan", XPLESP32_STACKSIZE, this, XPLESP32_SCANPRIORITY, NULL, linkCore ? 0 : 1);
+#else
+    xTaskCreate(_linkTask, "XPLProLink", XPLESP32_STACKSIZE, this, XPLESP32_LINKPRIORITY, NULL);
+    xTaskCreate(_scanTask, "XPLProScan", XPLESP32_STACKSIZE, this, XPLESP32_SCANPRIORITY, NULL);
+#endif
+}
+
+void XPLProESP32::_linkTask(void *inParameter)
+{
+    XPLProESP32 *me = (XPLProESP32 *)inParameter;
+
+    while (1)
+    {
+        me->_XP->xloop();
+        me->_outbound.forward(me->_XP->stream());
+
+        // let the idle task run (watchdog) when there is nothing to do, a tick is 1 ms
+        if (!me->_XP->stream()->available() && !me->_outbound.available()) vTaskDelay(1);
+    }
+}
+
+void XPLProESP32::_scanTask(void *inParameter)
+{
+    XPLProESP32 *me = (XPLProESP32 *)inParameter;
+    TickType_t lastWake = xTaskGetTickCount();
+    TickType_t period = pdMS_TO_TICKS(me->_scanInterval);
+
+    if (period == 0) period = 1;
+
+    while (1)
+    {
+        xSemaphoreTake(me->_scanLock, portMAX_DELAY);
+        me->_scanFunction();
+        xSemaphoreGive(me->_scanLock);
+
+        if (xTaskGetTickCount() - lastWake > period) me->_scanOverruns++;
+        vTaskDelayUntil(&lastWake, period);
+    }
+}
+
+void XPLProESP32::_initTrampoline(void)
+{
+    xSemaphoreTake(_instance->_scanLock, portMAX_DELAY);
+    _instance->_initFunction();
+    xSemaphoreGive(_instance->_scanLock);
+}
+
+void XPLProESP32::_stopTrampoline(void)
+{
+    xSemaphoreTake(_instance->_scanLock, portMAX_DELAY);
+    _instance->_stopFunction();
+    xSemaphoreGive(_instance->_scanLock);
+}
+
+#endif
@@ -36,7 +36,7 @@ public:
     /// @brief begin
     /// </summary>
     /// <param name="xplpro"></param>
-    void begin(XPLPro *xplpro);
+    void begin(XPLProBase *xplpro);
 
     int addPin(int inPin, byte inMode, int inHandle);
     int addPin(int inPin, byte inMode, int inHandle, int inElement);
@@ -51,7 +51,7 @@ public:
     
 private:
  
-    XPLPro* _XP;
+    XPLProBase* _XP;
   
   int _switchCount;             // how many are registered
 
@@ -84,7 +84,7 @@ XPLSwitches::XPLSwitches(void (*switchHandler)(int inSwitchID, int inValue))
 
 };
 
-void XPLSwitches::begin(XPLPro* xplpro)
+void XPLSwitches::begin(XPLProBase* xplpro)
 {
     _XP = xplpro;
     clear();
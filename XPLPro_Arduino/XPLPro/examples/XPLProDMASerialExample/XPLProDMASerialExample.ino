@@ -0,0 +1,135 @@
+
+/*
+ *
+ * XPLProDMASerialExample
+ *
+ * Receives from the plugin through a DMA circular buffer (XPLDMASerial.h) instead of an interrupt per byte, so long
+ * string frames don't keep the CPU busy.  Shows the aircraft name, a long string dataref, and lights the builtin LED
+ * with the beacon.
+ *
+ * The UART is USART2, which the ST-LINK on Nucleo boards passes on as a virtual COM port, so the plugin finds the
+ * board on the ST-LINK USB connector.  Its receive DMA channel is set up below with HAL calls, the way STM32CubeMX
+ * would generate it.  hal_conf_extra.h in this folder keeps the STM32 core from using the UART for Serial.
+ *
+ * Created by the XPLPro contributors for XPL/Pro arduino->XPlane system.
+ *
+ * This sketch was developed for a Nucleo-F401RE (STM32 core by STMicroelectronics).  On other families the DMA
+ * stream and channel for USART2 RX differ, see the DMA request mapping in the reference manual.
+ *
+   To report problems, download updates and examples, suggest enhancements or get technical support:
+
+      discord:  https://discord.gg/RacvaRFsMW
+      patreon:  www.patreon.com/curiosityworkshop
+      YouTube:  https://youtube.com/channel/UCISdHdJIundC-OSVAEPzQIQ
+ *
+ *
+ */
+
+#include <arduino.h>
+
+#include <XPLPro.h>
+#include <XPLDMASerial.h>
+
+UART_HandleTypeDef huart2;
+DMA_HandleTypeDef hdmaUsart2Rx;
+
+XPLDMASerial dmaSerial(&huart2);
+XPLPro XP(&dmaSerial);
+
+int drefAircraftName = -1;
+int drefBeacon = -1;
+char aircraftName[64];
+
+void setup()
+{
+  pinMode(LED_BUILTIN, OUTPUT);
+  digitalWrite(LED_BUILTIN, LOW);
+
+  initLink();
+  dmaSerial.begin();
+  XP.setBlockSource(&dmaSerial);            // frames are taken from the DMA buffer in blocks
+  XP.begin("XPLPro DMA Serial Example", &xplRegister, &xplShutdown, &xplInboundHandler);
+}
+
+void loop()
+{
+  XP.xloop();
+}
+
+void xplInboundHandler(inStruct *inData)
+{
+  if (inData->handle == drefBeacon) digitalWrite(LED_BUILTIN, inData->inLong ? HIGH : LOW);
+
+  if (inData->handle == drefAircraftName) XPLPro::applyString(inData, aircraftName, sizeof(aircraftName));
+}
+
+void xplShutdown()
+{
+  digitalWrite(LED_BUILTIN, LOW);
+  aircraftName[0] = 0;
+}
+
+void xplRegister()
+{
+  drefAircraftName = XP.registerDataRef(F("sim/aircraft/view/acf_ui_name"));
+  XP.requestUpdates(drefAircraftName, 1000, 0);
+
+  drefBeacon = XP.registerDataRef(F("sim/cockpit2/switches/beacon_on"));
+  XP.requestUpdates(drefBeacon, 100, 0);
+}
+
+// USART2 on PA2 (TX) and PA3 (RX), receive on DMA1 stream 5 channel 4 in circular mode
+void initLink()
+{
+  GPIO_InitTypeDef gpio = {};
+
+  __HAL_RCC_GPIOA_CLK_ENABLE();
+  __HAL_RCC_USART2_CLK_ENABLE();
+  __HAL_RCC_DMA1_CLK_ENABLE();
+
+  gpio.Pin = GPIO_PIN_2 | GPIO_PIN_3;
+  gpio.Mode = GPIO_MODE_AF_PP;
+  gpio.Pull = GPIO_PULLUP;
+  gpio.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+  gpio.Alternate = GPIO_AF7_USART2;
+  HAL_GPIO_Init(GPIOA, &gpio);
+
+  hdmaUsart2Rx.Instance = DMA1_Stream5;
+  hdmaUsart2Rx.Init.Channel = DMA_CHANNEL_4;
+  hdmaUsart2Rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+  hdmaUsart2Rx.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdmaUsart2Rx.Init.MemInc = DMA_MINC_ENABLE;
+  hdmaUsart2Rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+  hdmaUsart2Rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+  hdmaUsart2Rx.Init.Mode = DMA_CIRCULAR;                  // the DMA wraps around by itself, XPLDMASerial follows it
+  hdmaUsart2Rx.Init.Priority = DMA_PRIORITY_HIGH;
+  hdmaUsart2Rx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+  HAL_DMA_Init(&hdmaUsart2Rx);
+  __HAL_LINKDMA(&huart2, hdmarx, hdmaUsart2Rx);
+
+  huart2.Instance = USART2;
+  huart2.Init.BaudRate = XPL_BAUDRATE;
+  huart2.Init.WordLength = UART_WORDLENGTH_8B;
+  huart2.Init.StopBits = UART_STOPBITS_1;
+  huart2.Init.Parity = UART_PARITY_NONE;
+  huart2.Init.Mode = UART_MODE_TX_RX;
+  huart2.Init.HwFlowCtl = UART_HWCONTROL_NONE;
+  huart2.Init.OverSampling = UART_OVERSAMPLING_16;
+  HAL_UART_Init(&huart2);
+
+  // the HAL handles the end of each DMA lap and the idle line event here, XPLDMASerial doesn't need either
+  HAL_NVIC_SetPriority(DMA1_Stream5_IRQn, 5, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Stream5_IRQn);
+  HAL_NVIC_SetPriority(USART2_IRQn, 5, 0);
+  HAL_NVIC_EnableIRQ(USART2_IRQn);
+}
+
+extern "C" void DMA1_Stream5_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdmaUsart2Rx);
+}
+
+extern "C" void USART2_IRQHandler(void)
+{
+  HAL_UART_IRQHandler(&huart2);
+}
@@ -0,0 +1,3 @@
+// Picked up by the STM32 core from the sketch folder.  The sketch drives the UART through the HAL itself, so the
+// core must not claim it (and its interrupt handlers) for Serial.
+#define HAL_UART_MODULE_ONLY
@@ -0,0 +1,90 @@
+
+/*
+ *
+ * XPLProESP32Example
+ *
+ * Splits the work over the two cores of an ESP32:
+ *
+ *   The link task owns the serial port and runs xloop(), the inbound handler runs there.
+ *   The scan task checks the switches every 5 ms on the other core, however busy the link is.
+ *   loop() is left for the display, here just the gear unsafe light.
+ *
+ * Add-ons checked in the scan function are given XPcores.inputs() instead of &XP.  Datarefs and commands are still
+ * registered on XP, in xplRegister, which runs while the scan task is held off.
+ *
+ * Created by the XPLPro contributors for XPL/Pro arduino->XPlane system.
+ *
+ * This sketch was developed for an ESP32 DevKit, any dual core ESP32 will do.
+ *
+   To report problems, download updates and examples, suggest enhancements or get technical support:
+
+      discord:  https://discord.gg/RacvaRFsMW
+      patreon:  www.patreon.com/curiosityworkshop
+      YouTube:  https://youtube.com/channel/UCISdHdJIundC-OSVAEPzQIQ
+ *
+ *
+ */
+
+#include <arduino.h>
+
+#include <XPLPro.h>
+#include <XPLProESP32.h>
+#include <XPLSwitches.h>
+
+#define PIN_BEACON      25        // momentary switch, toggles the beacon lights with each press
+#define PIN_STARTER     26        // momentary switch, runs the starter while pressed
+#define PIN_NAV         27        // toggle switch, writes the nav lights dataref
+#define PIN_GEARUNSAFE  2         // LED, lit while the gear is in transit
+
+#define SCAN_INTERVAL   5         // ms between switch scans
+
+
+XPLPro XP(&Serial);
+XPLProESP32 XPcores(&XP);
+XPLSwitches switches(NULL);
+
+int drefGearUnsafe = -1;
+volatile int gearUnsafe = 0;      // set in the link task, shown in loop()
+
+void setup()
+{
+  pinMode(PIN_GEARUNSAFE, OUTPUT);
+
+  Serial.begin(XPL_BAUDRATE);
+  switches.begin(XPcores.inputs());         // the switches are checked on the scan task
+  XPcores.begin("XPLPro ESP32 Example", &xplRegister, &xplShutdown, &xplInboundHandler, &scanInputs, SCAN_INTERVAL);
+}
+
+void loop()
+{
+  // don't call XP.xloop() here, the link task does
+  digitalWrite(PIN_GEARUNSAFE, gearUnsafe);
+  delay(10);
+}
+
+void scanInputs()
+{
+  switches.check();                         // every SCAN_INTERVAL ms on the other core
+}
+
+void xplInboundHandler(inStruct *inData)
+{
+  if (inData->handle == drefGearUnsafe) gearUnsafe = inData->inLong;
+}
+
+void xplShutdown()
+{
+  gearUnsafe = 0;
+}
+
+void xplRegister()
+{
+  switches.clear();
+
+  switches.addPin(PIN_BEACON,  XPLSWITCHES_COMMANDTRIGGER,  XP.registerCommand(F("sim/lights/beacon_lights_toggle")));
+  switches.addPin(PIN_STARTER, XPLSWITCHES_COMMANDSTARTEND, XP.registerCommand(F("sim/engines/engage_starters")));
+  switches.addPin(PIN_NAV,     XPLSWITCHES_DATAREFWRITE,    XP.registerDataRef(F("sim/cockpit2/switches/navigation_lights_on")));
+
+  drefGearUnsafe = XP.registerDataRef(F("sim/cockpit2/annunciators/gear_unsafe"));
+  XP.requestUpdates(drefGearUnsafe, 100, 0);
+}
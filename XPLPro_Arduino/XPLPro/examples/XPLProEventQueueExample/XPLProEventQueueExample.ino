@@ -0,0 +1,102 @@
+
+/*
+ *
+ * XPLProEventQueueExample
+ *
+ * Airspeed, altitude and heading on a 16x2 I2C LCD.  Writing to an I2C display takes a few milliseconds, too long to do
+ * while frames are coming in.  With the inbound event queue xloop() only reads the frames, and the handler runs for
+ * each queued update from loop() with a time budget, so reception never waits for the display.  A value that changes
+ * again before its handler runs is simply replaced in the queue.
+ *
+ * The queue is compiled into the library:  set XPL_EVENTQUEUE_SIZE at the top of XPLPro.h (8 is plenty here).
+ *
+ * Created by the XPLPro contributors for XPL/Pro arduino->XPlane system.
+ *
+ * This sketch was developed for an Arduino Mega.
+ *
+   To report problems, download updates and examples, suggest enhancements or get technical support:
+
+      discord:  https://discord.gg/RacvaRFsMW
+      patreon:  www.patreon.com/curiosityworkshop
+      YouTube:  https://youtube.com/channel/UCISdHdJIundC-OSVAEPzQIQ
+ *
+ *
+ */
+
+#include <arduino.h>
+#include <LiquidCrystal_I2C.h>
+
+#include <XPLPro.h>
+
+#if !XPL_EVENTQUEUE_SIZE
+#error "Set XPL_EVENTQUEUE_SIZE in XPLPro.h for this example"
+#endif
+
+#define DISPATCH_MICROS   2000          // handler time per loop, the rest of the loop stays responsive
+
+
+XPLPro XP(&Serial);
+LiquidCrystal_I2C lcd(0x27, 16, 2);
+
+int drefAirspeed;
+int drefAltitude;
+int drefHeading;
+
+void setup()
+{
+  lcd.init();
+  lcd.backlight();
+
+  Serial.begin(XPL_BAUDRATE);
+  XP.begin("XPLPro Event Queue Example", &xplRegister, &xplShutdown, &xplInboundHandler);
+  XP.setDispatchBudget(0);              // xloop() only reads, the handlers run below
+}
+
+void loop()
+{
+  XP.xloop();
+  XP.dispatchFor(DISPATCH_MICROS);
+
+  // anything else the panel does goes here, it isn't held up by the display
+}
+
+void xplInboundHandler(inStruct *inData)
+{
+  char text[10];
+
+  if (inData->handle == drefAirspeed)
+  {
+    sprintf(text, "%3ldKT", (long)inData->inFloat);
+    lcd.setCursor(0, 0);
+    lcd.print(text);
+  }
+  else if (inData->handle == drefAltitude)
+  {
+    sprintf(text, "%6ldFT", (long)inData->inFloat);
+    lcd.setCursor(8, 0);
+    lcd.print(text);
+  }
+  else if (inData->handle == drefHeading)
+  {
+    sprintf(text, "HDG %03ld", (long)inData->inFloat);
+    lcd.setCursor(0, 1);
+    lcd.print(text);
+  }
+}
+
+void xplShutdown()
+{
+  lcd.clear();
+}
+
+void xplRegister()
+{
+  drefAirspeed = XP.registerDataRef(F("sim/cockpit2/gauges/indicators/airspeed_kts_pilot"));
+  XP.requestUpdates(drefAirspeed, 100, 1);              // whole knots, feet and degrees are enough
+
+  drefAltitude = XP.registerDataRef(F("sim/cockpit2/gauges/indicators/altitude_ft_pilot"));
+  XP.requestUpdates(drefAltitude, 100, 10);
+
+  drefHeading = XP.registerDataRef(F("sim/cockpit2/gauges/indicators/heading_electric_deg_mag_pilot"));
+  XP.requestUpdates(drefHeading, 100, 1);
+}
@@ -0,0 +1,116 @@
+
+
+/*
+ * 
+ * XPLProFixedPointBench
+ * 
+ * Measures what the library spends on each dataref frame, float against fixed point (requestFixedUpdates and
+ * datarefWriteFixed).  It doesn't talk to X-Plane:  the library is given a stream that plays the same frame over and
+ * over, and the results are printed on the serial monitor at 115200 baud.
+ *
+ * Created by Curiosity Workshop for XPL/Pro arduino->XPlane system.
+ * 
+ * The difference is largest on 8 bit boards (Uno, Mega, Nano), which have no floating point hardware.  Boards with an
+ * FPU may show little difference, requestUpdates is fine there.
+ * 
+   To report problems, download updates and examples, suggest enhancements or get technical support:
+  
+      discord:  https://discord.gg/RacvaRFsMW
+      patreon:  www.patreon.com/curiosityworkshop
+      YouTube:  https://youtube.com/channel/UCISdHdJIundC-OSVAEPzQIQ
+ * 
+ * 
+ */
+
+#include <arduino.h>
+
+#include <XPLPro.h>              //  include file for the X-plane direct interface 
+
+#define BENCH_PACKETS 1000
+
+// A stream that never runs dry:  reading gives the same frame again and again, writing goes nowhere
+class ReplayStream : public Stream
+{
+public:
+  const char *frame = "";
+  int pos = 0;
+
+  int available() { return 1; }
+  int read() { char c = frame[pos++]; if (!frame[pos]) pos = 0; return c; }
+  int peek() { return frame[pos]; }
+  size_t write(uint8_t c) { return 1; }
+  void flush() {}
+};
+
+ReplayStream replay;
+XPLPro XP(&replay);      // the library under test reads from the replay stream instead of the serial port
+
+long packetsHandled;
+
+void setup() 
+{
+  Serial.begin(115200);
+  while (!Serial);
+
+  XP.begin("XPLPro Fixed Point Bench", &xplRegister, &xplShutdown, &xplInboundHandler);
+
+  Serial.println("us per packet, receiving:");
+  benchReceive("  float         ", "[2,12,1234.5678]");
+  benchReceive("  float array   ", "[4,12,1234.5678,3]");
+  benchReceive("  fixed point   ", "[6,12,12345678,4,0]");
+  benchReceive("  fixed array   ", "[6,12,12345678,4,3]");
+  benchReceive("  int           ", "[1,12,1234]");
+
+  Serial.println("us per packet, sending:");
+  benchSend("  float         ", 0);
+  benchSend("  fixed point   ", 1);
+}
+
+void loop() 
+{
+}
+
+void benchReceive(const char *label, const char *frame)
+{
+  replay.frame = frame;
+  replay.pos = 0;
+  packetsHandled = 0;
+
+  unsigned long startTime = micros();
+  for (int i = 0; i < BENCH_PACKETS; i++) XP.xloop();        // one frame per call
+  unsigned long elapsed = micros() - startTime;
+
+  Serial.print(label);
+  Serial.print((float)elapsed / BENCH_PACKETS);
+  if (packetsHandled != BENCH_PACKETS) Serial.print("  (frames were lost, results are wrong)");
+  Serial.println();
+}
+
+void benchSend(const char *label, int fixed)
+{
+  float value = 1234.5678;
+
+  unsigned long startTime = micros();
+  for (int i = 0; i < BENCH_PACKETS; i++)
+  {
+    if (fixed)  XP.datarefWriteFixed(12, 12345678L, 4);
+    else        XP.datarefWrite(12, value);
+  }
+  unsigned long elapsed = micros() - startTime;
+
+  Serial.print(label);
+  Serial.println((float)elapsed / BENCH_PACKETS);
+}
+
+void xplInboundHandler(inStruct *inData)
+{
+  packetsHandled++;
+}
+
+void xplRegister()
+{
+}
+
+void xplShutdown()
+{
+}
@@ -0,0 +1,81 @@
+
+/*
+ *
+ * XPLProGatesExample
+ *
+ * Two annunciator lights that only work while the main bus has power, like the real ones.  The plugin holds back
+ * their updates while the bus is dead and tells the sketch once, so there is no need to subscribe to the bus voltage
+ * and track it here.  When the power comes back the current values are sent.
+ *
+ * Wiring:  an LED with a resistor from each pin to GND.
+ *
+ * Created by the XPLPro contributors for XPL/Pro arduino->XPlane system.
+ *
+ * This sketch was developed for an Arduino Mega.
+ *
+   To report problems, download updates and examples, suggest enhancements or get technical support:
+
+      discord:  https://discord.gg/RacvaRFsMW
+      patreon:  www.patreon.com/curiosityworkshop
+      YouTube:  https://youtube.com/channel/UCISdHdJIundC-OSVAEPzQIQ
+ *
+ *
+ */
+
+#include <arduino.h>
+
+#include <XPLPro.h>
+
+#define PIN_LOWVACUUM   22
+#define PIN_LOWVOLTAGE  23
+
+
+XPLPro XP(&Serial);
+
+int drefLowVacuum;
+int drefLowVoltage;
+
+void setup()
+{
+  pinMode(PIN_LOWVACUUM, OUTPUT);
+  pinMode(PIN_LOWVOLTAGE, OUTPUT);
+
+  Serial.begin(XPL_BAUDRATE);
+  XP.begin("XPLPro Gates Example", &xplRegister, &xplShutdown, &xplInboundHandler);
+}
+
+void loop()
+{
+  XP.xloop();
+}
+
+void xplInboundHandler(inStruct *inData)
+{
+  int pin;
+
+  if (inData->handle == drefLowVacuum)        pin = PIN_LOWVACUUM;
+  else if (inData->handle == drefLowVoltage)  pin = PIN_LOWVOLTAGE;
+  else return;
+
+  if (inData->gated) digitalWrite(pin, LOW);            // bus is dead, the value means nothing until the next update
+  else               digitalWrite(pin, inData->inLong ? HIGH : LOW);
+}
+
+void xplShutdown()
+{
+  digitalWrite(PIN_LOWVACUUM, LOW);
+  digitalWrite(PIN_LOWVOLTAGE, LOW);
+}
+
+void xplRegister()
+{
+  int drefBusVolts = XP.registerDataRef(F("sim/cockpit2/electrical/bus_volts"));
+
+  drefLowVacuum = XP.registerDataRef(F("sim/cockpit2/annunciators/low_vacuum"));
+  XP.requestUpdates(drefLowVacuum, 100, 0);
+  XP.requestGate(drefLowVacuum, drefBusVolts, XPL_GATE_GREATER, 20, 0);         // element 0 is the main bus, open above 20 volts
+
+  drefLowVoltage = XP.registerDataRef(F("sim/cockpit2/annunciators/low_voltage"));
+  XP.requestUpdates(drefLowVoltage, 100, 0);
+  XP.requestGate(drefLowVoltage, drefBusVolts, XPL_GATE_GREATER, 20, 0);
+}
@@ -0,0 +1,91 @@
+
+/*
+ * 
+ * XPLProGaugesExample
+ * 
+ * Airspeed needle on a stepper motor (step/dir driver) and a vertical speed needle on a servo.  Both follow 
+ * interpolated (value + rate) updates so they move smoothly with very little traffic.
+ *
+ * Created by Curiosity Workshop for XPL/Pro arduino->XPlane system.
+ * 
+ * This sketch was developed and tested on an Arduino Mega.
+ * 
+   To report problems, download updates and examples, suggest enhancements or get technical support:
+  
+      discord:  https://discord.gg/RacvaRFsMW
+      patreon:  www.patreon.com/curiosityworkshop
+      YouTube:  https://youtube.com/channel/UCISdHdJIundC-OSVAEPzQIQ
+ * 
+ * 
+ */
+
+#include <arduino.h>
+
+#include <XPLPro.h>
+#include <XPLInterpolator.h>
+#include <XPLGauges.h>
+
+
+#define PIN_ASI_STEP  3
+#define PIN_ASI_DIR   4
+#define PIN_ASI_HOME  5       // optical or hall sensor at the zero position, reads LOW when homed
+#define PIN_VSI_SERVO 9
+
+
+XPLPro XP(&Serial);     
+XPLInterpolator interpolator;
+XPLGauges gauges;
+
+int gaugeASI;
+int gaugeVSI;
+
+void setup() 
+{
+  Serial.begin(XPL_BAUDRATE);  
+  XP.begin("XPLPro Gauges Example", &xplRegister, &xplShutdown, &xplInboundHandler);         
+
+  pinMode(LED_BUILTIN, OUTPUT);
+  digitalWrite(LED_BUILTIN, LOW);
+
+  interpolator.begin(&XP);
+  gauges.begin(&XP, &interpolator);
+
+  gaugeASI = gauges.addStepper(-1, 0, PIN_ASI_STEP, PIN_ASI_DIR, 800, 2000);     // 800 steps/s max, 2000 steps/s/s acceleration
+  gauges.addCalibration(gaugeASI, 0,   0);              // knots -> steps.  Non-linear dials just need more points.
+  gauges.addCalibration(gaugeASI, 40,  60);
+  gauges.addCalibration(gaugeASI, 200, 540);
+  gauges.home(gaugeASI, PIN_ASI_HOME, 720);             // at most one full turn backwards to find home
+
+  gaugeVSI = gauges.addServo(-1, 0, PIN_VSI_SERVO, 1000);      // 1000 us/s slew limit
+  gauges.addCalibration(gaugeVSI, -2000, 700);          // feet per minute -> servo microseconds
+  gauges.addCalibration(gaugeVSI,  2000, 2300);
+
+}
+
+void loop() 
+{
+  XP.xloop();  
+  gauges.check();
+  gauges.run();           // for the smoothest motion also call this from a timer interrupt
+}      
+
+void xplInboundHandler(inStruct *inData)
+{
+  gauges.inbound(inData);
+}
+
+void xplShutdown()
+{
+  
+  
+}
+
+
+void xplRegister()          
+{
+  interpolator.clear();
+
+  gauges.setInterpolated(gaugeASI, interpolator.addHandle(XP.registerDataRef(F("sim/cockpit2/gauges/indicators/airspeed_kts_pilot")), 0.5));
+  gauges.setInterpolated(gaugeVSI, interpolator.addHandle(XP.registerDataRef(F("sim/cockpit2/gauges/indicators/vvi_fpm_pilot")), 20));
+ 
+}
@@ -0,0 +1,75 @@
+
+/*
+ *
+ * XPLProInterpolatorExample
+ *
+ * Engine RPM on a moving coil meter driven by PWM.  The plugin sends the RPM with its rate of change and only sends
+ * again when the extrapolated value would be off by more than 20 RPM, the interpolator fills in between so the needle
+ * moves smoothly every loop.
+ *
+ * Created by the XPLPro contributors for XPL/Pro arduino->XPlane system.
+ *
+ * This sketch was developed for an Arduino Mega, any board with a PWM pin will do.
+ *
+   To report problems, download updates and examples, suggest enhancements or get technical support:
+
+      discord:  https://discord.gg/RacvaRFsMW
+      patreon:  www.patreon.com/curiosityworkshop
+      YouTube:  https://youtube.com/channel/UCISdHdJIundC-OSVAEPzQIQ
+ *
+ *
+ */
+
+#include <arduino.h>
+
+#include <XPLPro.h>
+#include <XPLInterpolator.h>
+
+#define PIN_RPM_METER   9           // PWM pin, through a resistor to a 1 mA meter.  Full scale is 255.
+#define RPM_FULLSCALE   3000
+
+
+XPLPro XP(&Serial);
+XPLInterpolator interpolator;
+
+int itemRPM = -1;                   // interpolator item, -1 until registered
+
+void setup()
+{
+  pinMode(PIN_RPM_METER, OUTPUT);
+
+  Serial.begin(XPL_BAUDRATE);
+  XP.begin("XPLPro Interpolator Example", &xplRegister, &xplShutdown, &xplInboundHandler);
+
+  interpolator.begin(&XP);
+}
+
+void loop()
+{
+  XP.xloop();
+
+  if (itemRPM >= 0)
+  {
+    float rpm = interpolator.getValue(itemRPM);             // extrapolated from the last update, every loop
+    analogWrite(PIN_RPM_METER, constrain((int)(rpm * 255 / RPM_FULLSCALE), 0, 255));
+  }
+}
+
+void xplInboundHandler(inStruct *inData)
+{
+  interpolator.inbound(inData);                             // returns -1 for updates that aren't interpolated
+}
+
+void xplShutdown()
+{
+  itemRPM = -1;
+  analogWrite(PIN_RPM_METER, 0);
+}
+
+void xplRegister()
+{
+  interpolator.clear();
+
+  // element 0 of the array, 20 RPM tolerance
+  itemRPM = interpolator.addHandle(XP.registerDataRef(F("sim/cockpit2/engine/indicators/engine_speed_rpm")), 0, 20);
+}
@@ -0,0 +1,78 @@
+
+/*
+ *
+ * XPLProLadderSwitchesExample
+ *
+ * Two rotary selectors, each wired as a resistor ladder on one analog pin:
+ *
+ *   A magneto switch (OFF, R, L, BOTH, START) writes its position number to the ignition key dataref.
+ *   A three position HSI source selector triggers a command for each position.
+ *
+ * Wiring:  a chain of equal resistors (10k) between 5V and GND, one selector contact on each junction, the common
+ * of the selector to the analog pin.  With equal resistors the positions are evenly spaced and nothing else needs
+ * to be set, otherwise measure each position and give it to setPosition.
+ *
+ * Created by the XPLPro contributors for XPL/Pro arduino->XPlane system.
+ *
+ * This sketch was developed for an Arduino Mega.
+ *
+   To report problems, download updates and examples, suggest enhancements or get technical support:
+
+      discord:  https://discord.gg/RacvaRFsMW
+      patreon:  www.patreon.com/curiosityworkshop
+      YouTube:  https://youtube.com/channel/UCISdHdJIundC-OSVAEPzQIQ
+ *
+ *
+ */
+
+#include <arduino.h>
+
+#include <XPLPro.h>
+#include <XPLLadderSwitches.h>
+
+#define PIN_MAGNETO     A0
+#define PIN_HSISOURCE   A1
+
+
+XPLPro XP(&Serial);
+XPLLadderSwitches ladders(&ladderHandler);
+
+void setup()
+{
+  Serial.begin(XPL_BAUDRATE);
+  XP.begin("XPLPro Ladder Switches Example", &xplRegister, &xplShutdown, &xplInboundHandler);
+
+  ladders.begin(&XP);
+}
+
+void loop()
+{
+  XP.xloop();
+  ladders.check();          // takes a few microseconds, the pins are sampled in the background
+}
+
+void ladderHandler(int pin, int position)
+{
+  // called for every accepted position change, whatever the mode
+}
+
+void xplInboundHandler(inStruct *inData)
+{
+}
+
+void xplShutdown()
+{
+}
+
+void xplRegister()
+{
+  ladders.clear();
+
+  // OFF, R, L, BOTH, START are 0 to 4 for the ignition key, element 0 is the first engine
+  ladders.addPin(PIN_MAGNETO, XPLLADDER_DATAREFWRITE, XP.registerDataRef(F("sim/cockpit2/engine/actuators/ignition_key")), 0, 5);
+
+  int hsi = ladders.addPin(PIN_HSISOURCE, XPLLADDER_COMMANDTRIGGER, -1, 3);
+  ladders.setCommand(hsi, 0, XP.registerCommand(F("sim/autopilot/hsi_select_nav_1")));
+  ladders.setCommand(hsi, 1, XP.registerCommand(F("sim/autopilot/hsi_select_nav_2")));
+  ladders.setCommand(hsi, 2, XP.registerCommand(F("sim/autopilot/hsi_select_gps")));
+}
@@ -0,0 +1,96 @@
+
+/*
+ * 
+ * XPLProMatrixExample
+ * 
+ * A 4x3 keypad (transponder style) connected as a matrix.  The digit keys go to the inbound handler, 
+ * the IDENT key triggers the transponder ident command directly.
+ *
+ * Created by Curiosity Workshop for XPL/Pro arduino->XPlane system.
+ * 
+ * This sketch was developed and tested on an Arduino Mega.
+ * 
+   To report problems, download updates and examples, suggest enhancements or get technical support:
+  
+      discord:  https://discord.gg/RacvaRFsMW
+      patreon:  www.patreon.com/curiosityworkshop
+      YouTube:  https://youtube.com/channel/UCISdHdJIundC-OSVAEPzQIQ
+ * 
+ * 
+ */
+
+#include <arduino.h>
+
+#include <XPLPro.h>
+
+#define XPLMATRIX_MAXKEYS  12    //  adjust this as required for your needs.  Default is 64 if not specified
+#include <XPLMatrix.h>
+              
+
+const uint8_t rowPins[] = { 22, 23, 24, 25 };
+const uint8_t colPins[] = { 26, 27, 28 };
+
+const char keyMap[4][3] = { { '1', '2', '3' },
+                            { '4', '5', '6' },
+                            { '7', '0', '8' },      // no 8 or 9 on a transponder, use them for VFR and IDENT
+                            { 'C', 'V', 'I' } };
+
+XPLPro XP(&Serial);     
+
+void keyHandler(int row, int col, int keyValue);
+XPLMatrix keypad(&keyHandler);             // keyHandler will be called for every key change.  It can also be NULL if not needed.             
+
+void setup() 
+{
+  Serial.begin(XPL_BAUDRATE);  
+  XP.begin("XPLPro Matrix Example", &xplRegister, &xplShutdown, &xplInboundHandler);         
+
+  pinMode(LED_BUILTIN, OUTPUT);
+  digitalWrite(LED_BUILTIN, LOW);
+
+  keypad.begin(&XP, rowPins, 4, colPins, 3, true);     // true: every key has a diode so any combination can be held
+
+}
+
+void loop() 
+{
+  XP.xloop();  
+  keypad.check();
+}      
+
+void xplInboundHandler(inStruct *inData)
+{
+ 
+}
+
+void xplShutdown()
+{
+  
+  
+}
+
+
+void xplRegister()          
+{
+  keypad.clear();
+
+  keypad.addKey(3, 2, XPLMATRIX_COMMANDSTARTEND, XP.registerCommand(F("sim/transponder/transponder_ident")));
+ 
+}
+
+void keyHandler(int row, int col, int keyValue)
+{
+  if (keyValue != XPLMATRIX_PRESSED) return;
+
+  switch (keyMap[row][col])
+  {
+      case 'C' :                   
+        // clear the code being entered
+      break;
+    
+      default:
+        // add keyMap[row][col] to the code being entered
+      break;
+  }
+
+}
@@ -0,0 +1,110 @@
+/*
+ *
+ * XPLProStringBufferExample
+ *
+ * The aircraft description, up to 260 characters, scrolling along the bottom line of a 16x2 I2C LCD with the
+ * aircraft name above it.  Both strings have their own buffer registered with registerStringBuffer, so updates are
+ * written straight into them:  no copying in the inbound handler, and the description can be longer than the 200 byte
+ * receive buffer.  loop() asks stringUpdated() instead of using the inbound handler.
+ *
+ * String buffers are compiled into the library:  set XPL_STRINGBUFFERS at the top of XPLPro.h (2 for this example).
+ *
+ * Created by the XPLPro contributors for XPL/Pro arduino->XPlane system.
+ *
+ * This sketch was developed for an Arduino Mega.
+ *
+   To report problems, download updates and examples, suggest enhancements or get technical support:
+
+      discord:  https://discord.gg/RacvaRFsMW
+      patreon:  www.patreon.com/curiosityworkshop
+      YouTube:  https://youtube.com/channel/UCISdHdJIundC-OSVAEPzQIQ
+ *
+ *
+ */
+
+#include <arduino.h>
+#include <LiquidCrystal_I2C.h>
+
+#include <XPLPro.h>
+
+#if XPL_STRINGBUFFERS < 2
+#error "Set XPL_STRINGBUFFERS to 2 or more in XPLPro.h for this example"
+#endif
+
+#define LCD_COLUMNS     16
+#define SCROLL_INTERVAL 300             // ms per character
+
+
+XPLPro XP(&Serial);
+LiquidCrystal_I2C lcd(0x27, LCD_COLUMNS, 2);
+
+int drefName = -1;
+int drefDescription = -1;
+
+char aircraftName[41];                  // what acf_ui_name holds, plus the terminator
+char description[261];                  // acf_descrip
+
+int scrollPosition = 0;
+unsigned long lastScroll = 0;
+
+void setup()
+{
+  lcd.init();
+  lcd.backlight();
+
+  Serial.begin(XPL_BAUDRATE);
+  XP.begin("XPLPro String Buffer Example", &xplRegister, &xplShutdown, &xplInboundHandler);
+}
+
+void loop()
+{
+  XP.xloop();
+
+  if (XP.stringUpdated(drefName))
+  {
+    lcd.setCursor(0, 0);
+    printColumns(aircraftName);
+  }
+
+  if (XP.stringUpdated(drefDescription)) scrollPosition = 0;
+
+  if (millis() - lastScroll >= SCROLL_INTERVAL && description[0])
+  {
+    lastScroll = millis();
+
+    lcd.setCursor(0, 1);
+    printColumns(&description[scrollPosition]);
+    if (description[++scrollPosition] == 0) scrollPosition = 0;
+  }
+}
+
+// LCD_COLUMNS characters of text, padded with spaces
+void printColumns(const char *text)
+{
+  for (int i = 0; i < LCD_COLUMNS; i++)
+  {
+    if (*text) lcd.print(*text++);
+    else       lcd.print(' ');
+  }
+}
+
+void xplInboundHandler(inStruct *inData)
+{
+  // the strings are already in their buffers, nothing to do here
+}
+
+void xplShutdown()
+{
+  lcd.clear();
+}
+
+void xplRegister()
+{
+  drefName = XP.registerDataRef(F("sim/aircraft/view/acf_ui_name"));
+  XP.registerStringBuffer(drefName, aircraftName, sizeof(aircraftName));
+  XP.requestUpdates(drefName, 1000, 0);
+
+  drefDescription = XP.registerDataRef(F("sim/aircraft/view/acf_descrip"));
+  XP.registerStringBuffer(drefDescription, description, sizeof(description));
+  XP.requestUpdates(drefDescription, 1000, 0);
+}
@@ -0,0 +1,85 @@
+
+/*
+ *
+ * XPLProStringPatchesExample
+ *
+ * The first four lines of the FMS CDU on a 20x4 I2C LCD.  CDU lines are long and only a few characters change at a
+ * time, so the plugin sends patches of what changed instead of the whole line and the sketch keeps a copy of each
+ * line to apply them to.  Every 5 seconds the whole line is sent again in case a patch was lost.
+ *
+ * Created by the XPLPro contributors for XPL/Pro arduino->XPlane system.
+ *
+ * This sketch was developed for an Arduino Mega.
+ *
+   To report problems, download updates and examples, suggest enhancements or get technical support:
+
+      discord:  https://discord.gg/RacvaRFsMW
+      patreon:  www.patreon.com/curiosityworkshop
+      YouTube:  https://youtube.com/channel/UCISdHdJIundC-OSVAEPzQIQ
+ *
+ *
+ */
+
+#include <arduino.h>
+#include <LiquidCrystal_I2C.h>
+
+#include <XPLPro.h>
+
+#define CDU_LINES       4
+#define CDU_COLUMNS     24              // characters in a CDU line, the LCD shows the first 20
+#define LCD_COLUMNS     20
+
+
+XPLPro XP(&Serial);
+LiquidCrystal_I2C lcd(0x27, LCD_COLUMNS, CDU_LINES);
+
+int drefLine[CDU_LINES];
+char cduLine[CDU_LINES][CDU_COLUMNS + 1];       // board side copy of each line, patches are applied to it
+
+void setup()
+{
+  lcd.init();
+  lcd.backlight();
+
+  Serial.begin(XPL_BAUDRATE);
+  XP.begin("XPLPro String Patches Example", &xplRegister, &xplShutdown, &xplInboundHandler);
+}
+
+void loop()
+{
+  XP.xloop();
+}
+
+void xplInboundHandler(inStruct *inData)
+{
+  for (int line = 0; line < CDU_LINES; line++)
+  {
+    if (inData->handle != drefLine[line]) continue;
+
+    if (XP.applyString(inData, cduLine[line], sizeof(cduLine[line])))      // whole line or a patch, 1 if it changed
+    {
+      lcd.setCursor(0, line);
+      for (int i = 0; i < LCD_COLUMNS; i++) lcd.write(cduLine[line][i] ? cduLine[line][i] : ' ');
+    }
+    return;
+  }
+}
+
+void xplShutdown()
+{
+  lcd.clear();
+}
+
+void xplRegister()
+{
+  drefLine[0] = XP.registerDataRef(F("sim/cockpit2/radios/indicators/fms_cdu1_text_line0"));
+  drefLine[1] = XP.registerDataRef(F("sim/cockpit2/radios/indicators/fms_cdu1_text_line1"));
+  drefLine[2] = XP.registerDataRef(F("sim/cockpit2/radios/indicators/fms_cdu1_text_line2"));
+  drefLine[3] = XP.registerDataRef(F("sim/cockpit2/radios/indicators/fms_cdu1_text_line3"));
+
+  for (int line = 0; line < CDU_LINES; line++)
+  {
+    cduLine[line][0] = 0;
+    XP.requestStringPatches(drefLine[line], 100, 5000);         // no more than every 100 ms, the whole line every 5 s
+  }
+}
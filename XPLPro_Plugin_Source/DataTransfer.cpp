@@ -24,10 +24,15 @@
 
 #include "XPLProPlugin.h"
 #include "XPLDevice.h"
+#include "DeviceRegistry.h"
 
 #include "DataTransfer.h"
+#include "UpdateWorker.h"
+#include "TraceRecorder.h"
 
 #include <ctime>
+#include <math.h>
+#include <atomic>
 
 
 
@@ -39,36 +44,39 @@ long int packetsSent;
 long int packetsReceived;
 
 int validPorts = 0;
+int inboundWritesPending = 0;			// true if any binding has a staged inbound write
+int reloadRequested = 0;				// a device sent XPLCMD_RESET, reloadDevices from the flight loop
+
+const float rateClassPeriod[XPL_RATECLASSES] = { 1.f / 60, 1.f / 30, 1.f / 10, 1.f / 2 };		// seconds, fastest first
+int rateClassCount[XPL_RATECLASSES];		// subscribed bindings per class
+int fastBindingCount = 0;					// subscribed bindings read more often than XPL_RETURN_TIME
+
+DataRefGate myGates[XPLMAX_GATES];
+int gateCounter = 0;
 
 extern FILE* errlog;
 extern FILE* serialLogFile;
 extern float elapsedTime;
-extern int lastRefSent;
-extern int lastRefElementSent;
+extern std::atomic<int> lastRefSent;
+extern std::atomic<int> lastRefElementSent;
 
 
 CommandBinding myCommands[XPL_MAXCOMMANDS_PC];
 DataRefBinding myBindings[XPL_MAXDATAREFS_PC];
-XPLDevice* myXPLDevices[XPLDEVICES_MAXDEVICES];
+DeviceRegistry myXPLDevices;
+
+static int _commandEvent(XPLMCommandRef inCommand, XPLMCommandPhase inPhase, void* inRefcon);
 
 /**************************************************************************************/
 /* disengage -- unregister all datarefs and close all com ports                       */
 /**************************************************************************************/
 void disengageDevices(void)
 {
+	updateWorkerStop();				// before anything it writes to goes away
+	traceBindingsChanged();
 	sendExitMessage();
 
-	for (int i = 0; i < XPLDEVICES_MAXDEVICES; i++)
-	{
-
-		if (myXPLDevices[i])
-		{
-			myXPLDevices[i]->port->shutDown();
-			delete myXPLDevices[i]->port;
-			delete myXPLDevices[i];
-			myXPLDevices[i] = NULL;
-		}
-	}
+	myXPLDevices.clear();			// closes the ports
 
 	validPorts = 0;
 
@@ -79,10 +87,23 @@ void disengageDevices(void)
 		myBindings[i].Handle = -1;
 		myBindings[i].scaleFlag = 0;
 
+		myBindings[i].drActive = 0;
 		for (int j = 0; j < XPLMAX_ELEMENTS; j++)
 		{
 			myBindings[i].readFlag[j] = 0;
+			myBindings[i].drFlag[j] = 0;
+			myBindings[i].pendingFlag[j] = 0;
+			myBindings[i].echoFlag[j] = 0;
+			myBindings[i].fixedDecimals[j] = -1;
 		}
+		myBindings[i].writesReceived = 0;
+		myBindings[i].writesFolded = 0;
+		myBindings[i].rateClass = -1;
+		myBindings[i].gate = -1;
+		myBindings[i].gatedMarkerSent = 0;
+		myBindings[i].touch = 0;
+		myBindings[i].stringDiff = 0;
+		myBindings[i].currentSentLength = -1;
 		
 		XPLMUnregisterDataAccessor(myBindings[i].xplaneDataRefHandle);  // deregister with xplane
 		myBindings[i].xplaneDataRefTypeID = 0;
@@ -96,9 +117,15 @@ void disengageDevices(void)
 	}
 
 	refHandleCounter = 0;
+	inboundWritesPending = 0;
+	for (int i = 0; i < XPL_RATECLASSES; i++) rateClassCount[i] = 0;
+	fastBindingCount = 0;
+	gateCounter = 0;
 
 	for (int i = 0; i < cmdHandleCounter; i++)
 	{
+		if (myCommands[i].eventsRequested) XPLMUnregisterCommandHandler(myCommands[i].xplaneCommandHandle, _commandEvent, 1, (void*)(intptr_t)i);
+		myCommands[i].eventsRequested = 0;
 		myCommands[i].deviceIndex = -1;
 		myCommands[i].bindingActive = 0;
 		myCommands[i].Handle = -1;
@@ -119,6 +146,7 @@ void engageDevices(void)
 {
 	fprintf(errlog, "engageDevices: started...\n");
 	findDevices();
+	if (validPorts) updateWorkerStart();
 	activateDevices();
 	//_updateDataRefs(1);				// 1 represents to force updates to the devices
 	//sendRefreshRequest();
@@ -127,163 +155,367 @@ void engageDevices(void)
 
 /**************************************************************************************/
 /* _updateDataRefs -- get current dataref values for all registered datarefs          */
+/*    Only the reads happen here, the worker thread diffs, formats and sends them     */
 /**************************************************************************************/
 void _updateDataRefs(int forceUpdate)
 {
+	DataRefSnapshot* snapshot = updateWorkerSnapshot();
+	DataRefSample* sample;
+	int tempInt[XPLMAX_ELEMENTS];
 
-	int newVall;
-	float newValf;
-	double newValD;
-
-	char   writeBuffer[XPLMAX_PACKETSIZE];
-	char   stringBuffer[XPLMAX_PACKETSIZE - 5];
+	if (!snapshot) return;
 
+	snapshot->count = 0;
+	snapshot->time = elapsedTime;
+	snapshot->strings.clear();
 
+	_updateGates();
 
 	for (int i = 0; i < refHandleCounter; i++)
 	{
-		if (myBindings[i].bindingActive && myBindings[i].readFlag[0])					// todo:  this needs to check all possible readFlags
-		{
-			
-		//	if (elapsedTime - myXPLDevices[myBindings[i].deviceIndex].lastSendTime < myXPLDevices[myBindings[i].deviceIndex].minTimeBetweenFrames/1000 && !forceUpdate)
-	//			break;
-			if (myBindings[i].xplaneDataRefTypeID & xplmType_Int)						// process for datarefs of type int
-			{
-				newVall = (long int)XPLMGetDatai(myBindings[i].xplaneDataRefHandle);
-				
-				if (newVall != myBindings[i].currentSentl[0] || forceUpdate)
-				{
-					lastRefSent = i;
-					myBindings[i].currentSentl[0] = newVall;
-					sprintf_s(writeBuffer, XPLMAX_PACKETSIZE, ",%i,%ld", i, newVall);
-					myXPLDevices[myBindings[i].deviceIndex]->_writePacket(XPLCMD_DATAREFUPDATEINT, writeBuffer);
-					myXPLDevices[myBindings[i].deviceIndex]->lastSendTime = elapsedTime;
+		int force = forceUpdate;
+		XPLDevice* device;
 
-						//   fprintf(errlog, "using packet: %s\r\n", writeBuffer);
+		if (!myBindings[i].bindingActive || myBindings[i].rateClass < 0) continue;
 
-				}
+		device = myXPLDevices.find(myBindings[i].deviceIndex);							// once per binding, used for the rest of it
+		if (!device || device->isRegistering()) continue;								// catches up on resume
 
-			}
-			
-			if (myBindings[i].xplaneDataRefTypeID & xplmType_IntArray)						// process for datarefs of type int Array
+		if (myBindings[i].gate >= 0)
+		{
+			if (!myGates[myBindings[i].gate].open)
 			{
-				for (int j = 0; j < XPLMAX_ELEMENTS; j++)				// todo, this method should be something better
+				if (!myBindings[i].gatedMarkerSent)									// just closed, tell the device once
 				{
-					XPLMGetDatavi(myBindings[i].xplaneDataRefHandle, &newVall, j, 1);
-					if (myBindings[i].precision)  newVall = ((int)(newVall / myBindings[i].precision) * myBindings[i].precision);
-					if (newVall != myBindings[i].currentSentl[j] || forceUpdate)
-					{
-						lastRefSent = i;
-						lastRefElementSent = j;
-						myBindings[i].currentSentl[j] = newVall;
-						sprintf_s(writeBuffer, XPLMAX_PACKETSIZE, ",%i,%ld,%i", i, newVall,j);
-						myXPLDevices[myBindings[i].deviceIndex]->_writePacket(XPLCMD_DATAREFUPDATEINTARRAY, writeBuffer);
-						myXPLDevices[myBindings[i].deviceIndex]->lastSendTime = elapsedTime;
-
-						//   fprintf(errlog, "using packet: %s\r\n", writeBuffer);
-					}
+					sample = &snapshot->samples[snapshot->count++];
+					sample->binding = i;
+					sample->deviceIndex = myBindings[i].deviceIndex;
+					sample->gated = 1;
+					myBindings[i].gatedMarkerSent = 1;
 				}
+				continue;
 			}
-				
-				
-			if (myBindings[i].xplaneDataRefTypeID & xplmType_Float)						// process for datarefs of type float
+
+			if (myBindings[i].gatedMarkerSent)										// just opened, send a fresh value now
 			{
+				myBindings[i].gatedMarkerSent = 0;
+				force = 1;
+			}
+		}
 
-				newValf = (float)XPLMGetDataf(myBindings[i].xplaneDataRefHandle);
+		if (myBindings[i].touch)
+		{
+			myBindings[i].touch = 0;
+			force = 1;
+		}
 
-					// fprintf(errlog, "updating dataRef %s with value %f...\r\n  ", myBindings[i].xplaneDataRefName, newValf);
-				if (myBindings[i].precision)  newValf = ((int)(newValf / myBindings[i].precision) * myBindings[i].precision);
+		if (!force)
+		{
+			float period = myBindings[i].samplePeriod;
 
-				if (newValf != myBindings[i].currentSentf[0] || forceUpdate)
-				{
-					lastRefSent = i;
-					myBindings[i].currentSentf[0] = newValf;
-					sprintf_s(writeBuffer, XPLMAX_PACKETSIZE, ",%i,%f", i, newValf);
-					myXPLDevices[myBindings[i].deviceIndex]->_writePacket(XPLCMD_DATAREFUPDATEFLOAT, writeBuffer);
-					myXPLDevices[myBindings[i].deviceIndex]->lastSendTime = elapsedTime;
+			if (elapsedTime < myBindings[i].nextSample) continue;					// not due this frame
 
-						//   	   fprintf(errlog, "using packet: %s\r\n", writeBuffer);
+			myBindings[i].nextSample += period;										// stay on the same phase, skip periods we missed
+			if (myBindings[i].nextSample <= elapsedTime) myBindings[i].nextSample += period * (int)((elapsedTime - myBindings[i].nextSample) / period + 1);
+		}
 
-				}
-				
-			}
+		if (myBindings[i].drActive) _updateDeadReckoning(device, i, force);		// value + rate elements, the rest below
 
+		int whole = myBindings[i].readFlag[0] && myBindings[i].fixedDecimals[0] < 0;	// subscribed without an element, all of an array goes
+		int wanted[XPLMAX_ELEMENTS];
+		int anyWanted = 0;
 
-			if (myBindings[i].xplaneDataRefTypeID & xplmType_FloatArray)						// process for datarefs of type float (array)
-			{
-				
+		for (int j = 0; j < XPLMAX_ELEMENTS; j++)
+		{
+			wanted[j] = (myBindings[i].readFlag[j] || myBindings[i].fixedDecimals[j] >= 0 || whole) && !myBindings[i].drFlag[j];
+			anyWanted |= wanted[j];
+		}
+		if (!anyWanted) continue;												// all dead reckoned, or nothing subscribed
 
-				for (int j = 0; j < XPLMAX_ELEMENTS; j++)
-				{
-					XPLMGetDatavf(myBindings[i].xplaneDataRefHandle, &newValf, j, 1);
-					if (myBindings[i].precision)  newValf = ((int)(newValf / myBindings[i].precision) * myBindings[i].precision);
-					
-					if (newValf != myBindings[i].currentSentf[j] || forceUpdate)
-					{
-						lastRefSent = i;
-						lastRefElementSent = j;
-						myBindings[i].currentSentf[j] = newValf;
-						sprintf_s(writeBuffer, XPLMAX_PACKETSIZE, ",%i,%f,%i", i, newValf,j);
-						myXPLDevices[myBindings[i].deviceIndex]->_writePacket(XPLCMD_DATAREFUPDATEFLOATARRAY, writeBuffer);
-						myXPLDevices[myBindings[i].deviceIndex]->lastSendTime = elapsedTime;
-
-						//  fprintf(errlog, "using packet: %s\r\n", writeBuffer);
-
-					}
-				}
+		sample = &snapshot->samples[snapshot->count++];
+		sample->binding = i;
+		sample->deviceIndex = myBindings[i].deviceIndex;
+		sample->type = myBindings[i].xplaneDataRefTypeID;
+		sample->precision = myBindings[i].precision;
+		sample->forceUpdate = force;
+		sample->gated = 0;
 
-			}
-			
-			if (myBindings[i].xplaneDataRefTypeID & xplmType_Double)						// process for datarefs of type double
-			{
+		for (int j = 0; j < XPLMAX_ELEMENTS; j++)
+		{
+			sample->readFlag[j] = wanted[j];
+			sample->echoFlag[j] = myBindings[i].echoFlag[j];
+			sample->echol[j] = myBindings[i].echol[j];
+			sample->echof[j] = myBindings[i].echof[j];
+			sample->echoFixed[j] = myBindings[i].echoFixed[j];
+			sample->fixedDecimals[j] = myBindings[i].fixedDecimals[j];
+			myBindings[i].echoFlag[j] = 0;
+		}
+
+		if (sample->type & xplmType_Int)		sample->l[0] = XPLMGetDatai(myBindings[i].xplaneDataRefHandle);
+		if (sample->type & xplmType_Float)		sample->f[0] = XPLMGetDataf(myBindings[i].xplaneDataRefHandle);
+		if (sample->type & xplmType_Double)		sample->d = XPLMGetDatad(myBindings[i].xplaneDataRefHandle);
+		if (sample->type & xplmType_FloatArray)	XPLMGetDatavf(myBindings[i].xplaneDataRefHandle, sample->f, 0, XPLMAX_ELEMENTS);
 
-				newValD = (double)XPLMGetDatad(myBindings[i].xplaneDataRefHandle);
+		if (sample->type & xplmType_IntArray)
+		{
+			XPLMGetDatavi(myBindings[i].xplaneDataRefHandle, tempInt, 0, XPLMAX_ELEMENTS);
+			for (int j = 0; j < XPLMAX_ELEMENTS; j++) sample->l[j] = tempInt[j];
+		}
 
-					// fprintf(errlog, "updating dataRef %s with value %f...\r\n  ", myBindings[i].xplaneDataRefName, newValf);
-				if (myBindings[i].precision)  newValD = ((int)(newValD / myBindings[i].precision) * myBindings[i].precision);
+		if (sample->type & xplmType_Data)										// into the snapshot's string store, only as much as the device takes
+		{
+			int maxLength = myBindings[i].stringLimit ? myBindings[i].stringLimit : device->maxFrameSize - 5;
 
-				if (newValD != myBindings[i].currentSentD[0] || forceUpdate)
-				{
-					lastRefSent = i;
-					myBindings[i].currentSentD[0] = newValD;
-					sprintf_s(writeBuffer, XPLMAX_PACKETSIZE, ",%i,%f", i, newValD);
-					myXPLDevices[myBindings[i].deviceIndex]->_writePacket(XPLCMD_DATAREFUPDATEFLOAT, writeBuffer);
-					myXPLDevices[myBindings[i].deviceIndex]->lastSendTime = elapsedTime;
+			sample->strOffset = (int)snapshot->strings.size();
+			snapshot->strings.resize(sample->strOffset + maxLength);
+			sample->strLength = XPLMGetDatab(myBindings[i].xplaneDataRefHandle, &snapshot->strings[sample->strOffset], 0, maxLength);
+			if (sample->strLength < 0) sample->strLength = 0;
+			snapshot->strings.resize(sample->strOffset + sample->strLength);
+		}
 
-						//   	   fprintf(errlog, "using packet: %s\r\n", writeBuffer);
+	}
 
-				}
-					
-			}
+	traceRecord(snapshot);
+	updateWorkerPublish();
 
-			if (myBindings[i].xplaneDataRefTypeID & xplmType_Data)						// process for datarefs of type Data (strings)
-			{
+}
 
-				newVall = (long int)XPLMGetDatab(myBindings[i].xplaneDataRefHandle, stringBuffer, 0, XPLMAX_PACKETSIZE - 5);
-					//stringBuffer[newVall] = 0;		// null terminate
-					//   fprintf(errlog, "updating dataRef %s with value %i...\r\n  ", myBindings[i].xplaneDataRefName, newVall);
+/*
+	_scheduleBinding -- put a subscription in the slowest rate class that is still at least as fast as its updateRate, and
+		give it a phase within the class period so reads and serial bursts are spread over the frames instead of all
+		landing on one.  The binding is then read every updateRate from its phase (never faster than the fastest class).
+		A rate of 0 asks for nothing in particular and is read every XPL_RETURN_TIME, as before there were rate classes.
+ */
+void _scheduleBinding(int i)
+{
+	int rateClass = 0;
+	float rate = myBindings[i].updateRate > 0 ? myBindings[i].updateRate / 1000.f : (float)XPL_RETURN_TIME;
 
-				if (memcmp(myBindings[i].currentSents[0], stringBuffer, newVall) || forceUpdate)
-				{
-					lastRefSent = i;
-					memcpy(myBindings[i].currentSents[0], stringBuffer, newVall);
-					sprintf(writeBuffer, ",%i,", i);
-					
-					memcpy(&writeBuffer[3], stringBuffer, newVall);
-					myXPLDevices[myBindings[i].deviceIndex]->_writePacketN(XPLCMD_DATAREFUPDATESTRING, writeBuffer, newVall + 3);
-					myXPLDevices[myBindings[i].deviceIndex]->lastSendTime = elapsedTime;
-
-					//	fprintf(errlog, "Updating dataref %s with packet: %s length: %i\r\n", myBindings[i].xplaneDataRefName, writeBuffer, newVall);
-					
-					
-				}
+	for (int c = 0; c < XPL_RATECLASSES; c++)			// fastest first
+		if (rateClassPeriod[c] <= rate) rateClass = c;
 
-			}
+	if (myBindings[i].rateClass >= 0)									// subscribed again, another element perhaps
+	{
+		rateClassCount[myBindings[i].rateClass]--;
+		if (myBindings[i].samplePeriod < XPL_RETURN_TIME) fastBindingCount--;
+	}
+	rateClassCount[rateClass]++;
+	myBindings[i].rateClass = rateClass;
+
+	myBindings[i].samplePeriod = rate > rateClassPeriod[rateClass] ? rate : rateClassPeriod[rateClass];
+	if (myBindings[i].samplePeriod < XPL_RETURN_TIME) fastBindingCount++;
+
+	myBindings[i].nextSample = elapsedTime + rateClassPeriod[rateClass] * (float)fmod(i * XPL_PHASE_STEP, 1.);
+
+}
+
+/*
+	_findGate -- gates are shared by every binding with the same gate dataref, element and condition
+ */
+int _findGate(int gateBinding, int element, int condition, float threshold)
+{
+	for (int i = 0; i < gateCounter; i++)
+	{
+		if (myGates[i].binding == gateBinding && myGates[i].element == element
+			&& myGates[i].condition == condition && myGates[i].threshold == threshold) return i;
+	}
+
+	if (gateCounter >= XPLMAX_GATES) return -1;
+
+	myGates[gateCounter].binding = gateBinding;
+	myGates[gateCounter].element = element;
+	myGates[gateCounter].condition = condition;
+	myGates[gateCounter].threshold = threshold;
+	myGates[gateCounter].open = 1;
+
+	return gateCounter++;
+}
+
+/*
+	_updateGates -- evaluate each gate once per frame, however many bindings it gates
+ */
+void _updateGates(void)
+{
+	double value;
+
+	for (int i = 0; i < gateCounter; i++)
+	{
+		if (!myBindings[myGates[i].binding].bindingActive)
+		{
+			myGates[i].open = 1;
+			continue;
 		}
 
+		value = _getDataRefValue(myGates[i].binding, myGates[i].element);
+
+		switch (myGates[i].condition)
+		{
+		case XPLGATE_GREATER:	myGates[i].open = value > myGates[i].threshold;		break;
+		case XPLGATE_LESS:		myGates[i].open = value < myGates[i].threshold;		break;
+		case XPLGATE_EQUAL:		myGates[i].open = value == myGates[i].threshold;	break;
+		case XPLGATE_NOTEQUAL:	myGates[i].open = value != myGates[i].threshold;	break;
+		default:				myGates[i].open = 1;								break;
+		}
 	}
+}
 
+/*
+	_flightLoopInterval -- every frame if anything asked for updates faster than XPL_RETURN_TIME, otherwise XPL_RETURN_TIME
+ */
+float _flightLoopInterval(void)
+{
+	if (fastBindingCount > 0) return -1;
 
+	return (float)XPL_RETURN_TIME;
+}
+
+/*
+	_updateDeadReckoning -- send value + rate for elements where the device's extrapolation has drifted past the tolerance
+ */
+void _updateDeadReckoning(XPLDevice* device, int i, int forceUpdate)
+{
+	char   writeBuffer[XPLMAX_PACKETSIZE];
+	double newVal;
+	double predicted;
+	float  dt;
+	float  sinceSent;
+
+	for (int j = 0; j < XPLMAX_ELEMENTS; j++)
+	{
+		if (!myBindings[i].drFlag[j]) continue;
+
+		newVal = _getDataRefValue(i, j);
+
+		if (myBindings[i].drSampleTime[j] < 0)								// first sample, nothing to estimate a rate from yet
+		{
+			myBindings[i].drSampleRate[j] = 0;
+			forceUpdate = 1;
+		}
+		else
+		{
+			dt = elapsedTime - myBindings[i].drSampleTime[j];
+			if (dt > 0) myBindings[i].drSampleRate[j] += XPL_DR_SMOOTHING * ((newVal - myBindings[i].drSampleValue[j]) / dt - myBindings[i].drSampleRate[j]);
+		}
+		myBindings[i].drSampleValue[j] = newVal;
+		myBindings[i].drSampleTime[j] = elapsedTime;
+		traceRecordValue(i, j, newVal);
+
+		// this is what the device is currently displaying, if it extrapolates like it should.  It holds the value once
+		// it has extrapolated for XPL_DR_MAXEXTRAPOLATION, so a needle that keeps moving after that gets a new update.
+		sinceSent = elapsedTime - myBindings[i].drSentTime[j];
+		if (sinceSent > XPL_DR_MAXEXTRAPOLATION) sinceSent = XPL_DR_MAXEXTRAPOLATION;
+		predicted = myBindings[i].drSentValue[j] + myBindings[i].drSentRate[j] * sinceSent;
+
+		if (fabs(predicted - newVal) > myBindings[i].drTolerance || forceUpdate)
+		{
+			lastRefSent = i;
+			lastRefElementSent = j;
+			myBindings[i].drSentValue[j] = newVal;
+			myBindings[i].drSentRate[j] = myBindings[i].drSampleRate[j];
+			myBindings[i].drSentTime[j] = elapsedTime;
+			myBindings[i].currentSentf[j] = (float)newVal;			// for the status window
+			myBindings[i].currentSentl[j] = (long)newVal;
+
+			sprintf_s(writeBuffer, XPLMAX_PACKETSIZE, ",%i,%f,%f,%i", i, newVal, myBindings[i].drSampleRate[j], j);
+			device->_writePacket(XPLCMD_DATAREFUPDATERATE, writeBuffer);
+			device->lastSendTime = elapsedTime;
+		}
+	}
+}
+
+/*
+	_getDataRefValue -- read a numeric dataref (or array element) as double regardless of its type
+ */
+double _getDataRefValue(int i, int element)
+{
+	int   vali;
+	float valf;
+
+	if (myBindings[i].xplaneDataRefTypeID & xplmType_Double)		return XPLMGetDatad(myBindings[i].xplaneDataRefHandle);
+	if (myBindings[i].xplaneDataRefTypeID & xplmType_Float)			return XPLMGetDataf(myBindings[i].xplaneDataRefHandle);
+	if (myBindings[i].xplaneDataRefTypeID & xplmType_Int)			return XPLMGetDatai(myBindings[i].xplaneDataRefHandle);
+
+	if (myBindings[i].xplaneDataRefTypeID & xplmType_FloatArray)
+	{
+		XPLMGetDatavf(myBindings[i].xplaneDataRefHandle, &valf, element, 1);
+		return valf;
+	}
+
+	if (myBindings[i].xplaneDataRefTypeID & xplmType_IntArray)
+	{
+		XPLMGetDatavi(myBindings[i].xplaneDataRefHandle, &vali, element, 1);
+		return vali;
+	}
+
+	return 0;
+}
+
+/*
+	_applyInboundWrites -- set datarefs written by devices during the receive pass, once per binding and element with the latest value.
+		Some aircraft have expensive custom setters, so a pot sending several values in one frame only costs one set.
+ */
+void _applyInboundWrites(void)
+{
+	if (!inboundWritesPending) return;
+
+	for (int i = 0; i < refHandleCounter; i++)
+	{
+		for (int j = 0; j < XPLMAX_ELEMENTS; j++)
+		{
+			if (!myBindings[i].pendingFlag[j]) continue;
+
+			myBindings[i].pendingFlag[j] = 0;
+
+			if (j == 0)
+			{
+				if (myBindings[i].xplaneDataRefTypeID & xplmType_Int)		XPLMSetDatai(myBindings[i].xplaneDataRefHandle, myBindings[i].pendingl[0]);
+				if (myBindings[i].xplaneDataRefTypeID & xplmType_Float)		XPLMSetDataf(myBindings[i].xplaneDataRefHandle, myBindings[i].pendingf[0]);
+				if (myBindings[i].xplaneDataRefTypeID & xplmType_Double)	XPLMSetDatad(myBindings[i].xplaneDataRefHandle, myBindings[i].pendingf[0]);
+			}
+
+			if (myBindings[i].xplaneDataRefTypeID & xplmType_IntArray)
+			{
+				int tempInt = myBindings[i].pendingl[j];
+				XPLMSetDatavi(myBindings[i].xplaneDataRefHandle, &tempInt, j, 1);
+			}
+
+			if (myBindings[i].xplaneDataRefTypeID & xplmType_FloatArray)	XPLMSetDatavf(myBindings[i].xplaneDataRefHandle, &myBindings[i].pendingf[j], j, 1);
+		}
+	}
+
+	inboundWritesPending = 0;
+}
+
+/*
+	_commandEvent -- X-Plane command handler for commands a device asked to hear about.  Runs on the sim thread,
+	_writePacket holds the write lock.  Always lets the command through.
+ */
+static int _commandEvent(XPLMCommandRef inCommand, XPLMCommandPhase inPhase, void* inRefcon)
+{
+	int i = (int)(intptr_t)inRefcon;
+
+	if (inPhase == xplm_CommandContinue) return 1;
+	if (i < 0 || i >= cmdHandleCounter || !myCommands[i].bindingActive) return 1;
+
+	XPLDevice* device = myXPLDevices.find(myCommands[i].deviceIndex);
+	if (!device) return 1;
+
+	char packet[XPLMAX_PACKETSIZE];
+	sprintf_s(packet, XPLMAX_PACKETSIZE, ",%i,%i", i, (int)inPhase);
+	device->_writePacket(XPLCMD_COMMANDEVENT, packet);
+
+	return 1;
+}
+
+/*
+	_subscribeCommandEvents -- register the command handler once, it is removed in disengageDevices.
+ */
+void _subscribeCommandEvents(int commandIndex)
+{
+	if (myCommands[commandIndex].eventsRequested) return;
+
+	XPLMRegisterCommandHandler(myCommands[commandIndex].xplaneCommandHandle, _commandEvent, 1, (void*)(intptr_t)commandIndex);
+	myCommands[commandIndex].eventsRequested = 1;
 }
 
 /*
@@ -318,62 +550,64 @@ void activateDevices(void)
 	
 	fprintf(errlog, "XPLPro:  Activating Devices... \n");
 
-	for (int i = 0; i < XPLDEVICES_MAXDEVICES; i++)
+	for (int i = 0; i < myXPLDevices.count(); i++)
 	{
-		if (!myXPLDevices[i]) break;
+		XPLDevice* device = myXPLDevices.at(i);
 
-		fprintf(errlog, "Requesting dataRef or Command registrations from port %s on device [%i]: %s\n", myXPLDevices[i]->port->portName, i, myXPLDevices[i]->deviceName);
-		myXPLDevices[i]->_writePacket(XPLCMD_SENDREQUEST, "");
+		fprintf(errlog, "Requesting dataRef or Command registrations from port %s on device [%i]: %s\n", device->port->portName, device->referenceID(), device->deviceName);
+		device->_writePacket(XPLCMD_SENDREQUEST, "");
 				
 	}
 	
 }
 
 /*
-   findDevices -- Scan for XPLPro devices and fills array with active devices
+   findDevices -- Scan for XPLPro devices and adds the ones that answer to the device registry
 */
 
 int findDevices(void)
 {
 	time_t startTime;
 	serialClass* port;
+	XPLDevice* device;
+	char writeBuffer[XPLMAX_PACKETSIZE];
 	validPorts = 0;
 
 	fprintf(errlog, "Searching Com Ports... ");
 
 	for (UINT i = 1; i < 256; i++)
 	{
+		if (myXPLDevices.findPort(i)) continue;			// already connected
+
 		port = new serialClass;
 		
 		if (port->begin(i) == i)
 		{
 
 			fprintf(errlog, "\nFound valid port %s.  Attemping poll for XPLPro device... ", port->portName);
-			myXPLDevices[validPorts] = new XPLDevice(validPorts);
-			myXPLDevices[validPorts]->port = port;
+			device = myXPLDevices.add(port, i);
 
-			if (myXPLDevices[validPorts]->_writePacket(XPLCMD_SENDNAME, ""))
+			sprintf_s(writeBuffer, XPLMAX_PACKETSIZE, ",%i,%lu", XPL_PROTOCOL_VERSION, (unsigned long)XPL_FEATURES);
+			if (device->_writePacket(XPLCMD_SENDNAME, writeBuffer))
 				fprintf(errlog, "Valid write operation, seems OK\n");
 
 
 			startTime = time(NULL);
 
-			while (difftime(time(NULL), startTime) < XPL_TIMEOUT_SECONDS && !myXPLDevices[validPorts]->isActive())	_processSerial();
+			while (difftime(time(NULL), startTime) < XPL_TIMEOUT_SECONDS && !device->isActive())	_processSerial();
 
-			if (!myXPLDevices[validPorts]->isActive())
+			if (!device->isActive())
 			{
 				fprintf(errlog, "No response after %i seconds\n", XPL_TIMEOUT_SECONDS);
 				XPLMDebugString(".");
-				port->shutDown();
-				delete myXPLDevices[validPorts];
-				delete port;
-				//myXPLDevices[validPorts]->comPortName[0] = 0;
+				myXPLDevices.remove(device->referenceID());		// closes the port
 			}
 
 			else
 			{
-				myXPLDevices[validPorts]->readBuffer[0] = '\0';
-				fprintf(errlog, "   Device [%i] on %s identifies as an XPLPro device named: %s\n", validPorts, port->portName, myXPLDevices[validPorts]->deviceName);
+				device->readBuffer[0] = '\0';
+				fprintf(errlog, "   Device [%i] on %s identifies as an XPLPro device named: %s\n", device->referenceID(), port->portName, device->deviceName);
+				fprintf(errlog, "   Protocol version %i, features in use: 0x%lx\n", device->protocolVersion, device->features);
 
 				validPorts++;
 			}
@@ -388,25 +622,43 @@ int findDevices(void)
 	}
 	
 
-	//delete myXPLDevices[validPorts];
 	XPLMDebugString("  Done Searching Com Ports\n");
 	fprintf(errlog, "Total of %i compatible devices were found.  \n\n", validPorts);
 	return 0;
 }
 
 
+/*
+	_processSerial -- a few packets from each device in turn so a chatty device can't hold up the others.
+		The device served first rotates every call.
+*/
 void _processSerial()
 {
-	int port = 0;
+	static int firstDevice = 0;
+	int deviceCount = myXPLDevices.count();
+	int busy;
+
+	if (!deviceCount) return;
+
+	if (firstDevice >= deviceCount) firstDevice = 0;
 
-	while (myXPLDevices[port] && port < XPLDEVICES_MAXDEVICES)
+	for (int round = 0; round < XPL_MAX_ROUNDS; round++)
 	{
-		//fprintf(errlog, "working on xpldevice %i ...", port);
+		busy = 0;
 
-		myXPLDevices[port]->processSerial();
+		for (int n = 0; n < deviceCount; n++)
+		{
+			int port = (firstDevice + n) % deviceCount;
+
+			//fprintf(errlog, "working on xpldevice %i ...", port);
 
-		port++;
+			if (myXPLDevices.at(port)->processSerial(XPL_PACKETS_PER_ROUND) == XPL_PACKETS_PER_ROUND) busy = 1;
+		}
+
+		if (!busy) break;				// everyone is drained
 	}
+
+	firstDevice = (firstDevice + 1) % deviceCount;
 }
 
 /*
@@ -415,10 +667,9 @@ void _processSerial()
 
 void sendRefreshRequest(void)
 {
-	for (int i = 0; i < XPLDEVICES_MAXDEVICES; i++)
+	for (int i = 0; i < myXPLDevices.count(); i++)
 	{
-		if (myXPLDevices[i])
-			if (myXPLDevices[i] && myXPLDevices[i]->RefsLoaded)  myXPLDevices[i]->_writePacket(XPLREQUEST_REFRESH, "");
+		if (myXPLDevices.at(i)->RefsLoaded)  myXPLDevices.at(i)->_writePacket(XPLREQUEST_REFRESH, "");
 	}
 
 }
@@ -427,10 +678,9 @@ void sendExitMessage(void)
 {
 	fprintf(errlog, "\n*Xplane indicates that it is closing or unloading the current aircraft.  I am letting all the devices know.\n");
 
-	for (int i = 0; i < XPLDEVICES_MAXDEVICES; i++)
+	for (int i = 0; i < myXPLDevices.count(); i++)
 	{
-		if (myXPLDevices[i])
-			if (myXPLDevices[i] && myXPLDevices[i]->RefsLoaded)  myXPLDevices[i]->_writePacket(XPL_EXITING, "");
+		if (myXPLDevices.at(i)->RefsLoaded)  myXPLDevices.at(i)->_writePacket(XPL_EXITING, "");
 	}
 
 }
@@ -444,6 +694,7 @@ void reloadDevices(void)
 {
 	fprintf(errlog, "XPLPro device requested to reset and reload devices.  \n");
 
+	reloadRequested = 0;
 
 	disengageDevices();				// just to make sure we are cleared
 	engageDevices();
@@ -464,4 +715,28 @@ float mapFloat(long x, long inMin, long inMax, long outMin, long outMax)
 long mapInt(long x, long inMin, long inMax, long outMin, long outMax)
 {
 	return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+static const double fixedScale[XPL_FIXED_MAXDECIMALS + 1] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+
+/*
+ * fixed point conversions for XPLCMD_DATAREFUPDATEFIXED, rounded and held to what a long on the device takes
+ */
+long fixedFromValue(double value, int decimals)
+{
+	if (decimals < 0) decimals = 0;
+	if (decimals > XPL_FIXED_MAXDECIMALS) decimals = XPL_FIXED_MAXDECIMALS;
+
+	value = floor(value * fixedScale[decimals] + .5);
+	if (value > 2147483647.) return 2147483647;
+	if (value < -2147483648.) return -2147483647 - 1;
+	return (long)value;
+}
+
+double fixedToValue(long value, int decimals)
+{
+	if (decimals < 0) decimals = 0;
+	if (decimals > XPL_FIXED_MAXDECIMALS) decimals = XPL_FIXED_MAXDECIMALS;
+
+	return value / fixedScale[decimals];
 }
\ No newline at end of file
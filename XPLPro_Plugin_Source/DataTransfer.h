@@ -2,6 +2,10 @@
 //#include "Serial.h"
 #include "XPLProCommon.h"
 
+#include <time.h>
+
+class XPLDevice;
+
 void BindingsSetup(void);
 void BindingsLoad(void);
 
@@ -14,13 +18,22 @@ void engageDevices(void);
 void _processPacket(int);
 void _processSerial(void);
 void _updateDataRefs(int forceUpdate);
+void _updateDeadReckoning(XPLDevice* device, int bindingIndex, int forceUpdate);
+double _getDataRefValue(int bindingIndex, int element);
 void _updateCommands(void);
+void _subscribeCommandEvents(int commandIndex);
+void _scheduleBinding(int bindingIndex);
+int _findGate(int gateBinding, int element, int condition, float threshold);
+void _updateGates(void);
+float _flightLoopInterval(void);
+void _applyInboundWrites(void);
 int _writePacket(int port, char, char*);
-int _writePacketN(int port, char, char*, int);
 void reloadDevices(void);
 
 float mapFloat(long x, long inMin, long inMax, long outMin, long outMax);
 long mapInt(long x, long inMin, long inMax, long outMin, long outMax);
+long fixedFromValue(double value, int decimals);
+double fixedToValue(long value, int decimals);
 
 struct DataRefBinding
 {
@@ -30,7 +43,19 @@ struct DataRefBinding
 //	int            RWMode;					// XPL_READ 1   XPL_WRITE   2   XPL_READWRITE	3
 	int				readFlag[XPLMAX_ELEMENTS];				// true if device requests updates for this dataref value/element
 	float		   precision;					// reduce resolution by dividing then remultiplying with this number, or 0 for no processing
+	int			   fixedDecimals[XPLMAX_ELEMENTS];	// send the element as value * 10^fixedDecimals with XPLCMD_DATAREFUPDATEFIXED, or -1 for the usual frames
 	int            updateRate;				// minimum time in ms between updates sent 
+	int			   rateClass;				// index into rateClassPeriod, or -1 if not subscribed
+	float		   samplePeriod;			// seconds between reads, updateRate but not faster than the class period
+	float		   nextSample;				// elapsedTime when this binding is due to be read again
+	int			   gate;					// index into myGates, or -1 if updates aren't gated
+	int			   gatedMarkerSent;			// true while the gate is closed and the device has been told
+	int			   touch;					// device asked for the current value, send it even if unchanged
+	int			   stringDiff;				// string datarefs:  send (offset, length, bytes) patches instead of the whole string
+	float		   stringResync;			// seconds between full strings in stringDiff mode, 0 for never
+	float		   stringSentTime;			// elapsedTime of the last full string
+	int			   currentSentLength;		// length of currentSents[0], -1 if nothing sent yet
+	int			   stringLimit;				// longest string the device takes for this dataref (XPLREQUEST_STRINGSIZE), 0 to fit its frame size
 	time_t		   lastUpdate;				// time of last update
 	XPLMDataRef    xplaneDataRefHandle;		// Dataref handle of xplane element associated with binding
 	XPLMDataTypeID xplaneDataRefTypeID;		// dataRef type
@@ -41,7 +66,8 @@ struct DataRefBinding
 	int				scaleToLow;
 	int				scaleToHigh;
 	int			   currentElementSent[XPLMAX_ELEMENTS];
-	long           currentSentl[XPLMAX_ELEMENTS];		// Current  long value sent to device
+	long           currentSentl[XPLMAX_ELEMENTS];		// Current  long value sent to device, owned by the update worker while it runs
+	long           currentSentFixed[XPLMAX_ELEMENTS];	// same for fixed point elements, in the units sent
 	long           currentReceivedl[XPLMAX_ELEMENTS];   // Current long value sent to Xplane
 	float          currentSentf[XPLMAX_ELEMENTS];      // Current float value sent to device
 		
@@ -51,7 +77,37 @@ struct DataRefBinding
 	
 	char*			currentSents[XPLMAX_ELEMENTS];	// dynamically allocated string buffer for string types.
 
+	int				drActive;							// true if any element is sent as value + rate (dead reckoning)
+	int				drFlag[XPLMAX_ELEMENTS];			// true if device requests dead reckoning updates for this element
+	float			drTolerance;						// resend when the device's extrapolation is off by more than this
+	double			drSentValue[XPLMAX_ELEMENTS];		// value, rate and time of the last update sent to the device
+	double			drSentRate[XPLMAX_ELEMENTS];
+	float			drSentTime[XPLMAX_ELEMENTS];
+	double			drSampleValue[XPLMAX_ELEMENTS];		// previous sample and smoothed rate estimate
+	double			drSampleRate[XPLMAX_ELEMENTS];
+	float			drSampleTime[XPLMAX_ELEMENTS];		// or -1 if not yet sampled
+
+	int				pendingFlag[XPLMAX_ELEMENTS];		// inbound write staged this frame, applied once by _applyInboundWrites
+	long			pendingl[XPLMAX_ELEMENTS];
+	float			pendingf[XPLMAX_ELEMENTS];
+	long			writesReceived;						// inbound writes from the device
+	long			writesFolded;						// of those, replaced by a later write in the same frame
+
+	int				echoFlag[XPLMAX_ELEMENTS];			// device wrote this value, passed to the update worker with the next snapshot
+	long			echol[XPLMAX_ELEMENTS];				// so it isn't sent back
+	float			echof[XPLMAX_ELEMENTS];
+	long			echoFixed[XPLMAX_ELEMENTS];			// in the units sent, for fixed point elements
 
+
+};
+
+struct DataRefGate
+{
+	int				binding;				// dataref that opens and closes the gate
+	int				element;
+	int				condition;				// XPLGATE_
+	float			threshold;
+	int				open;					// evaluated once per frame by _updateGates
 };
 
 struct CommandBinding
@@ -64,6 +120,7 @@ struct CommandBinding
 
 	char           xplaneCommandName[80];		// character name of xplane dataref
 	int			   accumulator;
+	int			   eventsRequested;			// command handler registered to send XPLCMD_COMMANDEVENT to the device
 	//int            xplaneCurrentReceived;   // Current value sent to Xplane
 
 };
@@ -0,0 +1,106 @@
+
+#define XPLM200
+
+#include "XPLProCommon.h"
+
+#include "XPLDevice.h"
+#include "DeviceRegistry.h"
+
+DeviceRegistry::DeviceRegistry()
+{
+	_nextID = 0;
+}
+
+DeviceRegistry::~DeviceRegistry()
+{
+	clear();
+}
+
+XPLDevice* DeviceRegistry::add(serialClass* port, int portNumber)
+{
+	DeviceEntry entry;
+
+	entry.device = new XPLDevice(_nextID);
+	entry.device->port = port;
+	entry.portNumber = portNumber;
+
+	_positions[_nextID] = (int)_devices.size();
+	_ports[portNumber] = _nextID;
+	_devices.push_back(entry);
+	_nextID++;
+
+	return entry.device;
+}
+
+/*
+	remove -- the last device takes the place of the removed one, so the list stays dense.
+*/
+void DeviceRegistry::remove(int id)
+{
+	auto found = _positions.find(id);
+
+	if (found == _positions.end()) return;
+
+	int position = found->second;
+	DeviceEntry entry = _devices[position];
+
+	_positions.erase(found);
+	_ports.erase(entry.portNumber);
+
+	if (position != (int)_devices.size() - 1)
+	{
+		_devices[position] = _devices.back();
+		_positions[_devices[position].device->referenceID()] = position;
+	}
+	_devices.pop_back();
+
+	entry.device->port->shutDown();
+	delete entry.device->port;
+	delete entry.device;
+}
+
+void DeviceRegistry::clear(void)
+{
+	for (size_t i = 0; i < _devices.size(); i++)
+	{
+		_devices[i].device->port->shutDown();
+		delete _devices[i].device->port;
+		delete _devices[i].device;
+	}
+
+	_devices.clear();
+	_positions.clear();
+	_ports.clear();
+	_nextID = 0;
+}
+
+XPLDevice* DeviceRegistry::find(int id)
+{
+	auto found = _positions.find(id);
+
+	if (found == _positions.end()) return NULL;
+	return _devices[found->second].device;
+}
+
+XPLDevice* DeviceRegistry::findPort(int portNumber)
+{
+	auto found = _ports.find(portNumber);
+
+	if (found == _ports.end()) return NULL;
+	return find(found->second);
+}
+
+int DeviceRegistry::count(void)
+{
+	return (int)_devices.size();
+}
+
+XPLDevice* DeviceRegistry::at(int position)
+{
+	return _devices[position].device;
+}
+
+int DeviceRegistry::idLimit(void)
+{
+	return _nextID;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "XPLDevice.h"
+
+#include <vector>
+#include <unordered_map>
+
+/*
+	The devices that answered on a com port.  Each one gets an ID when it is added, which is what bindings and commands
+	store as deviceIndex.  IDs stay the same while the device is connected, a device going away doesn't move the others,
+	and they only start over from 0 when the registry is cleared.  Devices are kept in a dense list for going through
+	them, in no particular order, with maps from ID and from port number to their place in the list.
+
+	Only changed from the sim thread while the update worker is stopped (findDevices, disengageDevices), so the worker
+	can look devices up without a lock.
+*/
+
+class DeviceRegistry
+{
+public:
+
+	DeviceRegistry();
+	~DeviceRegistry();
+
+	XPLDevice* add(serialClass* port, int portNumber);	// new device with the next ID, the registry owns the port from now on
+	void remove(int id);								// shuts the port down and deletes both
+	void clear(void);									// removes all of them, IDs start over
+
+	XPLDevice* find(int id);							// NULL if there is no device with that ID
+	XPLDevice* findPort(int portNumber);				// NULL if nothing is connected on that com port
+
+	int count(void);									// devices connected
+	XPLDevice* at(int position);						// 0 to count() - 1, positions change when a device is removed
+	int idLimit(void);									// one more than the highest ID handed out, for arrays indexed by ID
+
+private:
+
+	struct DeviceEntry
+	{
+		XPLDevice*	device;
+		int			portNumber;
+	};
+
+	std::vector<DeviceEntry> _devices;
+	std::unordered_map<int, int> _positions;			// ID -> place in _devices
+	std::unordered_map<int, int> _ports;				// port number -> ID
+	int _nextID;
+
+};
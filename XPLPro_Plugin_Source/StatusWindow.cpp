@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <string>
 #include <ctime>  
+#include <atomic>
 
 
 
@@ -25,15 +26,33 @@
 #include "XPWidgetUtils.h"
 
 
-#include "serialclass.h"
+#include "SerialClass.h"
 #include "Config.h"
 
 #include "XPLProPlugin.h"
 
 #include "DataTransfer.h"
 #include "StatusWindow.h"
+#include "XPLDevice.h"
+#include "DeviceRegistry.h"
 
 XPLMWindowID	statusWindow = NULL;
+XPLMDataRef		statusDataRefs[XPLSTAT_COUNT];
+
+const char* statusDataRefNames[XPLSTAT_COUNT] =		// int arrays indexed by device ID, in XPLSTAT_ order
+{
+	"XPLPro/device/loops",
+	"XPLPro/device/loop_mean_us",
+	"XPLPro/device/loop_max_us",
+	"XPLPro/device/rx_wait_us",
+	"XPLPro/device/callback_us",
+	"XPLPro/device/rx_dropped",
+	"XPLPro/device/frames_tx",
+	"XPLPro/device/frames_rx",
+	"XPLPro/device/queue_full"
+};
+
+extern DeviceRegistry myXPLDevices;
 
 extern CommandBinding myCommands[XPL_MAXCOMMANDS_PC];
 extern DataRefBinding myBindings[XPL_MAXDATAREFS_PC];
@@ -48,10 +67,13 @@ extern float elapsedTime;
 
 extern int cmdHandleCounter;
 extern int refHandleCounter;
+extern int rateClassCount[XPL_RATECLASSES];
+extern float phaseMean[XPLPHASE_COUNT];
+extern float phaseMax[XPLPHASE_COUNT];
 
 int lastCmdAction = -1;
-int lastRefSent = -1;
-int lastRefElementSent = 0;
+std::atomic<int> lastRefSent(-1);						// written by the update worker
+std::atomic<int> lastRefElementSent(0);
 int lastRefReceived = -1;
 int lastRefElementReceived = 0;
 
@@ -96,7 +118,8 @@ void statusDrawWindowCallback(
 
 	sprintf(tstring, "Devices Detected: %i, Registered DataRefs: %i, Registered Commands: %i, tx: %i, rx: %i", validPorts, refHandleCounter, cmdHandleCounter, packetsSent, packetsReceived);
 	XPLMDrawString(color, left + 5, top - 55, tstring, NULL, xplmFont_Basic);
-	sprintf(tstring, "Elapsed time since start: %i, cycles: %i, average time between cycles: %3.2f", (int)elapsedTime, cycleCount, elapsedTime / cycleCount);
+	sprintf(tstring, "Elapsed time since start: %i, cycles: %i, average time between cycles: %3.2f, subscriptions at 60/30/10/2 Hz: %i/%i/%i/%i", (int)elapsedTime, cycleCount, elapsedTime / cycleCount,
+		rateClassCount[0], rateClassCount[1], rateClassCount[2], rateClassCount[3]);
 	XPLMDrawString(color, left + 5, top - 70, tstring, NULL, xplmFont_Basic);
 
 	if (lastRefReceived >= 0)
@@ -109,20 +132,24 @@ void statusDrawWindowCallback(
 		if (myBindings[lastRefReceived].xplaneDataRefTypeID & xplmType_IntArray)	sprintf(tstring, "Last Dataref Received: %s, Element: %i, %i", myBindings[lastRefReceived].xplaneDataRefName, lastRefElementReceived, myBindings[lastRefReceived].currentReceivedl[lastRefElementReceived]);
 		if (myBindings[lastRefReceived].xplaneDataRefTypeID & xplmType_FloatArray)	sprintf(tstring, "Last Dataref Received: %s, Element: %i, %f", myBindings[lastRefReceived].xplaneDataRefName, lastRefElementReceived, myBindings[lastRefReceived].currentReceivedf[lastRefElementReceived]);	
 	//	if (myBindings[lastRefReceived].xplaneDataRefTypeID & xplmType_Data)			sprintf(tstring, "Last Dataref Action: %s, %s", myBindings[lastRefReceived].xplaneDataRefName, myBindings[lastRefReceived].xplaneCurrentReceiveds);
+		sprintf(tstring + strlen(tstring), ", writes: %li, folded: %li", myBindings[lastRefReceived].writesReceived, myBindings[lastRefReceived].writesFolded);
 		XPLMDrawString(color, left + 5, top - 90, tstring, NULL, xplmFont_Basic);
 		
 	}
 	
-	if (lastRefSent >= 0)
+	int refSent = lastRefSent;								// the update worker keeps changing these
+	int elementSent = lastRefElementSent;
+
+	if (refSent >= 0)
 	{
 		//sprintf(tstring, "Last ref sent: %i, %s\n", lastRefReceived, myBindings[lastRefReceived].xplaneDataRefName);
 
-		if (myBindings[lastRefSent].xplaneDataRefTypeID & xplmType_Int)			sprintf(tstring, "Last Dataref Sent: %s, %i", myBindings[lastRefSent].xplaneDataRefName, myBindings[lastRefSent].currentSentl[lastRefElementSent]);
-		if (myBindings[lastRefSent].xplaneDataRefTypeID & xplmType_Float)		sprintf(tstring, "Last Dataref Sent: %s, %f", myBindings[lastRefSent].xplaneDataRefName, myBindings[lastRefSent].currentSentf[lastRefElementSent]);
-		if (myBindings[lastRefSent].xplaneDataRefTypeID & xplmType_Double)		sprintf(tstring, "Last Dataref Sent: %s, %i", myBindings[lastRefSent].xplaneDataRefName, myBindings[lastRefSent].currentSentl[lastRefElementSent]);
-		if (myBindings[lastRefSent].xplaneDataRefTypeID & xplmType_IntArray)	sprintf(tstring, "Last Dataref Sent: %s, Element: %i, %i", myBindings[lastRefSent].xplaneDataRefName, lastRefElementSent, myBindings[lastRefSent].currentSentl[lastRefElementSent]);
-		if (myBindings[lastRefSent].xplaneDataRefTypeID & xplmType_FloatArray)	sprintf(tstring, "Last Dataref Sent: %s, Element: %i, %f", myBindings[lastRefSent].xplaneDataRefName, lastRefElementSent, myBindings[lastRefSent].currentSentf[lastRefElementSent]);	
-		if (myBindings[lastRefSent].xplaneDataRefTypeID & xplmType_Data)		sprintf(tstring, "Last Dataref Sent: %s, %s", myBindings[lastRefSent].xplaneDataRefName, myBindings[lastRefSent].currentSents[lastRefElementSent]);
+		if (myBindings[refSent].xplaneDataRefTypeID & xplmType_Int)			sprintf(tstring, "Last Dataref Sent: %s, %i", myBindings[refSent].xplaneDataRefName, myBindings[refSent].currentSentl[elementSent]);
+		if (myBindings[refSent].xplaneDataRefTypeID & xplmType_Float)		sprintf(tstring, "Last Dataref Sent: %s, %f", myBindings[refSent].xplaneDataRefName, myBindings[refSent].currentSentf[elementSent]);
+		if (myBindings[refSent].xplaneDataRefTypeID & xplmType_Double)		sprintf(tstring, "Last Dataref Sent: %s, %i", myBindings[refSent].xplaneDataRefName, myBindings[refSent].currentSentl[elementSent]);
+		if (myBindings[refSent].xplaneDataRefTypeID & xplmType_IntArray)	sprintf(tstring, "Last Dataref Sent: %s, Element: %i, %i", myBindings[refSent].xplaneDataRefName, elementSent, myBindings[refSent].currentSentl[elementSent]);
+		if (myBindings[refSent].xplaneDataRefTypeID & xplmType_FloatArray)	sprintf(tstring, "Last Dataref Sent: %s, Element: %i, %f", myBindings[refSent].xplaneDataRefName, elementSent, myBindings[refSent].currentSentf[elementSent]);	
+		if (myBindings[refSent].xplaneDataRefTypeID & xplmType_Data)		sprintf(tstring, "Last Dataref Sent: %s, %s", myBindings[refSent].xplaneDataRefName, myBindings[refSent].currentSents[elementSent]);
 		XPLMDrawString(color, left + 5, top - 105, tstring, NULL, xplmFont_Basic);
 		
 	}
@@ -133,6 +160,27 @@ void statusDrawWindowCallback(
 		XPLMDrawString(color, left + 5, top - 120, tstring, NULL, xplmFont_Basic);
 	}
 
+	sprintf(tstring, "Flight loop mean / max us:  serial %.0f / %.0f, writes %.0f / %.0f, datarefs %.0f / %.0f, commands %.0f / %.0f, total %.0f / %.0f, worker send %.0f / %.0f",
+		phaseMean[XPLPHASE_SERIAL], phaseMax[XPLPHASE_SERIAL], phaseMean[XPLPHASE_WRITES], phaseMax[XPLPHASE_WRITES], phaseMean[XPLPHASE_DATAREFS], phaseMax[XPLPHASE_DATAREFS],
+		phaseMean[XPLPHASE_COMMANDS], phaseMax[XPLPHASE_COMMANDS], phaseMean[XPLPHASE_TOTAL], phaseMax[XPLPHASE_TOTAL], phaseMean[XPLPHASE_SEND], phaseMax[XPLPHASE_SEND]);
+	XPLMDrawString(color, left + 5, top - 135, tstring, NULL, xplmFont_Basic);
+
+	// per device instrumentation, for devices that have enableStats() on
+	int line = top - 155;
+	for (int i = 0; i < myXPLDevices.count() && line > bottom; i++)
+	{
+		XPLDevice* device = myXPLDevices.at(i);
+
+		if (!device->statsTime) continue;
+
+		long* s = device->stats;
+		sprintf(tstring, "[%i] %s: loops: %li, loop mean: %li us, max: %li us, rx wait: %li us, callbacks: %li us, rx dropped: %li, tx: %li, rx: %li, queue full: %li",
+			device->referenceID(), device->deviceName, s[XPLSTAT_LOOPS], s[XPLSTAT_LOOPMEAN], s[XPLSTAT_LOOPMAX], s[XPLSTAT_RXWAIT], s[XPLSTAT_CALLBACK],
+			s[XPLSTAT_RXDROPPED], s[XPLSTAT_FRAMESTX], s[XPLSTAT_FRAMESRX], s[XPLSTAT_QUEUEFULL]);
+		XPLMDrawString(color, left + 5, line, tstring, NULL, xplmFont_Basic);
+		line -= 15;
+	}
+
 	
 
 }
@@ -144,6 +192,48 @@ int statusWindowActive(void)
 }
 
 
+/**************************************************************************************/
+/* statusReadDeviceStats -- dataref accessor, one element per device ID               */
+/**************************************************************************************/
+int statusReadDeviceStats(void* inRefcon, int* outValues, int inOffset, int inMax)
+{
+	int field = (int)(intptr_t)inRefcon;
+	int count = 0;
+
+	if (outValues == NULL) return myXPLDevices.idLimit();
+
+	for (int i = inOffset; i < myXPLDevices.idLimit() && count < inMax; i++)
+	{
+		XPLDevice* device = myXPLDevices.find(i);
+
+		if (device)		outValues[count++] = (int)device->stats[field];
+		else			outValues[count++] = 0;
+	}
+
+	return count;
+}
+
+void statusDataRefsRegister(void)
+{
+	for (int i = 0; i < XPLSTAT_COUNT; i++)
+	{
+		statusDataRefs[i] = XPLMRegisterDataAccessor(statusDataRefNames[i], xplmType_IntArray, 0,
+			NULL, NULL, NULL, NULL, NULL, NULL,
+			statusReadDeviceStats, NULL,
+			NULL, NULL, NULL, NULL,
+			(void*)(intptr_t)i, NULL);
+	}
+}
+
+void statusDataRefsUnregister(void)
+{
+	for (int i = 0; i < XPLSTAT_COUNT; i++)
+	{
+		if (statusDataRefs[i]) XPLMUnregisterDataAccessor(statusDataRefs[i]);
+		statusDataRefs[i] = NULL;
+	}
+}
+
 /**************************************************************************************/
 /* MyHandleMouseClickCallback -- Called by xplane while status window is active  */
 /**************************************************************************************/
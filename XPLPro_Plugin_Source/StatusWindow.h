@@ -4,6 +4,8 @@
 
 void statusWindowCreate(void);
 int statusWindowActive(void);
+void statusDataRefsRegister(void);
+void statusDataRefsUnregister(void);
 
 void statusDrawWindowCallback(	XPLMWindowID,  void*);
 int statusHandleMouseClickCallback(XPLMWindowID, int , int , XPLMMouseStatus , void*);
@@ -0,0 +1,296 @@
+
+#define XPLM200
+
+#include "XPLProCommon.h"
+
+#include "XPLMPlugin.h"
+#include "XPLMDataAccess.h"
+#include "XPLMUtilities.h"
+
+#include "XPLDevice.h"
+#include "DataTransfer.h"
+#include "TraceRecorder.h"
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+extern FILE* errlog;
+
+extern DataRefBinding myBindings[XPL_MAXDATAREFS_PC];
+
+struct TraceColumn
+{
+	int						binding;
+	int						element;
+	int						kind;					// XPL_TRACEKIND_
+	int						recorded;				// has a last value
+
+	std::vector<unsigned char>	frames;				// encoded frame deltas for this block
+	std::vector<unsigned char>	values;				// encoded values for this block
+	int						entries;
+	int						lastFrame;
+
+	unsigned long long		previous;				// encoding base in this block, reset every block
+	unsigned long long		last;					// last value recorded, kept across blocks to find changes
+	std::string				lastString;
+};
+
+static std::mutex traceMutex;
+static FILE* traceFile = NULL;
+static std::unordered_map<int, TraceColumn> traceColumns;		// binding * XPLMAX_ELEMENTS + element
+static std::vector<int> traceColumnOrder;						// in the order they showed up
+static std::vector<unsigned char> traceTimes;
+static int traceFrames = 0;
+static long traceLastTime = 0;
+static int traceNamed[XPL_MAXDATAREFS_PC];
+static std::vector<int> traceNewNames;
+static long traceBytes = 0;
+
+static void _putVarint(std::vector<unsigned char>& out, unsigned long long value)
+{
+	while (value >= 0x80)
+	{
+		out.push_back((unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back((unsigned char)value);
+}
+
+static unsigned long long _zigzag(long long value)
+{
+	return ((unsigned long long)value << 1) ^ (unsigned long long)(value >> 63);
+}
+
+static void _flushBlock(void)
+{
+	std::vector<unsigned char> out;
+
+	if (!traceFile || !traceFrames) return;
+
+	for (size_t i = 0; i < traceNewNames.size(); i++)
+	{
+		int b = traceNewNames[i];
+		size_t length = strlen(myBindings[b].xplaneDataRefName);
+
+		out.push_back('N');
+		_putVarint(out, b);
+		_putVarint(out, myBindings[b].xplaneDataRefTypeID);
+		_putVarint(out, length);
+		out.insert(out.end(), myBindings[b].xplaneDataRefName, myBindings[b].xplaneDataRefName + length);
+	}
+	traceNewNames.clear();
+
+	int columns = 0;
+	for (size_t i = 0; i < traceColumnOrder.size(); i++) if (traceColumns[traceColumnOrder[i]].entries) columns++;
+
+	out.push_back('B');
+	_putVarint(out, traceFrames);
+	out.insert(out.end(), traceTimes.begin(), traceTimes.end());
+	_putVarint(out, columns);
+
+	for (size_t i = 0; i < traceColumnOrder.size(); i++)
+	{
+		TraceColumn* column = &traceColumns[traceColumnOrder[i]];
+
+		if (!column->entries) continue;
+
+		_putVarint(out, column->binding);
+		_putVarint(out, column->element);
+		_putVarint(out, column->kind);
+		_putVarint(out, column->entries);
+		out.insert(out.end(), column->frames.begin(), column->frames.end());
+		out.insert(out.end(), column->values.begin(), column->values.end());
+
+		column->frames.clear();
+		column->values.clear();
+		column->entries = 0;
+		column->lastFrame = 0;
+		column->previous = 0;
+	}
+
+	fwrite(out.data(), 1, out.size(), traceFile);
+	traceBytes += (long)out.size();
+
+	traceTimes.clear();
+	traceFrames = 0;
+}
+
+/*
+	_recordValue -- adds an entry to a column if the value changed.  Numbers come in as their bits.
+*/
+static void _recordValue(int binding, int element, int kind, unsigned long long value, const char* string, int length)
+{
+	int key = binding * XPLMAX_ELEMENTS + element;
+	auto found = traceColumns.find(key);
+	TraceColumn* column;
+
+	if (found == traceColumns.end())
+	{
+		column = &traceColumns[key];
+		column->binding = binding;
+		column->element = element;
+		column->kind = kind;
+		column->recorded = 0;
+		column->entries = 0;
+		column->lastFrame = 0;
+		column->previous = 0;
+		column->last = 0;
+		traceColumnOrder.push_back(key);
+
+		if (!traceNamed[binding])
+		{
+			traceNamed[binding] = 1;
+			traceNewNames.push_back(binding);
+		}
+	}
+	else column = &found->second;
+
+	if (column->recorded)
+	{
+		if (kind == XPL_TRACEKIND_STRING)	{ if (column->lastString.compare(0, std::string::npos, string, length) == 0) return; }
+		else if (column->last == value)		return;
+	}
+	column->recorded = 1;
+
+	_putVarint(column->frames, traceFrames - column->lastFrame);
+	column->lastFrame = traceFrames;
+	column->entries++;
+
+	switch (kind)
+	{
+	case XPL_TRACEKIND_INT:
+		_putVarint(column->values, _zigzag((long long)value - (long long)column->previous));
+		break;
+
+	case XPL_TRACEKIND_FLOAT:
+	case XPL_TRACEKIND_DOUBLE:
+		_putVarint(column->values, value ^ column->previous);			// slow moving values share most of their bits
+		break;
+
+	case XPL_TRACEKIND_STRING:
+		_putVarint(column->values, length);
+		column->values.insert(column->values.end(), string, string + length);
+		column->lastString.assign(string, length);
+		break;
+	}
+
+	column->previous = value;
+	column->last = value;
+}
+
+int traceStart(const char* fileName)
+{
+	std::lock_guard<std::mutex> lock(traceMutex);
+
+	if (traceFile) return 1;
+
+	fopen_s(&traceFile, fileName, "wb");
+	if (!traceFile)
+	{
+		fprintf(errlog, "Unable to open dataref trace file %s\n", fileName);
+		return 0;
+	}
+
+	fwrite("XPLTRACE", 1, 8, traceFile);
+	fputc(XPL_TRACE_VERSION, traceFile);
+
+	traceColumns.clear();
+	traceColumnOrder.clear();
+	traceTimes.clear();
+	traceNewNames.clear();
+	traceFrames = 0;
+	traceLastTime = 0;
+	traceBytes = 9;
+	for (int i = 0; i < XPL_MAXDATAREFS_PC; i++) traceNamed[i] = 0;
+
+	fprintf(errlog, "Recording dataref trace to %s\n", fileName);
+	return 1;
+}
+
+void traceStop(void)
+{
+	std::lock_guard<std::mutex> lock(traceMutex);
+
+	if (!traceFile) return;
+
+	_flushBlock();
+	fclose(traceFile);
+	traceFile = NULL;
+
+	fprintf(errlog, "Dataref trace stopped, %li bytes, %i columns.\n", traceBytes, (int)traceColumnOrder.size());
+}
+
+int traceActive(void)
+{
+	return traceFile != NULL;
+}
+
+void traceBindingsChanged(void)
+{
+	std::lock_guard<std::mutex> lock(traceMutex);
+
+	if (!traceFile) return;
+
+	_flushBlock();
+	traceColumns.clear();
+	traceColumnOrder.clear();
+	for (int i = 0; i < XPL_MAXDATAREFS_PC; i++) traceNamed[i] = 0;
+}
+
+void traceRecordValue(int binding, int element, double value)
+{
+	std::lock_guard<std::mutex> lock(traceMutex);
+	unsigned long long doubleBits;
+
+	if (!traceFile) return;
+
+	memcpy(&doubleBits, &value, sizeof(doubleBits));
+	_recordValue(binding, element, XPL_TRACEKIND_DOUBLE, doubleBits, NULL, 0);
+}
+
+void traceRecord(DataRefSnapshot* snapshot)
+{
+	std::lock_guard<std::mutex> lock(traceMutex);
+
+	if (!traceFile) return;
+
+	long time = (long)(snapshot->time * 1000);
+	_putVarint(traceTimes, _zigzag(time - traceLastTime));
+	traceLastTime = time;
+
+	for (int i = 0; i < snapshot->count; i++)
+	{
+		DataRefSample* sample = &snapshot->samples[i];
+		unsigned int floatBits;
+		unsigned long long doubleBits;
+
+		if (sample->gated) continue;
+
+		if (sample->type & xplmType_Data)
+		{
+			_recordValue(sample->binding, 0, XPL_TRACEKIND_STRING, 0, snapshot->strings.data() + sample->strOffset, sample->strLength);
+			continue;
+		}
+
+		for (int j = 0; j < XPLMAX_ELEMENTS; j++)
+		{
+			if (!sample->readFlag[j]) continue;
+
+			if (sample->type & (xplmType_Float | xplmType_FloatArray))
+			{
+				memcpy(&floatBits, &sample->f[j], sizeof(floatBits));
+				_recordValue(sample->binding, j, XPL_TRACEKIND_FLOAT, floatBits, NULL, 0);
+			}
+			else if (sample->type & xplmType_Double)
+			{
+				memcpy(&doubleBits, &sample->d, sizeof(doubleBits));
+				_recordValue(sample->binding, j, XPL_TRACEKIND_DOUBLE, doubleBits, NULL, 0);
+			}
+			else _recordValue(sample->binding, j, XPL_TRACEKIND_INT, (unsigned long long)(long long)sample->l[j], NULL, 0);
+		}
+	}
+
+	if (++traceFrames >= XPL_TRACE_BLOCKFRAMES) _flushBlock();
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "XPLProCommon.h"
+#include "UpdateWorker.h"
+
+/*
+	Records the values of subscribed datarefs as the flight loop reads them, to have real traffic to tune the update path
+	against.  Every snapshot is recorded, also those the update worker never gets to, and the dead reckoning subscriptions
+	that don't go through a snapshot.  Only changes are written, one column per dataref element, so a long flight stays small.
+
+	file:		"XPLTRACE" version
+	name:		'N' binding type namelength name						first time a binding shows up, before its block, and
+																		again if the binding number is reused after re-engaging
+	block:		'B' frames timedeltas[frames] columns column[columns]
+	column:		binding element kind entries framedeltas[entries] values[entries]
+
+	Numbers are unsigned LEB128 varints, signed ones zigzag encoded.  Times are ms since the previous frame, frames are the
+	distance from the previous entry in the block.  Values start from 0 in every block so blocks decode on their own:
+	ints are deltas, floats and doubles are the bits XORed with the previous value, strings are length + bytes.
+*/
+
+#define XPL_TRACE_VERSION		1
+#define XPL_TRACE_BLOCKFRAMES	600			// snapshots per block, about 10 seconds at 60 Hz
+
+#define XPL_TRACEKIND_INT		0
+#define XPL_TRACEKIND_FLOAT		1
+#define XPL_TRACEKIND_DOUBLE	2
+#define XPL_TRACEKIND_STRING	3
+
+int  traceStart(const char* fileName);		// returns 0 if the file can't be opened
+void traceStop(void);
+int  traceActive(void);
+void traceBindingsChanged(void);				// devices disengaged, binding numbers will be reused for other datarefs
+void traceRecordValue(int binding, int element, double value);	// dead reckoning element, goes in the frame of the next traceRecord
+void traceRecord(DataRefSnapshot* snapshot);	// flight loop, when the snapshot is gathered and before it is published
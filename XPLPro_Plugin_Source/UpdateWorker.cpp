@@ -0,0 +1,510 @@
+
+#define XPLM200
+
+#include "XPLProCommon.h"
+
+#include "XPLMPlugin.h"
+#include "XPLMDataAccess.h"
+#include "XPLMUtilities.h"
+
+#include "XPLDevice.h"
+#include "DeviceRegistry.h"
+#include "DataTransfer.h"
+#include "UpdateWorker.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+extern FILE* errlog;
+extern std::atomic<int> lastRefSent;
+extern std::atomic<int> lastRefElementSent;
+
+extern DataRefBinding myBindings[XPL_MAXDATAREFS_PC];
+extern DeviceRegistry myXPLDevices;
+
+/*
+	Three buffers rotate so neither side ever waits for the other:  the flight loop fills 'gather', publishing swaps it
+	with 'ready', the worker swaps 'ready' with 'working' when it wakes up.  If the worker falls behind, the newer
+	snapshot replaces the one it hasn't picked up, keeping only the entries that must not be lost (gated markers,
+	forced updates and values the device wrote itself).
+*/
+static DataRefSnapshot* snapshots[3] = { NULL, NULL, NULL };
+static DataRefSnapshot* gather = NULL;
+static DataRefSnapshot* ready = NULL;
+static DataRefSnapshot* working = NULL;
+
+static std::thread workerThread;
+static std::mutex workerMutex;
+static std::condition_variable workerSignal;
+static std::condition_variable workerIdle;
+static int snapshotReady = 0;
+static int workerRunning = 0;
+static int workerSending = 0;
+
+static LARGE_INTEGER sendFrequency;
+static double sendSum = 0;						// us spent sending snapshots since updateWorkerTiming, under workerMutex
+static double sendMax = 0;
+
+static void _workerLoop(void);
+static void _carryOver(DataRefSnapshot* from, DataRefSnapshot* to);
+static void _sendSample(DataRefSample* sample, float time);
+static void _sendFixed(XPLDevice* device, DataRefSample* sample, float time);
+static void _sendString(XPLDevice* device, int bindingIndex, char* string, int length, float time);
+static void _sendStringPatches(XPLDevice* device, DataRefSample* sample, float time);
+
+void updateWorkerStart(void)
+{
+	if (workerRunning) return;
+
+	for (int i = 0; i < 3; i++)
+	{
+		snapshots[i] = new DataRefSnapshot;
+		snapshots[i]->count = 0;
+	}
+	gather = snapshots[0];
+	ready = snapshots[1];
+	working = snapshots[2];
+
+	QueryPerformanceFrequency(&sendFrequency);
+	sendSum = 0;
+	sendMax = 0;
+
+	snapshotReady = 0;
+	workerRunning = 1;
+	workerThread = std::thread(_workerLoop);
+
+	fprintf(errlog, "Update worker thread started.\n");
+}
+
+/*
+	updateWorkerStop -- call before devices are deleted, frames already picked up are finished first.
+*/
+void updateWorkerStop(void)
+{
+	if (!workerRunning) return;
+
+	{
+		std::lock_guard<std::mutex> lock(workerMutex);
+		workerRunning = 0;
+	}
+	workerSignal.notify_one();
+	workerIdle.notify_all();
+	workerThread.join();
+
+	for (int i = 0; i < 3; i++)
+	{
+		delete snapshots[i];
+		snapshots[i] = NULL;
+	}
+	gather = ready = working = NULL;
+
+	fprintf(errlog, "Update worker thread stopped.\n");
+}
+
+int updateWorkerActive(void)
+{
+	return workerRunning;
+}
+
+DataRefSnapshot* updateWorkerSnapshot(void)
+{
+	return gather;
+}
+
+void updateWorkerPublish(void)
+{
+	if (!workerRunning) return;
+
+	{
+		std::lock_guard<std::mutex> lock(workerMutex);
+		if (snapshotReady) _carryOver(ready, gather);			// worker is behind
+
+		for (int i = 0; i < gather->count; i++)					// the string store doesn't move from here on
+		{
+			DataRefSample* sample = &gather->samples[i];
+
+			if (!sample->gated && (sample->type & xplmType_Data)) sample->s = gather->strings.data() + sample->strOffset;
+		}
+
+		DataRefSnapshot* temp = ready;
+		ready = gather;
+		gather = temp;
+		snapshotReady = 1;
+	}
+	workerSignal.notify_one();
+}
+
+/*
+	updateWorkerWait -- until the worker has sent everything published.  The plugin never waits for it, this is for
+		the host tools, which run flight loops back to back and would otherwise have most snapshots replaced.
+*/
+void updateWorkerWait(void)
+{
+	std::unique_lock<std::mutex> lock(workerMutex);
+
+	workerIdle.wait(lock, [] { return (!snapshotReady && !workerSending) || !workerRunning; });
+}
+
+/*
+	updateWorkerTiming -- time the worker spent sending snapshots since the last call, total and longest in us
+*/
+void updateWorkerTiming(double* sum, double* max)
+{
+	std::lock_guard<std::mutex> lock(workerMutex);
+
+	*sum = sendSum;
+	*max = sendMax;
+	sendSum = 0;
+	sendMax = 0;
+}
+
+static void _workerLoop(void)
+{
+	LARGE_INTEGER start, end;
+	double us;
+
+	while (1)
+	{
+		{
+			std::unique_lock<std::mutex> lock(workerMutex);
+			workerSignal.wait(lock, [] { return snapshotReady || !workerRunning; });
+
+			if (!workerRunning) return;
+
+			DataRefSnapshot* temp = working;
+			working = ready;
+			ready = temp;
+			snapshotReady = 0;
+			workerSending = 1;
+		}
+
+		QueryPerformanceCounter(&start);
+		for (int i = 0; i < working->count; i++) _sendSample(&working->samples[i], working->time);
+		QueryPerformanceCounter(&end);
+
+		us = (double)(end.QuadPart - start.QuadPart) * 1000000. / sendFrequency.QuadPart;
+		{
+			std::lock_guard<std::mutex> lock(workerMutex);
+			sendSum += us;
+			if (us > sendMax) sendMax = us;
+			workerSending = 0;
+		}
+		workerIdle.notify_all();
+	}
+}
+
+static void _carryOver(DataRefSnapshot* from, DataRefSnapshot* to)
+{
+	for (int i = 0; i < from->count; i++)
+	{
+		DataRefSample* sample = &from->samples[i];
+		DataRefSample* newer = NULL;
+		int echo = 0;
+
+		if (!sample->gated) for (int j = 0; j < XPLMAX_ELEMENTS; j++) echo |= sample->echoFlag[j];
+		if (!sample->gated && !sample->forceUpdate && !echo) continue;
+
+		for (int j = 0; j < to->count; j++)
+		{
+			if (to->samples[j].binding != sample->binding) continue;
+
+			newer = &to->samples[j];
+			break;
+		}
+
+		if (newer)														// the newer one wins, except for what it doesn't have
+		{
+			if (sample->forceUpdate) newer->forceUpdate = 1;
+			if (newer->gated) continue;
+
+			for (int j = 0; j < XPLMAX_ELEMENTS; j++)
+			{
+				if (!sample->echoFlag[j] || newer->echoFlag[j]) continue;
+
+				newer->echoFlag[j] = 1;
+				newer->echol[j] = sample->echol[j];
+				newer->echof[j] = sample->echof[j];
+				newer->echoFixed[j] = sample->echoFixed[j];
+			}
+			continue;
+		}
+
+		if (to->count >= XPL_MAXDATAREFS_PC) continue;
+
+		newer = &to->samples[to->count++];
+		*newer = *sample;
+
+		if (!sample->gated && (sample->type & xplmType_Data))			// string goes along into the newer store
+		{
+			newer->strOffset = (int)to->strings.size();
+			to->strings.insert(to->strings.end(), from->strings.begin() + sample->strOffset, from->strings.begin() + sample->strOffset + sample->strLength);
+		}
+	}
+}
+
+/*
+	_sendSample -- compare one binding with what was last sent and send what changed.  Runs on the worker thread,
+		which owns currentSent* while it is running.
+*/
+static void _sendSample(DataRefSample* sample, float time)
+{
+	char   writeBuffer[XPLMAX_PACKETSIZE];
+	int    i = sample->binding;
+	int    forceUpdate = sample->forceUpdate;
+	XPLDevice* device = myXPLDevices.find(sample->deviceIndex);
+
+	long   newVall;
+	float  newValf;
+	double newValD;
+
+	if (!device) return;
+
+	if (sample->gated)
+	{
+		sprintf_s(writeBuffer, XPLMAX_PACKETSIZE, ",%i", i);
+		device->_writePacket(XPLCMD_DATAREFGATED, writeBuffer);
+		return;
+	}
+
+	for (int j = 0; j < XPLMAX_ELEMENTS; j++)						// device wrote these itself
+	{
+		if (!sample->echoFlag[j]) continue;
+		myBindings[i].currentSentl[j] = sample->echol[j];
+		myBindings[i].currentSentf[j] = sample->echof[j];
+		if (j == 0) myBindings[i].currentSentD[0] = sample->echof[0];
+		if (sample->fixedDecimals[j] >= 0) myBindings[i].currentSentFixed[j] = sample->echoFixed[j];
+	}
+
+	if (!(sample->type & xplmType_Data)) _sendFixed(device, sample, time);		// elements subscribed fixed point, the rest below
+
+	if ((sample->type & xplmType_Int) && sample->readFlag[0] && sample->fixedDecimals[0] < 0)		// process for datarefs of type int
+	{
+		newVall = sample->l[0];
+
+		if (newVall != myBindings[i].currentSentl[0] || forceUpdate)
+		{
+			lastRefSent = i;
+			myBindings[i].currentSentl[0] = newVall;
+			sprintf_s(writeBuffer, XPLMAX_PACKETSIZE, ",%i,%ld", i, newVall);
+			device->_writePacket(XPLCMD_DATAREFUPDATEINT, writeBuffer);
+			device->lastSendTime = time;
+		}
+	}
+
+	if (sample->type & xplmType_IntArray)						// process for datarefs of type int Array
+	{
+		for (int j = 0; j < XPLMAX_ELEMENTS; j++)
+		{
+			if (!sample->readFlag[j] || sample->fixedDecimals[j] >= 0) continue;		// not subscribed, dead reckoned or fixed point
+
+			newVall = sample->l[j];
+			if (sample->precision)  newVall = ((int)(newVall / sample->precision) * sample->precision);
+			if (newVall != myBindings[i].currentSentl[j] || forceUpdate)
+			{
+				lastRefSent = i;
+				lastRefElementSent = j;
+				myBindings[i].currentSentl[j] = newVall;
+				sprintf_s(writeBuffer, XPLMAX_PACKETSIZE, ",%i,%ld,%i", i, newVall, j);
+				device->_writePacket(XPLCMD_DATAREFUPDATEINTARRAY, writeBuffer);
+				device->lastSendTime = time;
+			}
+		}
+	}
+
+	if ((sample->type & xplmType_Float) && sample->readFlag[0] && sample->fixedDecimals[0] < 0)		// process for datarefs of type float
+	{
+		newValf = sample->f[0];
+		if (sample->precision)  newValf = ((int)(newValf / sample->precision) * sample->precision);
+
+		if (newValf != myBindings[i].currentSentf[0] || forceUpdate)
+		{
+			lastRefSent = i;
+			myBindings[i].currentSentf[0] = newValf;
+			sprintf_s(writeBuffer, XPLMAX_PACKETSIZE, ",%i,%f", i, newValf);
+			device->_writePacket(XPLCMD_DATAREFUPDATEFLOAT, writeBuffer);
+			device->lastSendTime = time;
+		}
+	}
+
+	if (sample->type & xplmType_FloatArray)						// process for datarefs of type float (array)
+	{
+		for (int j = 0; j < XPLMAX_ELEMENTS; j++)
+		{
+			if (!sample->readFlag[j] || sample->fixedDecimals[j] >= 0) continue;		// not subscribed, dead reckoned or fixed point
+
+			newValf = sample->f[j];
+			if (sample->precision)  newValf = ((int)(newValf / sample->precision) * sample->precision);
+
+			if (newValf != myBindings[i].currentSentf[j] || forceUpdate)
+			{
+				lastRefSent = i;
+				lastRefElementSent = j;
+				myBindings[i].currentSentf[j] = newValf;
+				sprintf_s(writeBuffer, XPLMAX_PACKETSIZE, ",%i,%f,%i", i, newValf, j);
+				device->_writePacket(XPLCMD_DATAREFUPDATEFLOATARRAY, writeBuffer);
+				device->lastSendTime = time;
+			}
+		}
+	}
+
+	if ((sample->type & xplmType_Double) && sample->readFlag[0] && sample->fixedDecimals[0] < 0)		// process for datarefs of type double
+	{
+		newValD = sample->d;
+		if (sample->precision)  newValD = ((int)(newValD / sample->precision) * sample->precision);
+
+		if (newValD != myBindings[i].currentSentD[0] || forceUpdate)
+		{
+			lastRefSent = i;
+			myBindings[i].currentSentD[0] = newValD;
+			sprintf_s(writeBuffer, XPLMAX_PACKETSIZE, ",%i,%f", i, newValD);
+			device->_writePacket(XPLCMD_DATAREFUPDATEFLOAT, writeBuffer);
+			device->lastSendTime = time;
+		}
+	}
+
+	if (sample->type & xplmType_Data)						// process for datarefs of type Data (strings)
+	{
+		newVall = sample->strLength;
+		if (newVall < 0) newVall = 0;
+
+		if (myBindings[i].stringDiff)
+		{
+			_sendStringPatches(device, sample, time);
+		}
+		else if (newVall != myBindings[i].currentSentLength || memcmp(myBindings[i].currentSents[0], sample->s, newVall) || forceUpdate)
+		{
+			_sendString(device, i, sample->s, newVall, time);
+		}
+	}
+}
+
+/*
+	_sendFixed -- elements subscribed with XPLREQUEST_UPDATES_FIXED, as value * 10^decimals so the device only parses
+		an integer.  Changes are found on the scaled value, which takes the place of precision, against its own sent
+		value so the other elements of the binding can still go out normally.  Datarefs of several types are sent
+		once, from the most precise one.
+*/
+static void _sendFixed(XPLDevice* device, DataRefSample* sample, float time)
+{
+	char writeBuffer[XPLMAX_PACKETSIZE];
+	int  i = sample->binding;
+	int  isArray = !(sample->type & (xplmType_Int | xplmType_Float | xplmType_Double));
+	long newVall;
+
+	for (int j = 0; j < (isArray ? XPLMAX_ELEMENTS : 1); j++)
+	{
+		int decimals = sample->fixedDecimals[j];
+
+		if (decimals < 0 || !sample->readFlag[j]) continue;
+
+		if (sample->type & xplmType_Double)									newVall = fixedFromValue(sample->d, decimals);
+		else if (sample->type & (xplmType_Float | xplmType_FloatArray))		newVall = fixedFromValue(sample->f[j], decimals);
+		else																newVall = fixedFromValue(sample->l[j], decimals);
+
+		if (newVall == myBindings[i].currentSentFixed[j] && !sample->forceUpdate) continue;
+
+		lastRefSent = i;
+		lastRefElementSent = j;
+		myBindings[i].currentSentFixed[j] = newVall;
+		sprintf_s(writeBuffer, XPLMAX_PACKETSIZE, ",%i,%ld,%i,%i", i, newVall, decimals, j);
+		device->_writePacket(XPLCMD_DATAREFUPDATEFIXED, writeBuffer);
+		device->lastSendTime = time;
+	}
+}
+
+/*
+	_sendString -- the whole string, as a frame with the length followed by the raw bytes
+*/
+static void _sendString(XPLDevice* device, int i, char* string, int length, float time)
+{
+	char writeBuffer[XPLMAX_PACKETSIZE];
+
+	lastRefSent = i;
+	lastRefElementSent = 0;
+	memcpy(myBindings[i].currentSents[0], string, length);
+	myBindings[i].currentSents[0][length] = 0;
+	myBindings[i].currentSentLength = length;
+	myBindings[i].stringSentTime = time;
+
+	sprintf_s(writeBuffer, XPLMAX_PACKETSIZE, ",%i,%i", i, length);
+	device->_writePacketN(XPLCMD_DATAREFUPDATESTRING, writeBuffer, string, length);
+	device->lastSendTime = time;
+}
+
+/*
+	_sendStringPatches -- only the parts of the string that changed, as (offset, length, bytes).  Differences close
+		together go in one patch.  Falls back to the whole string when the length changed, when patches wouldn't be
+		smaller, when forced and every stringResync seconds so a device that missed something catches up.
+*/
+static void _sendStringPatches(XPLDevice* device, DataRefSample* sample, float time)
+{
+	char writeBuffer[XPLMAX_PACKETSIZE];
+	int  i = sample->binding;
+	int  length = sample->strLength;
+	char* sent = myBindings[i].currentSents[0];
+
+	int  patchOffset[XPL_STRINGPATCH_MAX];
+	int  patchLength[XPL_STRINGPATCH_MAX];
+	int  patchCount = 0;
+	int  patchBytes = 0;
+	int  pos = 0;
+
+	if (length < 0) length = 0;
+
+	if (sample->forceUpdate || length != myBindings[i].currentSentLength
+		|| (myBindings[i].stringResync > 0 && time - myBindings[i].stringSentTime >= myBindings[i].stringResync))
+	{
+		_sendString(device, i, sample->s, length, time);
+		return;
+	}
+
+	while (pos < length)
+	{
+		if (sample->s[pos] == sent[pos])
+		{
+			pos++;
+			continue;
+		}
+
+		// a difference, extend the patch until XPL_STRINGPATCH_GAP bytes in a row are unchanged
+		int start = pos;
+		int end = pos + 1;
+
+		for (pos = end; pos < length && pos < end + XPL_STRINGPATCH_GAP; pos++)
+			if (sample->s[pos] != sent[pos]) end = pos + 1;
+		pos = end;
+
+		if (patchCount >= XPL_STRINGPATCH_MAX)
+		{
+			_sendString(device, i, sample->s, length, time);
+			return;
+		}
+
+		patchOffset[patchCount] = start;
+		patchLength[patchCount] = end - start;
+		patchBytes += end - start + 12;								// about the size of the frame around it
+		patchCount++;
+	}
+
+	if (!patchCount) return;
+
+	if (patchBytes >= length + 10)
+	{
+		_sendString(device, i, sample->s, length, time);
+		return;
+	}
+
+	lastRefSent = i;
+	lastRefElementSent = 0;
+
+	for (int p = 0; p < patchCount; p++)
+	{
+		memcpy(&sent[patchOffset[p]], &sample->s[patchOffset[p]], patchLength[p]);
+
+		sprintf_s(writeBuffer, XPLMAX_PACKETSIZE, ",%i,%i,%i", i, patchOffset[p], patchLength[p]);
+		device->_writePacketN(XPLCMD_DATAREFUPDATESTRINGPATCH, writeBuffer, &sample->s[patchOffset[p]], patchLength[p]);
+	}
+	device->lastSendTime = time;
+}
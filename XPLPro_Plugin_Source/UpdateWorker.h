@@ -0,0 +1,51 @@
+#pragma once
+#include "XPLProCommon.h"
+
+#include <vector>
+
+/*
+	Dataref updates are done in two stages.  The flight loop only reads the subscribed datarefs into a snapshot
+	(XPLMGetData* has to run on the sim thread).  The worker thread compares the snapshot with what was last sent,
+	applies precision, formats the frames and writes them to the devices.
+*/
+
+struct DataRefSample
+{
+	int				binding;							// index into myBindings
+	int				deviceIndex;						// copied so the worker doesn't depend on the binding changing underneath it
+	XPLMDataTypeID	type;
+	float			precision;
+	int				fixedDecimals[XPLMAX_ELEMENTS];
+	int				readFlag[XPLMAX_ELEMENTS];
+	int				forceUpdate;						// send even if unchanged
+	int				gated;								// gate just closed, send the gated marker instead of values
+
+	long			l[XPLMAX_ELEMENTS];
+	float			f[XPLMAX_ELEMENTS];
+	double			d;
+	int				strLength;
+	int				strOffset;							// where the string is in the snapshot's string store
+	char*			s;									// set from strOffset when the snapshot is published
+
+	int				echoFlag[XPLMAX_ELEMENTS];			// device wrote this element since the last snapshot, don't send it back
+	long			echol[XPLMAX_ELEMENTS];
+	float			echof[XPLMAX_ELEMENTS];
+	long			echoFixed[XPLMAX_ELEMENTS];
+};
+
+struct DataRefSnapshot
+{
+	int				count;
+	float			time;								// elapsedTime when gathered
+	DataRefSample	samples[XPL_MAXDATAREFS_PC];
+	std::vector<char> strings;							// string datarefs of all samples, each only as long as it is
+};
+
+void updateWorkerStart(void);
+void updateWorkerStop(void);
+int  updateWorkerActive(void);
+
+DataRefSnapshot* updateWorkerSnapshot(void);			// buffer for the flight loop to fill
+void updateWorkerPublish(void);							// hand it over, replaces a snapshot the worker hasn't picked up yet
+void updateWorkerWait(void);							// until the worker has sent everything published
+void updateWorkerTiming(double* sum, double* max);		// us spent sending since the last call, total and longest snapshot
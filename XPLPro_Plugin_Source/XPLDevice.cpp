@@ -21,6 +21,9 @@
 #include "DataTransfer.h"
 #include "XPLDevice.h"
 
+#include <math.h>
+#include <atomic>
+
 extern long int packetsSent;
 extern long int packetsReceived;
 extern FILE* serialLogFile;			// for serial data log
@@ -35,15 +38,21 @@ extern CommandBinding myCommands[XPL_MAXCOMMANDS_PC];
 extern DataRefBinding myBindings[XPL_MAXDATAREFS_PC];
 
 extern int lastRefReceived;
-extern int lastRefSent;
+extern std::atomic<int> lastRefSent;
 extern int lastCmdAction;
-extern int lastRefElementSent;
+extern std::atomic<int> lastRefElementSent;
 extern int lastRefElementReceived;
+extern int inboundWritesPending;
+extern int reloadRequested;
 
 XPLDevice::XPLDevice(int inReference)
 {
 	bufferPosition = 0;
 	readBuffer[0] = '\0';
+	readFrameSize = XPLMAX_PACKETSIZE;
+	maxFrameSize = XPLMAX_PACKETSIZE;
+	protocolVersion = 0;
+	features = 0;
 	lastDebugMessageReceived[0] = '\0';
 	RefsLoaded = 0;
 	lastSendTime = 0;
@@ -54,6 +63,9 @@ XPLDevice::XPLDevice(int inReference)
 
 	minTimeBetweenFrames = XPL_MILLIS_BETWEEN_FRAMES_DEFAULT;
 
+	for (int i = 0; i < XPLSTAT_COUNT; i++) stats[i] = 0;
+	statsTime = 0;
+
 }
 
 XPLDevice::~XPLDevice()
@@ -76,46 +88,61 @@ void XPLDevice::setActive(int flag)
 }
 
 
-void XPLDevice::processSerial(void)
+int XPLDevice::hasFeature(unsigned long feature)
 {
-	do
-	{
-		while (port->readData(&readBuffer[bufferPosition], 1))
-		{
-			readBuffer[bufferPosition + 1] = '\0';
-			//fprintf(errlog, "Buffer currently: %s\r\n", readBuffer);
 
+	return (features & feature) == feature;
 
-			if (readBuffer[0] != XPL_PACKETHEADER)
-			{
-				readBuffer[0] = '\0';
-				bufferPosition = -1;
-			}
+}
 
+int XPLDevice::isRegistering(void)
+{
 
-			if (readBuffer[0] == XPL_PACKETHEADER
-				&& readBuffer[bufferPosition] == XPL_PACKETTRAILER)
+	return _flightLoopPause;
 
-			{
+}
 
-				_processPacket();
-				readBuffer[0] = '\0';
-				bufferPosition = -1;
-			}
+int XPLDevice::processSerial(int maxPackets)
+{
+	int packets = 0;
 
+	while (packets < maxPackets && port->readData(&readBuffer[bufferPosition], 1))
+	{
+		readBuffer[bufferPosition + 1] = '\0';
+		//fprintf(errlog, "Buffer currently: %s\r\n", readBuffer);
 
-			if (strlen(readBuffer) >= XPLMAX_PACKETSIZE)
-			{
-				readBuffer[0] = '\0';    // packet size exceeded / bad packet
-				bufferPosition = -1;
-			}
 
+		if (readBuffer[0] != XPL_PACKETHEADER)
+		{
+			readBuffer[0] = '\0';
+			bufferPosition = -1;
+		}
 
-			bufferPosition++;
-			readBuffer[bufferPosition] = '\0';
+
+		if (readBuffer[0] == XPL_PACKETHEADER
+			&& readBuffer[bufferPosition] == XPL_PACKETTRAILER)
+
+		{
+
+			_processPacket();
+			packets++;
+			readBuffer[0] = '\0';
+			bufferPosition = -1;
 		}
-	
-	} while (_flightLoopPause);
+
+
+		if (bufferPosition + 1 >= readFrameSize)
+		{
+			readBuffer[0] = '\0';    // packet size exceeded / bad packet
+			bufferPosition = -1;
+		}
+
+
+		bufferPosition++;
+		readBuffer[bufferPosition] = '\0';
+	}
+
+	return packets;
 
 }
 
@@ -150,8 +177,14 @@ void XPLDevice::_processPacket(void)
 
 	case XPLREQUEST_REGISTERDATAREF:
 	{
-		
-		_parseString(myBindings[refHandleCounter].xplaneDataRefName, readBuffer,2, 80 );
+		if (refHandleCounter >= XPL_MAXDATAREFS_PC)
+		{
+			_writePacket(XPLRESPONSE_DATAREF, ",-03");
+			fprintf(errlog, "   Device %s is requesting a dataref but all %i are in use, sorry.\n", deviceName, XPL_MAXDATAREFS_PC);
+			break;
+		}
+
+		_parseString(myBindings[refHandleCounter].xplaneDataRefName, readBuffer, 2, sizeof(myBindings[refHandleCounter].xplaneDataRefName));
 		//_parseInt(&myBindings[refHandleCounter].RWMode, readBuffer, 3);
 		
 		fprintf(errlog, "\n   Device %s is requesting handle for dataref: \"%s\"...", deviceName, myBindings[refHandleCounter].xplaneDataRefName);
@@ -169,6 +202,14 @@ void XPLDevice::_processPacket(void)
 			
 			myBindings[refHandleCounter].bindingActive = 1;
 			myBindings[refHandleCounter].deviceIndex = _referenceID;
+			myBindings[refHandleCounter].rateClass = -1;			// until the device subscribes
+			myBindings[refHandleCounter].gate = -1;
+			myBindings[refHandleCounter].gatedMarkerSent = 0;
+			myBindings[refHandleCounter].touch = 0;
+			myBindings[refHandleCounter].stringDiff = 0;
+			for (int j = 0; j < XPLMAX_ELEMENTS; j++) myBindings[refHandleCounter].fixedDecimals[j] = -1;
+			myBindings[refHandleCounter].currentSentLength = -1;
+			myBindings[refHandleCounter].stringLimit = 0;
 			//myBindings[refHandleCounter].xplaneDataRefArrayOffset = atoi(arrayReference);
 			//myBindings[refHandleCounter].divider = atof(dividerString);
 			//myBindings[refHandleCounter].RWMode = readBuffer[2] - '0';
@@ -188,7 +229,7 @@ void XPLDevice::_processPacket(void)
 			if (myBindings[refHandleCounter].xplaneDataRefTypeID & xplmType_Data)
 				{
 					fprintf(errlog, "      This dataref returns that it is of type: data ***Currently supported only for data sent from xplane (read only)***\n");
-					myBindings[refHandleCounter].currentSents[0] = (char*)malloc(XPLMAX_PACKETSIZE - 5);
+					myBindings[refHandleCounter].currentSents[0] = (char*)calloc(XPLMAX_FRAMESIZE - 4, 1);	// up to the longest stringLimit, room for a terminator for the status window
 				}
 			
 
@@ -214,8 +255,12 @@ void XPLDevice::_processPacket(void)
 		_parseInt(&rate, readBuffer, 3);
 		_parseFloat(&precision, readBuffer, 4);
 
+		if (!_validBinding(bindingNumber)) break;
+
 		myBindings[bindingNumber].readFlag[0] = 1;
+		myBindings[bindingNumber].fixedDecimals[0] = -1;
 		myBindings[bindingNumber].updateRate = rate;
+		_scheduleBinding(bindingNumber);
 		myBindings[bindingNumber].precision = precision;
 		fprintf(errlog, "   Device requested that %s dataref be updated at rate: %i and precision %f\n", myBindings[bindingNumber].xplaneDataRefName, rate, precision);
 
@@ -229,30 +274,154 @@ void XPLDevice::_processPacket(void)
 		_parseFloat(&precision, readBuffer, 4);
 		_parseInt(&element, readBuffer, 5);
 
+		if (!_validBinding(bindingNumber) || element < 0 || element >= XPLMAX_ELEMENTS) break;
+
 		myBindings[bindingNumber].readFlag[element] = 1;
+		myBindings[bindingNumber].fixedDecimals[element] = -1;
 		myBindings[bindingNumber].updateRate = rate;
+		_scheduleBinding(bindingNumber);
 		myBindings[bindingNumber].precision = precision;
 		fprintf(errlog, "   Device requested that %s dataref element %i be updated at rate: %i and precision %f\n", myBindings[bindingNumber].xplaneDataRefName, element, rate, precision);
 
 		break;
 
+	case XPLREQUEST_UPDATES_DR:
+
+		_parseInt(&bindingNumber, readBuffer, 2);
+		_parseInt(&rate, readBuffer, 3);
+		_parseFloat(&precision, readBuffer, 4);			// for value + rate updates this is the tolerance
+		_parseInt(&element, readBuffer, 5);				// 0 if not specified
+
+		if (!_validBinding(bindingNumber) || element < 0 || element >= XPLMAX_ELEMENTS) break;
+
+		myBindings[bindingNumber].drActive = 1;
+		myBindings[bindingNumber].drFlag[element] = 1;
+		myBindings[bindingNumber].drTolerance = precision;
+		myBindings[bindingNumber].drSampleTime[element] = -1;	// forces an update on the next cycle
+		myBindings[bindingNumber].updateRate = rate;
+		_scheduleBinding(bindingNumber);
+		fprintf(errlog, "   Device requested that %s dataref element %i be updated as value + rate with tolerance %f\n", myBindings[bindingNumber].xplaneDataRefName, element, precision);
+
+		break;
+
+	case XPLREQUEST_UPDATES_FIXED:
+	{
+		int decimals;
+
+		_parseInt(&bindingNumber, readBuffer, 2);
+		_parseInt(&rate, readBuffer, 3);
+		_parseInt(&decimals, readBuffer, 4);
+		_parseInt(&element, readBuffer, 5);
+
+		if (!_validBinding(bindingNumber) || element < 0 || element >= XPLMAX_ELEMENTS) break;
+		if (decimals < 0) decimals = 0;
+		if (decimals > XPL_FIXED_MAXDECIMALS) decimals = XPL_FIXED_MAXDECIMALS;
+
+		myBindings[bindingNumber].readFlag[element] = 1;
+		myBindings[bindingNumber].updateRate = rate;
+		myBindings[bindingNumber].fixedDecimals[element] = decimals;	// takes the place of precision for this element
+		_scheduleBinding(bindingNumber);
+		fprintf(errlog, "   Device requested that %s dataref element %i be updated at rate: %i as fixed point with %i decimals\n", myBindings[bindingNumber].xplaneDataRefName, element, rate, decimals);
+
+		break;
+	}
+
+	case XPLREQUEST_GATE:
+	{
+		int gateBinding;
+		int condition;
+		float threshold;
+
+		_parseInt(&bindingNumber, readBuffer, 2);
+		_parseInt(&gateBinding, readBuffer, 3);
+		_parseInt(&condition, readBuffer, 4);
+		_parseFloat(&threshold, readBuffer, 5);
+		_parseInt(&element, readBuffer, 6);				// element of the gate dataref, 0 if not specified
+
+		if (!_validBinding(bindingNumber) || !_validBinding(gateBinding)) break;
+		if (element < 0 || element >= XPLMAX_ELEMENTS) break;
+
+		myBindings[bindingNumber].gate = _findGate(gateBinding, element, condition, threshold);
+		myBindings[bindingNumber].gatedMarkerSent = 0;
+		fprintf(errlog, "   Device requested that updates to %s be gated by %s element %i, condition %i, threshold %f\n",
+			myBindings[bindingNumber].xplaneDataRefName, myBindings[gateBinding].xplaneDataRefName, element, condition, threshold);
+		if (myBindings[bindingNumber].gate < 0) fprintf(errlog, "      Too many gates, updates will not be gated.\n");
+
+		break;
+	}
+
+	case XPLREQUEST_UPDATES_STRINGDIFF:
+	{
+		long int resync;
+
+		_parseInt(&bindingNumber, readBuffer, 2);
+		_parseInt(&rate, readBuffer, 3);
+		_parseInt(&resync, readBuffer, 4);				// ms between full strings, 0 for never
+
+		if (!_validBinding(bindingNumber)) break;
+
+		myBindings[bindingNumber].readFlag[0] = 1;
+		myBindings[bindingNumber].updateRate = rate;
+		myBindings[bindingNumber].stringDiff = 1;
+		myBindings[bindingNumber].stringResync = resync / 1000.f;
+		_scheduleBinding(bindingNumber);
+		fprintf(errlog, "   Device requested that %s dataref be updated at rate: %i as string patches, full string every %i ms\n", myBindings[bindingNumber].xplaneDataRefName, rate, resync);
+
+		break;
+	}
+
+	case XPLREQUEST_STRINGSIZE:
+	{
+		int size;
+
+		if (!hasFeature(XPLFEATURE_FRAMESIZE)) break;
+
+		_parseInt(&bindingNumber, readBuffer, 2);
+		_parseInt(&size, readBuffer, 3);
+
+		if (!_validBinding(bindingNumber) || !(myBindings[bindingNumber].xplaneDataRefTypeID & xplmType_Data)) break;
+
+		// the string doesn't go through the device's receive buffer, only the frame header in front of it does
+		myBindings[bindingNumber].stringLimit = size < 1 ? 1 : size > XPLMAX_FRAMESIZE - 4 ? XPLMAX_FRAMESIZE - 5 : size - 1;
+		fprintf(errlog, "   Device keeps %s in a buffer of %i bytes, sending strings up to %i\n", myBindings[bindingNumber].xplaneDataRefName, size, myBindings[bindingNumber].stringLimit);
+
+		break;
+	}
+
+	case XPLREQUEST_DATAREFTOUCH:
+
+		_parseInt(&bindingNumber, readBuffer, 2);
+		if (!_validBinding(bindingNumber)) break;
+
+		myBindings[bindingNumber].touch = 1;			// sent in full with the next update
+		break;
+
 	case XPLREQUEST_SCALING:
 		_parseInt(&bindingNumber, readBuffer, 2);
+		if (!_validBinding(bindingNumber)) break;
+
 		_parseInt(&myBindings[bindingNumber].scaleFromLow, readBuffer, 3);
 		_parseInt(&myBindings[bindingNumber].scaleFromHigh, readBuffer, 4);
 		_parseInt(&myBindings[bindingNumber].scaleToLow, readBuffer, 5);
 		_parseInt(&myBindings[bindingNumber].scaleToHigh, readBuffer, 6);
-		myBindings[bindingNumber].scaleFlag = 1;
+		myBindings[bindingNumber].scaleFlag = myBindings[bindingNumber].scaleFromHigh != myBindings[bindingNumber].scaleFromLow;	// mapInt divides by the difference
 
 		break;
 
 	case XPLREQUEST_REGISTERCOMMAND:
 	{
+		if (cmdHandleCounter >= XPL_MAXCOMMANDS_PC)
+		{
+			_writePacket(XPLRESPONSE_COMMAND, ",-03");
+			fprintf(errlog, "   Device %s is requesting a command but all %i are in use, sorry.\n", deviceName, XPL_MAXCOMMANDS_PC);
+			break;
+		}
 
-		_parseString(myCommands[cmdHandleCounter].xplaneCommandName, readBuffer, 2, 80);
+		_parseString(myCommands[cmdHandleCounter].xplaneCommandName, readBuffer, 2, sizeof(myCommands[cmdHandleCounter].xplaneCommandName));
 		
 		fprintf(errlog, "   Device %s is requesting command: %s...", deviceName, myCommands[cmdHandleCounter].xplaneCommandName);
 
+		myCommands[cmdHandleCounter].eventsRequested = 0;
 		myCommands[cmdHandleCounter].xplaneCommandHandle = XPLMFindCommand(myCommands[cmdHandleCounter].xplaneCommandName);
 		if (myCommands[cmdHandleCounter].xplaneCommandHandle == NULL)   // if not found, try searching the abbreviations file before giving up
 		{
@@ -285,7 +454,7 @@ void XPLDevice::_processPacket(void)
 		else
 
 		{
-			sprintf_s(writeBuffer, XPLMAX_PACKETSIZE, ",-02,\"%s\"", &readBuffer[2]);
+			sprintf_s(writeBuffer, XPLMAX_PACKETSIZE, ",-02,\"%s\"", myCommands[cmdHandleCounter].xplaneCommandName);
 			_writePacket(XPLRESPONSE_COMMAND, writeBuffer);
 			myCommands[cmdHandleCounter].bindingActive = 0;
 			fprintf(errlog, "   requested Command not found, sorry. \n   I sent back data frame: %s\n", writeBuffer);
@@ -296,99 +465,99 @@ void XPLDevice::_processPacket(void)
 		break;
 	}
 
+	case XPLREQUEST_COMMANDEVENTS:
+	{
+		int commandNumber;
+
+		if (!hasFeature(XPLFEATURE_COMMANDEVENTS)) break;
+
+		_parseInt(&commandNumber, readBuffer, 2);
+
+		if (!_validCommand(commandNumber)) break;
+
+		_subscribeCommandEvents(commandNumber);
+		fprintf(errlog, "   Device %s requested begin and end events for command %s\n", deviceName, myCommands[commandNumber].xplaneCommandName);
+
+		break;
+	}
+
 	case XPLCMD_DATAREFUPDATEINT:
 	case XPLCMD_DATAREFUPDATEFLOAT:
 	case XPLCMD_DATAREFUPDATEFLOATARRAY:
 	case XPLCMD_DATAREFUPDATEINTARRAY:
+	case XPLCMD_DATAREFUPDATEFIXED:
 	{
 		
 		float tempFloat;
 		int tempInt;
-		int tempElement;
+		int tempElement = 0;
 
 		//	fprintf(errlog, "Device is sending dataRef update with packet: %s \r\n", strippedPacket);
 
 		_parseInt(&bindingNumber, readBuffer, 2);
 
-		if (bindingNumber < 0 && bindingNumber > refHandleCounter) break;
+		if (!_validBinding(bindingNumber)) break;
 
-		lastRefReceived = bindingNumber;			// for the status window
-
-		if (myBindings[bindingNumber].xplaneDataRefTypeID & xplmType_Int)
+		if (myBindings[bindingNumber].xplaneDataRefTypeID & (xplmType_IntArray | xplmType_FloatArray))
 		{
-			_parseInt(&tempInt, readBuffer, 3);
-			if (myBindings[bindingNumber].scaleFlag) tempInt = mapInt(tempInt,	myBindings[bindingNumber].scaleFromLow,
-																				myBindings[bindingNumber].scaleFromHigh,
-																				myBindings[bindingNumber].scaleToLow,
-																				myBindings[bindingNumber].scaleToHigh);
-			
-			XPLMSetDatai(myBindings[bindingNumber].xplaneDataRefHandle, tempInt);
-			myBindings[bindingNumber].currentReceivedl[0] = tempInt;
-			myBindings[bindingNumber].currentSentl[0] = tempInt;
+			_parseInt(&tempElement, readBuffer, readBuffer[1] == XPLCMD_DATAREFUPDATEFIXED ? 5 : 4);
+			if (tempElement < 0 || tempElement >= XPLMAX_ELEMENTS) break;
 		}
-		
-		if (myBindings[bindingNumber].xplaneDataRefTypeID & xplmType_Float)
+
+		lastRefReceived = bindingNumber;			// for the status window
+		lastRefElementReceived = tempElement;
+
+		if (readBuffer[1] == XPLCMD_DATAREFUPDATEFIXED)		// value * 10^decimals, decimals
 		{
-			
-			_parseFloat(&tempFloat, readBuffer, 3);
-			if (myBindings[bindingNumber].scaleFlag) tempFloat = mapFloat(tempFloat,	myBindings[bindingNumber].scaleFromLow,
-																						myBindings[bindingNumber].scaleFromHigh,
-																						myBindings[bindingNumber].scaleToLow,
-																						myBindings[bindingNumber].scaleToHigh);
+			long int fixedValue;
+			int decimals;
 
+			_parseInt(&fixedValue, readBuffer, 3);
+			_parseInt(&decimals, readBuffer, 4);
 
-			XPLMSetDataf(myBindings[bindingNumber].xplaneDataRefHandle, tempFloat);
-			myBindings[bindingNumber].currentReceivedf[0] = tempFloat;
-			myBindings[bindingNumber].currentSentf[0] = tempFloat;
+			double value = fixedToValue(fixedValue, decimals);
+			tempFloat = (float)value;
+			tempInt = (int)floor(value + .5);
 		}
-		
-		if (myBindings[bindingNumber].xplaneDataRefTypeID & xplmType_Double)
+		else
 		{
+			_parseInt(&tempInt, readBuffer, 3);
 			_parseFloat(&tempFloat, readBuffer, 3);
-			if (myBindings[bindingNumber].scaleFlag) tempFloat = mapFloat(tempFloat,	myBindings[bindingNumber].scaleFromLow,
-																						myBindings[bindingNumber].scaleFromHigh,
-																						myBindings[bindingNumber].scaleToLow,
-																						myBindings[bindingNumber].scaleToHigh);
-			XPLMSetDatad(myBindings[bindingNumber].xplaneDataRefHandle, tempFloat);
-			myBindings[bindingNumber].currentReceivedf[0] = tempFloat;
-			myBindings[bindingNumber].currentSentf[0] = tempFloat;
-			
 		}
 
-		
-		if (myBindings[bindingNumber].xplaneDataRefTypeID & xplmType_IntArray)
+		if (myBindings[bindingNumber].scaleFlag)
 		{
-			_parseInt(&tempInt, readBuffer, 3);
-			_parseInt(&tempElement, readBuffer, 4);// need error checking here
-
-			if (myBindings[bindingNumber].scaleFlag) tempInt = mapInt(tempInt,	myBindings[bindingNumber].scaleFromLow,
-																				myBindings[bindingNumber].scaleFromHigh,
-																				myBindings[bindingNumber].scaleToLow,
-																				myBindings[bindingNumber].scaleToHigh);
-
-			XPLMSetDatavi(myBindings[bindingNumber].xplaneDataRefHandle, &tempInt, tempElement, 1);
-			myBindings[bindingNumber].currentReceivedl[tempElement] = tempInt;
-			myBindings[bindingNumber].currentSentl[tempElement] = tempInt;
-			myBindings[bindingNumber].currentElementSent[tempElement] = tempElement;
-			
+			tempInt = mapInt(tempInt,		myBindings[bindingNumber].scaleFromLow,
+											myBindings[bindingNumber].scaleFromHigh,
+											myBindings[bindingNumber].scaleToLow,
+											myBindings[bindingNumber].scaleToHigh);
+			tempFloat = mapFloat(tempFloat,	myBindings[bindingNumber].scaleFromLow,
+											myBindings[bindingNumber].scaleFromHigh,
+											myBindings[bindingNumber].scaleToLow,
+											myBindings[bindingNumber].scaleToHigh);
 		}
 
-		if (myBindings[bindingNumber].xplaneDataRefTypeID & xplmType_FloatArray)						// process for datarefs of type float (array)
-		{
-			_parseFloat(&tempFloat, readBuffer, 3);
-			_parseInt(&tempElement, readBuffer, 4);		// need error checking here
+		// staged here, set once per frame by _applyInboundWrites with the latest value
+		myBindings[bindingNumber].writesReceived++;
+		if (myBindings[bindingNumber].pendingFlag[tempElement]) myBindings[bindingNumber].writesFolded++;
+
+		myBindings[bindingNumber].pendingFlag[tempElement] = 1;
+		myBindings[bindingNumber].pendingl[tempElement] = tempInt;
+		myBindings[bindingNumber].pendingf[tempElement] = tempFloat;
+		inboundWritesPending = 1;
 
-			if (myBindings[bindingNumber].scaleFlag) tempFloat = mapFloat(tempFloat,	myBindings[bindingNumber].scaleFromLow,
-																						myBindings[bindingNumber].scaleFromHigh,
-																						myBindings[bindingNumber].scaleToLow,
-																						myBindings[bindingNumber].scaleToHigh);
+		myBindings[bindingNumber].currentReceivedl[tempElement] = tempInt;
+		myBindings[bindingNumber].currentReceivedf[tempElement] = tempFloat;
 
-			XPLMSetDatavf(myBindings[bindingNumber].xplaneDataRefHandle, &tempFloat, tempElement, 1);
-			myBindings[bindingNumber].currentReceivedf[tempElement] = tempFloat;
-			myBindings[bindingNumber].currentSentf[tempElement] = tempFloat;
-			lastRefElementSent = tempElement;
+		// so the value isn't echoed back to the device, the update worker picks this up with the next snapshot
+		myBindings[bindingNumber].echoFlag[tempElement] = 1;
+		myBindings[bindingNumber].echol[tempElement] = tempInt;
+		myBindings[bindingNumber].echof[tempElement] = tempFloat;
+		if (myBindings[bindingNumber].fixedDecimals[tempElement] >= 0)	// fixed point elements are compared in the units sent
+		{
+			double echoValue = (myBindings[bindingNumber].xplaneDataRefTypeID & (xplmType_Float | xplmType_FloatArray | xplmType_Double)) ? tempFloat : tempInt;
+			myBindings[bindingNumber].echoFixed[tempElement] = fixedFromValue(echoValue, myBindings[bindingNumber].fixedDecimals[tempElement]);
 		}
-		
 
 		break;
 		
@@ -409,7 +578,7 @@ void XPLDevice::_processPacket(void)
 		fprintf(errlog, "Command received for myCommands[%i].  cmdHandleCounter = %i. triggerCount: %i.  readBuffer: %s\n", commandNumber, cmdHandleCounter, triggerCount, readBuffer);
 
 
-		if (commandNumber < 0 || commandNumber >= cmdHandleCounter) break;
+		if (!_validCommand(commandNumber)) break;
 
 		lastCmdAction = commandNumber;
 
@@ -447,7 +616,7 @@ void XPLDevice::_processPacket(void)
 
 	case XPLCMD_PRINTDEBUG:
 	{
-		_parseString(lastDebugMessageReceived, readBuffer, 2, 80);
+		_parseString(lastDebugMessageReceived, readBuffer, 2, sizeof(lastDebugMessageReceived));
 		fprintf(errlog, "Device \"%s\" sent debug message: \"%s\"\n", deviceName, lastDebugMessageReceived);
 		
 		break;
@@ -455,15 +624,43 @@ void XPLDevice::_processPacket(void)
 
 	case XPLCMD_SPEAK:
 	{
-		_parseString(speechBuf, readBuffer, 2, 80);
+		_parseString(speechBuf, readBuffer, 2, sizeof(speechBuf));
 		XPLMSpeakString(&readBuffer[2]);
 		break;
 	}
 
+	case XPLRESPONSE_CAPABILITIES:
+	{
+		long deviceFeatures;
+
+		_parseInt(&protocolVersion, readBuffer, 2);
+		_parseInt(&deviceFeatures, readBuffer, 3);
+		features = (unsigned long)deviceFeatures & XPL_FEATURES;
+
+		break;
+	}
+
+	case XPLRESPONSE_FRAMESIZE:
+	{
+		int receiveSize, transmitSize;
+
+		if (!hasFeature(XPLFEATURE_FRAMESIZE)) break;
+
+		_parseInt(&receiveSize, readBuffer, 2);
+		_parseInt(&transmitSize, readBuffer, 3);
+
+		maxFrameSize = receiveSize < XPLMAX_PACKETSIZE ? XPLMAX_PACKETSIZE : receiveSize > XPLMAX_FRAMESIZE ? XPLMAX_FRAMESIZE : receiveSize;
+		readFrameSize = transmitSize < XPLMAX_PACKETSIZE ? XPLMAX_PACKETSIZE : transmitSize > XPLMAX_FRAMESIZE ? XPLMAX_FRAMESIZE : transmitSize;
+
+		fprintf(errlog, "   Device on %s advertises frames of %i bytes in, %i out.  Using %i, %i.\n", port->portName, receiveSize, transmitSize, maxFrameSize, readFrameSize);
+
+		break;
+	}
+
 	case XPLRESPONSE_NAME:
 	{
 		
-		_parseString(deviceName, readBuffer, 2, 80);
+		_parseString(deviceName, readBuffer, 2, sizeof(deviceName));
 		setActive(1);
 		
 		break;
@@ -482,6 +679,21 @@ void XPLDevice::_processPacket(void)
 		break;
 	}
 
+	case XPLCMD_DEVICESTATS:
+	{
+		long value;
+
+		for (int i = 0; i < XPLSTAT_COUNT; i++)
+		{
+			_parseInt(&value, readBuffer, i + 2);
+			if (i >= XPLSTAT_RXDROPPED) stats[i] += value;
+			else                        stats[i] = value;
+		}
+		statsTime = elapsedTime;
+
+		break;
+	}
+
 	case XPLREQUEST_NOREQUESTS:
 	{
 		//RefsLoaded = 1;
@@ -491,7 +703,7 @@ void XPLDevice::_processPacket(void)
 
 	case XPLCMD_RESET:
 	{
-		reloadDevices();
+		reloadRequested = 1;			// not from here, reloading deletes this device
 		break;
 	}
 
@@ -504,6 +716,20 @@ void XPLDevice::_processPacket(void)
 	}
 }
 
+int XPLDevice::_validBinding(int binding)
+{
+
+	return binding >= 0 && binding < refHandleCounter && myBindings[binding].bindingActive && myBindings[binding].deviceIndex == _referenceID;
+
+}
+
+int XPLDevice::_validCommand(int command)
+{
+
+	return command >= 0 && command < cmdHandleCounter && myCommands[command].bindingActive && myCommands[command].deviceIndex == _referenceID;
+
+}
+
 int XPLDevice::_parseString(char *outBuffer, char *inBuffer, int parameter, int maxSize)		// todo:  Confirm 0 length strings ("") dont cause issues
 {
 	int cBeg;
@@ -514,16 +740,17 @@ int XPLDevice::_parseString(char *outBuffer, char *inBuffer, int parameter, int
 	{
 
 		while (inBuffer[pos] != ',' && inBuffer[pos] != NULL ) pos++;
-		pos++;
+		if (inBuffer[pos] != NULL) pos++;
 
 	}
 	
 	while (inBuffer[pos] != '\"' && inBuffer[pos] != NULL) pos++;
-	cBeg = ++pos;
+	if (inBuffer[pos] != NULL) pos++;
+	cBeg = pos;
 
 	while (inBuffer[pos] != '\"' && inBuffer[pos] != NULL) pos++;
 	len = pos - cBeg;
-	if (len > maxSize) len = maxSize;
+	if (len > maxSize - 1) len = maxSize - 1;						// maxSize is the size of outBuffer, leave room for the terminator
 
 	
 	strncpy(outBuffer, (char*)&inBuffer[cBeg], len);
@@ -542,7 +769,7 @@ int XPLDevice::_parseInt(int *outTarget, char *inBuffer, int parameter)
 	{
 
 		while (inBuffer[pos] != ',' && inBuffer[pos] != NULL) pos++;
-		pos++;
+		if (inBuffer[pos] != NULL) pos++;				// missing parameters read as empty, not past the end of the frame
 
 	}
 	cBeg = pos;
@@ -571,7 +798,7 @@ int XPLDevice::_parseInt(long int* outTarget, char* inBuffer, int parameter)
 	{
 
 		while (inBuffer[pos] != ',' && inBuffer[pos] != NULL) pos++;
-		pos++;
+		if (inBuffer[pos] != NULL) pos++;				// missing parameters read as empty, not past the end of the frame
 
 	}
 	cBeg = pos;
@@ -601,7 +828,7 @@ int XPLDevice::_parseFloat(float* outTarget, char* inBuffer, int parameter)
 	{
 
 		while (inBuffer[pos] != ',' && inBuffer[pos] != NULL) pos++;
-		pos++;
+		if (inBuffer[pos] != NULL) pos++;				// missing parameters read as empty, not past the end of the frame
 
 	}
 	cBeg = pos;
@@ -625,39 +852,52 @@ int XPLDevice::_parseFloat(float* outTarget, char* inBuffer, int parameter)
 int XPLDevice::_writePacket(char cmd, char* packet)
 {
 	//return 0;
-	char writeBuffer[XPLMAX_PACKETSIZE];
-	snprintf(writeBuffer, XPLMAX_PACKETSIZE, "%c%c%s%c", XPL_PACKETHEADER, cmd, packet, XPL_PACKETTRAILER);
+	char writeBuffer[XPLMAX_FRAMESIZE];
+	int  frameSize;
 
+	frameSize = snprintf(writeBuffer, maxFrameSize, "%c%c%s%c", XPL_PACKETHEADER, cmd, packet, XPL_PACKETTRAILER);
+	if (frameSize < 0 || frameSize >= maxFrameSize)			// cut short it would go without its trailer
+	{
+		fprintf(errlog, "Frame too long for device %s, not sent: %c%s\n", deviceName, cmd, packet);
+		return 0;
+	}
 
-	if (serialLogFile) fprintf(serialLogFile, "et: %5.0f tx port: %s length: %3.3zi packet: %s\n", elapsedTime, port->portName, strlen(writeBuffer), writeBuffer);
-
+	std::lock_guard<std::mutex> lock(writeMutex);			// the update worker writes too
 
+	if (serialLogFile) fprintf(serialLogFile, "et: %5.0f tx port: %s length: %3.3i packet: %s\n", elapsedTime, port->portName, frameSize, writeBuffer);
 
-	if (!port->writeData(writeBuffer, strlen(writeBuffer)))
+	if (!port->writeData(writeBuffer, frameSize))
 	{
 		fprintf(errlog, "Problem occurred during write: %s.\n", writeBuffer);
 		return 0;
 	}
 
-	packetsSent++;
+	InterlockedIncrement(&packetsSent);
 
 	return 1;
 }
 
 
-int XPLDevice::_writePacketN(char cmd, char* packet, int packetSize)
+/*
+	_writePacketN -- a frame followed by dataSize raw bytes, which the device reads with readBytes.  Used for string datarefs.
+*/
+int XPLDevice::_writePacketN(char cmd, char* packet, char* data, int dataSize)
 {
 	//return 0;
-	char writeBuffer[XPLMAX_PACKETSIZE];
-	snprintf(writeBuffer, XPLMAX_PACKETSIZE, "%c%c,", XPL_PACKETHEADER, cmd);
-	memcpy((void*)&writeBuffer[3], packet, packetSize);
-	writeBuffer[packetSize + 2] = XPL_PACKETTRAILER;
-	writeBuffer[packetSize + 3] = 0;							// terminate with null
+	char writeBuffer[XPLMAX_FRAMESIZE * 2];
+	int  frameSize;
+
+	frameSize = snprintf(writeBuffer, maxFrameSize, "%c%c%s%c", XPL_PACKETHEADER, cmd, packet, XPL_PACKETTRAILER);
+	if (frameSize < 0 || frameSize >= maxFrameSize || dataSize < 0 || dataSize > XPLMAX_FRAMESIZE) return 0;	// the data can go to a string buffer of the device, see stringLimit
+
+	memcpy(&writeBuffer[frameSize], data, dataSize);
+
+	std::lock_guard<std::mutex> lock(writeMutex);			// the update worker writes too
 
 	if (serialLogFile)
 	{
-		fprintf(serialLogFile, "et: %5.0f tx port: %s length: %3.3i packet: ",elapsedTime, port->portName, packetSize + 3);
-		for (int i = 0; i < packetSize + 3; i++)
+		fprintf(serialLogFile, "et: %5.0f tx port: %s length: %3.3i packet: ",elapsedTime, port->portName, frameSize + dataSize);
+		for (int i = 0; i < frameSize + dataSize; i++)
 		{
 			if (isprint(writeBuffer[i]))	fprintf(serialLogFile, "%c", writeBuffer[i]);
 			else fprintf(serialLogFile, "~");
@@ -666,13 +906,13 @@ int XPLDevice::_writePacketN(char cmd, char* packet, int packetSize)
 
 	}
 
-	if (!port->writeData(writeBuffer, packetSize + 6))
+	if (!port->writeData(writeBuffer, frameSize + dataSize))
 	{
 		fprintf(errlog, "Problem occurred during write: %s.\n", writeBuffer);
 		return 0;
 	}
 
-	packetsSent++;
+	InterlockedIncrement(&packetsSent);
 
 	return 1;
 }
@@ -2,6 +2,20 @@
 #include "SerialClass.h"
 #include "XPLProCommon.h"
 
+#include <mutex>
+
+// fields of XPLDevice::stats, in the order the device reports them
+#define XPLSTAT_LOOPS		0			// loops in the last interval
+#define XPLSTAT_LOOPMEAN	1			// microseconds
+#define XPLSTAT_LOOPMAX		2
+#define XPLSTAT_RXWAIT		3			// microseconds waiting for the rest of a frame during the last interval
+#define XPLSTAT_CALLBACK	4			// microseconds in the inbound handler during the last interval
+#define XPLSTAT_RXDROPPED	5			// the rest are totals since the device was found
+#define XPLSTAT_FRAMESTX	6
+#define XPLSTAT_FRAMESRX	7
+#define XPLSTAT_QUEUEFULL	8			// loops the device left frames waiting because its event queue was full, 0 from older libraries
+#define XPLSTAT_COUNT		9
+
 class XPLDevice
 {
 public:
@@ -9,15 +23,22 @@ public:
 	XPLDevice(int inReference);
 	~XPLDevice();
 	int _writePacket(char cmd, char* packet);
-	int _writePacketN(char cmd, char* packet, int packetSize);
+	int _writePacketN(char cmd, char* packet, char* data, int dataSize);
 //	char* getDeviceName(void);
 //	int   getDeviceType(void);
 //	char* getLastDebugMessageReceived(void);
 	int isActive(void);						// returns true if device has communicated its name
 	void setActive(int activeFlag);
-	void processSerial(void);
+	int hasFeature(unsigned long feature);	// true if the device and the plugin both support the XPLFEATURE_ bits
+	int isRegistering(void);				// true between flight loop pause and resume, updates are held back meanwhile
+	int processSerial(int maxPackets);		// returns the number of packets processed
+	int referenceID(void) { return _referenceID; }
 
-	char   readBuffer[XPLMAX_PACKETSIZE];
+	char   readBuffer[XPLMAX_FRAMESIZE + 2];
+	int    readFrameSize;					// largest frame the device sends, XPLMAX_PACKETSIZE unless it advertised more
+	int    maxFrameSize;					// largest frame the device can receive, same
+	int    protocolVersion;					// as reported with XPLRESPONSE_CAPABILITIES, 0 for older devices
+	unsigned long features;					// XPLFEATURE_ bits both sides support
 	
 	char   lastDebugMessageReceived[80];	// what was last sent by the device as a debug string
 	float  lastSendTime;					// last time data update occurred
@@ -29,9 +50,13 @@ public:
 	//char   boardName[80];					// name of board type, implemented for XPLWizard Devices
 	
 	float  minTimeBetweenFrames;			// only implemented for dataref updates.
+
+	long   stats[XPLSTAT_COUNT];			// as reported by the device, if it has enableStats() on
+	float  statsTime;						// elapsedTime of the last report, 0 if never
 	int    bufferPosition;
 
 	serialClass* port;							// handle to open com port
+	std::mutex   writeMutex;					// frames are written from the flight loop and the update worker thread
 
 
 
@@ -39,15 +64,17 @@ private:
 	
 	void _processPacket(void);
 		
+	int _validBinding(int binding);			// index from the device is a registered, found dataref of this device
+	int _validCommand(int command);			// same for commands
 	int _parseString(char* outBuffer, char* inBuffer, int parameter, int maxSize);
 	int _parseInt(int* outTarget, char* inBuffer, int parameter);
 	int _parseInt(long int* outTarget, char* inBuffer, int parameter);
 	int _parseFloat(float* outTarget, char* inBuffer, int parameter);
 
 	int    _active;							// true if device responds
-	int    _referenceID;					// possibly temporary to id ourselves exterally
+	int    _referenceID;					// ID in the device registry, what bindings store as deviceIndex
 	
-	int _flightLoopPause;							// while initializing datarefs and commands this can be true to stop flight loop cycle.  Downside is, if it never becomes false...
+	int _flightLoopPause;							// while initializing datarefs and commands this can be true to hold back updates to this device
 	
 	
 	
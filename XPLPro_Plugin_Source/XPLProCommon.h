@@ -10,22 +10,41 @@
 #define XPL_BAUDRATE 115200
 #define XPL_MILLIS_BETWEEN_FRAMES_DEFAULT 0			// for data sends
 #define XPL_RETURN_TIME   .05							// request next visit every .05 seconds or - for cycles
+#define XPL_RATECLASSES   4								// subscriptions are sampled at 60, 30, 10 or 2 Hz, see rateClassPeriod
+#define XPL_PHASE_STEP    .6180339887					// golden ratio, spreads the sample times of a rate class evenly over its period
 #define XPL_PACKETHEADER  '['							// 
 #define XPL_PACKETTRAILER ']'									
 
 #define XPL_MAXDATAREFS_PC 1000
 #define XPL_MAXCOMMANDS_PC 1000
 
-#define XPLDEVICES_MAXDEVICES 30
+#define XPL_PACKETS_PER_ROUND 4					// inbound packets handled per device before moving on to the next device
+#define XPL_MAX_ROUNDS        8					// rounds per flight loop, whatever is left waits for the next one
 
-#define XPLMAX_PACKETSIZE 200
+#define XPLMAX_PACKETSIZE 200					// frame size for devices that don't advertise theirs, and for the plugin's own small frames
+#define XPLMAX_FRAMESIZE  2048					// largest frame size a device can negotiate with XPLRESPONSE_FRAMESIZE
 #define XPLMAX_ELEMENTS 10
+#define XPLMAX_GATES 50
 #define XPL_TIMEOUT_SECONDS 3
 
+#define XPLPHASE_SERIAL		0			// flight loop phases timed with the performance counter, see _phaseTime
+#define XPLPHASE_WRITES		1
+#define XPLPHASE_DATAREFS	2
+#define XPLPHASE_COMMANDS	3
+#define XPLPHASE_TOTAL		4
+#define XPLPHASE_SEND		5			// the update worker sending snapshots, on its own thread so not part of the total
+#define XPLPHASE_COUNT		6
+#define XPL_TIMING_INTERVAL	5			// seconds between updates of the timings in the status window
+
+#define XPL_DR_SMOOTHING .5			// weight of the newest sample when estimating the rate of change for dead reckoning updates
+#define XPL_DR_MAXEXTRAPOLATION 1.		// seconds, devices stop extrapolating after this long without an update (XPLINTERPOLATOR_MAXEXTRAPOLATION)
+
 #define XPLRESPONSE_NAME           'n'       
 #define XPLRESPONSE_DATAREF        'D'   // %3.3i%s    dataref handle, dataref name 
 #define XPLRESPONSE_COMMAND        'C'   // %3.3i%s    command handle, command name
 #define XPLRESPONSE_VERSION		   'v'	// %3.3i%u	   customer build ID, version
+#define XPLRESPONSE_FRAMESIZE	   'f'	// receive size, transmit size:  largest frames the device can take and send, before its name
+#define XPLRESPONSE_CAPABILITIES   'F'	// protocol version, feature bits:  only sent by devices that know about them, in reply to the ones in XPLCMD_SENDNAME
 #define XPLCMD_PRINTDEBUG          'g'
 #define XPLCMD_RESET               'z'
 #define XPLCMD_SPEAK				's'
@@ -40,25 +59,59 @@
 #define XPLREQUEST_UPDATESARRAY     't'
 #define XPLREQUEST_SCALING          'u'          // arduino requests the plugin apply scaling to the dataref values
 #define XPLREQUEST_DATAREFVALUE 'e'
+#define XPLREQUEST_UPDATES_DR      'h'	// arduino requests value + rate updates (dead reckoning) with an error tolerance instead of precision
+#define XPLREQUEST_UPDATES_STRINGDIFF 'l'	// handle, rate, resync ms:  string dataref sent as patches, in full every resync ms or when touched
+#define XPLREQUEST_DATAREFTOUCH    'd'	// handle:  device asks for the current value (same code as XPLREQUEST_REFRESH, which goes the other way)
+#define XPLREQUEST_GATE            'a'	// handle, gate handle, condition, threshold, gate element:  hold back updates while the gate dataref is false
+#define XPLREQUEST_UPDATES_FIXED   '8'	// handle, rate, decimals, element:  updates sent with XPLCMD_DATAREFUPDATEFIXED instead of as floats
+#define XPLREQUEST_COMMANDEVENTS   '0'	// command handle:  device wants XPLCMD_COMMANDEVENT when the command begins and ends
+#define XPLREQUEST_STRINGSIZE      'L'	// handle, buffer size:  the device keeps this string dataref in its own buffer, send strings up to size - 1 whatever the frame size
 
 #define XPLCMD_DATAREFUPDATEINT			'1'
 #define XPLCMD_DATAREFUPDATEFLOAT		'2'
 #define XPLCMD_DATAREFUPDATEINTARRAY	'3'
 #define XPLCMD_DATAREFUPDATEFLOATARRAY	'4'
-#define XPLCMD_DATAREFUPDATESTRING		'9'
+#define XPLCMD_DATAREFUPDATERATE		'5'		// value and rate of change per second, device extrapolates between updates
+#define XPLCMD_DATAREFUPDATEFIXED		'6'		// handle, value * 10^decimals, decimals, element:  both ways, boards without an FPU don't parse floats
+#define XPL_FIXED_MAXDECIMALS			6
+#define XPLCMD_DATAREFUPDATESTRING		'9'		// handle, length] + length raw bytes
+#define XPLCMD_DATAREFUPDATESTRINGPATCH	'7'		// handle, offset, length] + length raw bytes replacing the string from offset
+#define XPL_STRINGPATCH_MAX				8		// more patches than this and the whole string is sent
+#define XPL_STRINGPATCH_GAP				6		// differences closer than this go in one patch, a patch header costs about as much
+#define XPLCMD_DATAREFGATED				'x'		// handle:  gate closed, value is meaningless until the next update
 
 #define XPLCMD_SENDREQUEST         'Q'
 
 #define XPLCMD_COMMANDSTART         'i'
 #define XPLCMD_COMMANDEND           'j'
 #define XPLCMD_COMMANDTRIGGER       'k'    //  command handle, number of triggers
+#define XPLCMD_COMMANDEVENT         'E'    //  command handle, phase (xplm_CommandBegin 0 or xplm_CommandEnd 2):  the command was run, by anyone
 #define XPLCMD_SENDVERSION          'v'     // get current build version from arduino device
+#define XPLCMD_DEVICESTATS          'o'     // loops, loop mean us, loop max us, rx wait us, callback us, rx dropped, frames tx, frames rx, queue full
 
 
 #define XPL_EXITING					'X'		// xplane is closing
 
 #define XPLTYPE_XPLPRO 1
 
+// Sent with XPLCMD_SENDNAME as [N,version,features].  Devices that answer with XPLRESPONSE_CAPABILITIES use the
+// features both sides have, devices that don't are version 0 with no features and get the original protocol.
+#define XPL_PROTOCOL_VERSION		1
+#define XPLFEATURE_FRAMESIZE		0x0001		// frames larger than XPLMAX_PACKETSIZE, XPLRESPONSE_FRAMESIZE, XPLREQUEST_STRINGSIZE
+#define XPLFEATURE_BATCHING			0x0002		// several updates in one frame
+#define XPLFEATURE_BINARYFRAMES		0x0004		// binary instead of text frames
+#define XPLFEATURE_BAUDUPGRADE		0x0008		// switch to a faster baud rate after connecting
+#define XPLFEATURE_GROUPS			0x0010		// group subscriptions
+#define XPLFEATURE_SESSION			0x0020		// session tokens, resume without registering again
+#define XPLFEATURE_FIXEDPOINT		0x0040		// XPLREQUEST_UPDATES_FIXED, XPLCMD_DATAREFUPDATEFIXED
+#define XPLFEATURE_COMMANDEVENTS	0x0080		// XPLREQUEST_COMMANDEVENTS, XPLCMD_COMMANDEVENT
+#define XPL_FEATURES				(XPLFEATURE_FRAMESIZE | XPLFEATURE_FIXEDPOINT | XPLFEATURE_COMMANDEVENTS)		// what this plugin supports
+
+
+#define XPLGATE_GREATER		0		// gate is open when the gate dataref is greater than the threshold
+#define XPLGATE_LESS		1
+#define XPLGATE_EQUAL		2
+#define XPLGATE_NOTEQUAL	3
 
 #define XPL_READ		1
 #define XPL_WRITE       2
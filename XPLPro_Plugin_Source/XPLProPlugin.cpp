@@ -37,10 +37,12 @@
 
 #include "abbreviations.h"
 
-//#include "serialclass.h"
+//#include "SerialClass.h"
 
 #include "DataTransfer.h"
+#include "UpdateWorker.h"
 #include "Config.h"
+#include "TraceRecorder.h"
 
 #include "XPLProPlugin.h"
 
@@ -55,15 +57,31 @@ abbreviations gAbbreviations;
 extern long int packetsSent;
 extern long int packetsReceived;
 extern int validPorts;
+extern int reloadRequested;
 
 long cycleCount = 0l;
 float elapsedTime = 0;
 int logSerial = false;
 
+// flight loop cost per phase in microseconds, over the last XPL_TIMING_INTERVAL for the status window and over the session for the log
+const char* phaseNames[XPLPHASE_COUNT] = { "serial", "writes", "datarefs", "commands", "total", "worker send" };
+float phaseMean[XPLPHASE_COUNT];
+float phaseMax[XPLPHASE_COUNT];
+
+LARGE_INTEGER	phaseFrequency;
+double			phaseSum[XPLPHASE_COUNT];
+double			phaseIntervalMax[XPLPHASE_COUNT];
+long			phaseCycles = 0;
+float			phaseNextReport = 0;
+double			sessionSum[XPLPHASE_COUNT];
+double			sessionMax[XPLPHASE_COUNT];
+long			sessionCycles = 0;
+
 int				gClicked = 0;
 XPLMMenuID      myMenu;
 int             disengageMenuItemIndex;
 int				logSerialMenuItemIndex;
+int				traceMenuItemIndex;
 
 
 
@@ -111,6 +129,8 @@ PLUGIN_API int XPluginStart(
 	fprintf(errlog, "Plugin Path: %s\r\n", outFilePath);
 
 	// first load configuration stuff
+	QueryPerformanceFrequency(&phaseFrequency);
+
 	XPLConfig = new Config(CFG_FILE);
 	logSerial = XPLConfig->getSerialLogFlag();
 
@@ -146,6 +166,8 @@ PLUGIN_API int XPluginStart(
 	XPLMAppendMenuItem(myMenu, "Status",(void *) "Status", 1);
 	disengageMenuItemIndex = XPLMAppendMenuItem(myMenu, "Engage Devices", (void *) "Engage Devices", 1);
 	logSerialMenuItemIndex = XPLMAppendMenuItem(myMenu, "Log Serial Data", (void*) "Log Serial Data", 1);
+	traceMenuItemIndex = XPLMAppendMenuItem(myMenu, "Record Dataref Trace", (void*) "Record Dataref Trace", 1);
+	XPLMCheckMenuItem(myMenu, traceMenuItemIndex, xplm_Menu_Unchecked);
 	XPLMAppendMenuSeparator(myMenu);
 
 
@@ -159,6 +181,8 @@ PLUGIN_API int XPluginStart(
 		NULL);					// refcon not used. 
 	
 
+	statusDataRefsRegister();					// per device instrumentation, see XPLPro::enableStats() on the arduino side
+
 	ResetCommand = XPLMCreateCommand("XPLPro/ResetDevices", "Disengage / re-engage XPLPro Devices");
 	XPLMRegisterCommandHandler(ResetCommand,              // in Command name
 		ResetCommandHandler,       // in Handler
@@ -189,7 +213,15 @@ PLUGIN_API void	XPluginStop(void)
 
 	
 	disengageDevices();
+	traceStop();
+	statusDataRefsUnregister();
 	if (errlog) fprintf(errlog, "Ending plugin, cycle count: %u Packets transmitted: %u, Packets Received: %u\n", cycleCount, packetsSent, packetsReceived);
+	if (errlog && sessionCycles)
+	{
+		fprintf(errlog, "Flight loop timing over %li cycles, mean / max us:", sessionCycles);
+		for (int i = 0; i < XPLPHASE_COUNT; i++) fprintf(errlog, "  %s %.1f / %.1f", phaseNames[i], sessionSum[i] / sessionCycles, sessionMax[i]);
+		fprintf(errlog, "\n");
+	}
 	if (errlog) fclose(errlog);
 
 
@@ -304,11 +336,69 @@ void	MyMenuHandlerCallback(
 		}
 	}
 
+	// Handle request toggle for recording subscribed dataref values, see TraceRecorder.h
+	if (!strcmp((const char*)inItemRef, "Record Dataref Trace"))
+	{
+		if (traceActive())		traceStop();
+		else					traceStart("XPLProTrace.bin");
+
+		XPLMCheckMenuItem(myMenu, traceMenuItemIndex, traceActive() ? xplm_Menu_Checked : xplm_Menu_Unchecked);
+	}
+
 }
 
 
 
 
+/**************************************************************************************/
+/* _phaseTime -- add the time since *start to a phase and restart the clock             */
+/**************************************************************************************/
+void _phaseTime(int phase, LARGE_INTEGER* start)
+{
+	LARGE_INTEGER now;
+	double us;
+
+	QueryPerformanceCounter(&now);
+	us = (double)(now.QuadPart - start->QuadPart) * 1000000. / phaseFrequency.QuadPart;
+	*start = now;
+
+	phaseSum[phase] += us;
+	sessionSum[phase] += us;
+	if (us > phaseIntervalMax[phase])	phaseIntervalMax[phase] = us;
+	if (us > sessionMax[phase])			sessionMax[phase] = us;
+
+}
+
+/**************************************************************************************/
+/* _phaseReport -- publish the interval means and maxima for the status window          */
+/**************************************************************************************/
+void _phaseReport(void)
+{
+	double sendSum, sendMax;
+
+	updateWorkerTiming(&sendSum, &sendMax);			// per flight loop like the others, the max is the longest snapshot
+	phaseSum[XPLPHASE_SEND] += sendSum;
+	sessionSum[XPLPHASE_SEND] += sendSum;
+	if (sendMax > phaseIntervalMax[XPLPHASE_SEND])	phaseIntervalMax[XPLPHASE_SEND] = sendMax;
+	if (sendMax > sessionMax[XPLPHASE_SEND])		sessionMax[XPLPHASE_SEND] = sendMax;
+
+	phaseCycles++;
+	sessionCycles++;
+
+	if (elapsedTime < phaseNextReport) return;
+	phaseNextReport = elapsedTime + XPL_TIMING_INTERVAL;
+
+	for (int i = 0; i < XPLPHASE_COUNT; i++)
+	{
+		phaseMean[i] = (float)(phaseSum[i] / phaseCycles);
+		phaseMax[i] = (float)phaseIntervalMax[i];
+		phaseSum[i] = 0;
+		phaseIntervalMax[i] = 0;
+	}
+	phaseCycles = 0;
+
+}
+
 /**************************************************************************************/
 /* MyFlightLoopCallback -- Called by xplane every few flight loops                    */
 /**************************************************************************************/
@@ -321,13 +411,25 @@ float	MyFlightLoopCallback(
 	//return XPLDIRECT_RETURN_TIME;
 	//fprintf(errlog, "Time:  %f \n", inElapsedSinceLastCall);
 	elapsedTime += inElapsedSinceLastCall;
-		
+
+	LARGE_INTEGER start, begin;
+	QueryPerformanceCounter(&start);
+	begin = start;
+
 	_processSerial();
+	if (reloadRequested) reloadDevices();
+	_phaseTime(XPLPHASE_SERIAL, &start);
+	_applyInboundWrites();
+	_phaseTime(XPLPHASE_WRITES, &start);
 	_updateDataRefs(0);
+	_phaseTime(XPLPHASE_DATAREFS, &start);
 	_updateCommands();
+	_phaseTime(XPLPHASE_COMMANDS, &start);
+	_phaseTime(XPLPHASE_TOTAL, &begin);
+	_phaseReport();
 	
     cycleCount++;
-	return (float)XPL_RETURN_TIME;
+	return _flightLoopInterval();
 }
 
 
@@ -0,0 +1,466 @@
+/*
+	XPLProBench -- regression benchmarks for the plugin's core, on Linux against the stand in XPLM and the memory serial
+	ports in tools/host (see XPLProHost.h), so performance work on the plugin can be measured and kept.
+
+		framing				ns per frame the device sends that is framed and turned down (a write to a handle nobody has)
+		dispatch			ns per frame for the usual mix of writes, commands, touches and stats to registered handles
+		registration_500	us to register 500 datarefs
+		abbreviations		us per lookup in an abbreviations file of 500 lines, hits and misses
+		gather_100			us per _updateDataRefs with 100 subscribed bindings, a fifth of them changing every frame
+		gather_1000			the same with 1000 (XPL_MAXDATAREFS_PC, more bindings than that can't be registered)
+		send_100			us per frame the update worker spends comparing, formatting and writing gather_100's snapshots
+		send_1000			the same for gather_1000
+		flightloop_30		us per flight loop with 30 devices, 33 bindings and 2 writes a frame each, without the worker
+
+	Every benchmark runs XPLBENCH_REPEATS times and the fastest run counts.  The results are written as JSON with -out
+	and compared with -baseline:  anything slower than its baseline by more than -threshold percent (default 25) is a
+	regression and the exit code is 2.  Baselines depend on the machine, record one with -out before making changes.
+
+		./XPLProBench -baseline tools/bench/baseline.json -out bench.json
+
+	Build:
+		g++ -O2 -pthread -DLIN=1 -Itools/host -IXPLPro_Plugin_Source -IXPLPro_Plugin_Source/SDK/CHeaders/XPLM
+			-IXPLPro_Plugin_Source/SDK/CHeaders/Widgets -o XPLProBench tools/XPLProBench.cpp tools/host/HostXPLM.cpp
+			tools/host/HostPlatform.cpp
+			XPLPro_Plugin_Source/{DataTransfer,DeviceRegistry,XPLDevice,UpdateWorker,TraceRecorder,abbreviations}.cpp
+
+	Created by the XPLPro contributors,  2026
+*/
+
+#include "XPLProHost.h"
+
+#include "XPLDevice.h"
+#include "DeviceRegistry.h"
+#include "DataTransfer.h"
+#include "UpdateWorker.h"
+#include "abbreviations.h"
+
+#include <stdarg.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#define XPLBENCH_REPEATS		5
+#define XPLBENCH_THRESHOLD		25					// percent slower than the baseline that counts as a regression
+#define XPLBENCH_FRAMES			200					// flight loops per run of the gather, send and flight loop benchmarks
+#define XPLBENCH_LOOPTIME		.05f				// XPL_RETURN_TIME, every binding subscribed at rate 0 is due every frame
+#define XPLBENCH_DEVICES		30
+#define XPLBENCH_DEVICEREFS		33					// bindings per device in flightloop_30, 990 in all
+
+struct BenchResult
+{
+	std::string	name;
+	const char*	unit;
+	double		value;
+};
+
+extern DeviceRegistry myXPLDevices;
+extern int validPorts;
+extern float elapsedTime;
+extern FILE* errlog;
+extern abbreviations gAbbreviations;
+
+static std::vector<BenchResult> results;
+
+static double _us(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+}
+
+static void _appendFrame(std::string* frames, const char* format, ...)
+{
+	char frame[XPLMAX_PACKETSIZE];
+	va_list args;
+
+	va_start(args, format);
+	vsnprintf(frame, sizeof(frame), format, args);
+	va_end(args);
+
+	frames->append(frame);
+}
+
+/*
+	_feed -- everything in frames through the device's framing and _processPacket, as fast as it goes
+*/
+static void _feed(XPLDevice* device, int port, const std::string& frames)
+{
+	hostLinkInput(port, (const unsigned char*)frames.data(), frames.size());
+	while (hostLinks[port].inPosition < hostLinks[port].inSize) device->processSerial(1 << 30);
+	hostLinkInput(port, NULL, 0);
+}
+
+/*
+	_dataRefName -- bench/ref/N is a float, int or float array dataref by N % 3
+*/
+static const char* _dataRefName(int n)
+{
+	static char name[40];
+
+	snprintf(name, sizeof(name), "bench/ref/%i", n);
+	return name;
+}
+
+static void _addDataRefs(int count)
+{
+	static const XPLMDataTypeID types[3] = { xplmType_Float, xplmType_Int, xplmType_FloatArray };
+
+	for (int n = 0; n < count; n++)
+	{
+		HostDataRef* ref = hostAddDataRef(_dataRefName(n), types[n % 3]);
+
+		for (int j = 0; j < XPLMAX_ELEMENTS; j++)
+		{
+			ref->i[j] = n + j;
+			ref->f[j] = n + j * .5f;
+		}
+	}
+}
+
+/*
+	_change -- a fifth of the bindings change every frame, a different fifth each time
+*/
+static void _change(int count, int frame)
+{
+	for (int n = frame % 5; n < count; n += 5)
+	{
+		HostDataRef* ref = hostFindDataRef(_dataRefName(n));
+
+		ref->i[0]++;
+		ref->f[0] += .25f;
+		ref->f[frame % XPLMAX_ELEMENTS] += 1.f;
+	}
+}
+
+/*
+	_session -- devices on ports 1 to count with the registration and subscription frames for bindings each, as a
+		device sends them after XPLCMD_SENDREQUEST.  Handles are given out in order, device d gets d * bindings on.
+*/
+static void _session(int devices, int bindings)
+{
+	disengageDevices();
+	hostClearXPLM();
+	_addDataRefs(devices * bindings);
+	hostAddCommand("bench/command");
+
+	for (int d = 0; d < devices; d++)
+	{
+		XPLDevice* device = hostAddDevice(d + 1);
+		std::string frames;
+
+		for (int n = d * bindings; n < (d + 1) * bindings; n++) _appendFrame(&frames, "[b,\"%s\"]", _dataRefName(n));
+		for (int n = d * bindings; n < (d + 1) * bindings; n++) _appendFrame(&frames, "[r,%i,0,0]", n);
+		_appendFrame(&frames, "[m,\"bench/command\"]");
+
+		_feed(device, d + 1, frames);
+	}
+
+	validPorts = devices;
+	updateWorkerStart();
+}
+
+static void _result(const char* name, const char* unit, double value)
+{
+	BenchResult result = { name, unit, value };
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		if (results[i].name != name) continue;
+		if (value < results[i].value) results[i].value = value;				// fastest run counts
+		return;
+	}
+	results.push_back(result);
+}
+
+static void _benchFraming(void)
+{
+	std::string frames;
+	XPLDevice* device;
+	int count = 20000;
+	double start;
+
+	_session(1, 0);
+	device = myXPLDevices.find(0);
+	for (int i = 0; i < count; i++) _appendFrame(&frames, "[2,999,%i.125]", i);
+
+	start = _us();
+	_feed(device, 1, frames);
+	_result("framing", "ns/frame", (_us() - start) * 1000 / count);
+}
+
+static void _benchDispatch(void)
+{
+	std::string frames;
+	XPLDevice* device;
+	int count = 0;
+	double start;
+
+	_session(1, 12);
+	device = myXPLDevices.find(0);
+	for (int i = 0; i < 1000; i++)
+	{
+		_appendFrame(&frames, "[2,%i,%i.5]", (i * 3) % 12, i);
+		_appendFrame(&frames, "[1,%i,%i]", (i * 3 + 1) % 12, i);
+		_appendFrame(&frames, "[4,%i,%i.25,%i]", (i * 3 + 2) % 12, i, i % XPLMAX_ELEMENTS);
+		_appendFrame(&frames, "[i,0]");
+		_appendFrame(&frames, "[j,0]");
+		_appendFrame(&frames, "[d,%i]", i % 12);
+		_appendFrame(&frames, "[o,%i,120,900,15,40,0,%i,%i]", 1000 + i, i, i);
+		count += 7;
+	}
+
+	start = _us();
+	_feed(device, 1, frames);
+	_result("dispatch", "ns/frame", (_us() - start) * 1000 / count);
+
+	_applyInboundWrites();
+}
+
+static void _benchRegistration(void)
+{
+	std::string frames;
+	XPLDevice* device;
+	double start;
+
+	_session(1, 0);
+	_addDataRefs(500);
+	device = myXPLDevices.find(0);
+	for (int n = 0; n < 500; n++) _appendFrame(&frames, "[b,\"%s\"]", _dataRefName(n));
+
+	start = _us();
+	_feed(device, 1, frames);
+	_result("registration_500", "us", _us() - start);
+}
+
+/*
+	_benchAbbreviations -- CFG_ABBREVIATIONS_FILE is a Windows path relative to X-Plane, on Linux it is a file name
+		with backslashes in it, made in a directory of its own.
+*/
+static void _benchAbbreviations(void)
+{
+	static const char* lookups[4] = { "abbr499", "abbr250", "abbr3", "no/such/dataref" };
+	static int ready = 0;
+	char directory[] = "/tmp/XPLProBenchXXXXXX";
+	char name[XPLMAX_PACKETSIZE];
+	int count = 400;
+	double start;
+
+	if (!ready)
+	{
+		FILE* file;
+
+		if (!mkdtemp(directory) || chdir(directory) < 0 || !(file = fopen(CFG_ABBREVIATIONS_FILE, "w")))
+		{
+			fprintf(stderr, "XPLProBench: can't make an abbreviations file in %s\n", directory);
+			return;
+		}
+		fprintf(file, "Put your dataref and command abbreviations here.\n\nFormat: abbreviated=full_length\n\n");
+		for (int n = 0; n < 500; n++) fprintf(file, "abbr%i = %s\n", n, _dataRefName(n));
+		fclose(file);
+
+		gAbbreviations.begin();
+		ready = 1;
+	}
+
+	start = _us();
+	for (int i = 0; i < count; i++)
+	{
+		snprintf(name, sizeof(name), "%s", lookups[i % 4]);
+		gAbbreviations.convertString(name);
+	}
+	_result("abbreviations", "us/lookup", (_us() - start) / count);
+}
+
+/*
+	_benchUpdates -- gather and send for bindings subscribed at rate 0, so every one of them is read every frame
+*/
+static void _benchUpdates(int bindings, const char* gatherName, const char* sendName)
+{
+	double gather = 0;
+	double sendSum, sendMax;
+
+	_session(1, bindings);
+	updateWorkerTiming(&sendSum, &sendMax);
+
+	for (int frame = 0; frame < XPLBENCH_FRAMES; frame++)
+	{
+		double start;
+
+		_change(bindings, frame);
+		elapsedTime += XPLBENCH_LOOPTIME;
+
+		start = _us();
+		_updateDataRefs(0);
+		gather += _us() - start;
+
+		updateWorkerWait();
+	}
+
+	updateWorkerTiming(&sendSum, &sendMax);
+	_result(gatherName, "us/frame", gather / XPLBENCH_FRAMES);
+	_result(sendName, "us/frame", sendSum / XPLBENCH_FRAMES);
+}
+
+static void _benchFlightLoop(void)
+{
+	std::vector<std::string> frames(XPLBENCH_DEVICES);
+	double total = 0;
+
+	_session(XPLBENCH_DEVICES, XPLBENCH_DEVICEREFS);
+
+	for (int frame = 0; frame < XPLBENCH_FRAMES; frame++)
+	{
+		double start;
+
+		for (int d = 0; d < XPLBENCH_DEVICES; d++)
+		{
+			int first = d * XPLBENCH_DEVICEREFS;
+
+			frames[d].clear();
+			_appendFrame(&frames[d], "[2,%i,%i.5]", first + (frame * 3) % XPLBENCH_DEVICEREFS, frame);
+			_appendFrame(&frames[d], "[1,%i,%i]", first + (frame * 3 + 1) % XPLBENCH_DEVICEREFS, frame);
+			hostLinkInput(d + 1, (const unsigned char*)frames[d].data(), frames[d].size());
+		}
+		_change(XPLBENCH_DEVICES * XPLBENCH_DEVICEREFS, frame);
+
+		start = _us();
+		hostFlightLoop(XPLBENCH_LOOPTIME);
+		total += _us() - start;
+
+		updateWorkerWait();
+	}
+
+	for (int d = 0; d < XPLBENCH_DEVICES; d++) hostLinkInput(d + 1, NULL, 0);
+	_result("flightloop_30", "us/frame", total / XPLBENCH_FRAMES);
+}
+
+static int _writeResults(const char* fileName)
+{
+	FILE* file = fopen(fileName, "w");
+
+	if (!file)
+	{
+		perror(fileName);
+		return -1;
+	}
+
+	fprintf(file, "{\n\t\"benchmarks\": [\n");
+	for (size_t i = 0; i < results.size(); i++)
+		fprintf(file, "\t\t{ \"name\": \"%s\", \"value\": %.3f, \"unit\": \"%s\" }%s\n",
+			results[i].name.c_str(), results[i].value, results[i].unit, i + 1 < results.size() ? "," : "");
+	fprintf(file, "\t]\n}\n");
+
+	fclose(file);
+	return 0;
+}
+
+/*
+	_readBaseline -- the JSON _writeResults writes, one benchmark per line
+*/
+static int _readBaseline(const char* fileName, std::vector<BenchResult>* baseline)
+{
+	FILE* file = fopen(fileName, "r");
+	char line[400];
+
+	if (!file)
+	{
+		perror(fileName);
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), file))
+	{
+		char* name = strstr(line, "\"name\": \"");
+		char* value = strstr(line, "\"value\": ");
+		BenchResult entry;
+
+		if (!name || !value) continue;
+
+		name += 9;
+		entry.name.assign(name, strcspn(name, "\""));
+		entry.value = strtod(value + 9, NULL);
+		entry.unit = "";
+		baseline->push_back(entry);
+	}
+
+	fclose(file);
+	return 0;
+}
+
+static void _usage(void)
+{
+	fprintf(stderr,
+		"usage: XPLProBench [options]\n"
+		"  -out file         write the results as JSON\n"
+		"  -baseline file    compare with results written before, exit code 2 on a regression\n"
+		"  -threshold pct    slower than the baseline by more than this is a regression (default %d)\n", XPLBENCH_THRESHOLD);
+}
+
+int main(int argc, char* argv[])
+{
+	const char* outName = NULL;
+	const char* baselineName = NULL;
+	double threshold = XPLBENCH_THRESHOLD;
+	std::vector<BenchResult> baseline;
+	int regressions = 0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (i + 1 >= argc)							{ _usage(); return 1; }
+
+		if (!strcmp(argv[i], "-out"))				outName = argv[++i];
+		else if (!strcmp(argv[i], "-baseline"))		baselineName = argv[++i];
+		else if (!strcmp(argv[i], "-threshold"))	threshold = atof(argv[++i]);
+		else										{ _usage(); return 1; }
+	}
+
+	if (baselineName && _readBaseline(baselineName, &baseline) < 0) return 1;
+
+	errlog = fopen("/dev/null", "w");
+
+	for (int repeat = 0; repeat < XPLBENCH_REPEATS; repeat++)
+	{
+		_benchFraming();
+		_benchDispatch();
+		_benchRegistration();
+		_benchAbbreviations();
+		_benchUpdates(100, "gather_100", "send_100");
+		_benchUpdates(1000, "gather_1000", "send_1000");
+		_benchFlightLoop();
+	}
+	disengageDevices();
+
+	if (outName && _writeResults(outName) < 0) return 1;
+
+	printf("%-18s %12s %12s %8s\n", "benchmark", "result", "baseline", "change");
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchResult* base = NULL;
+
+		for (size_t b = 0; b < baseline.size(); b++)
+			if (baseline[b].name == results[i].name) base = &baseline[b];
+
+		printf("%-18s %12.3f", results[i].name.c_str(), results[i].value);
+		if (!base || base->value <= 0)
+		{
+			printf(" %12s %8s  %s\n", "-", "-", results[i].unit);
+			continue;
+		}
+
+		double change = (results[i].value / base->value - 1) * 100;
+		int regression = change > threshold;
+
+		printf(" %12.3f %+7.1f%%  %s%s\n", base->value, change, results[i].unit, regression ? "  REGRESSION" : "");
+		regressions += regression;
+	}
+
+	if (regressions)
+	{
+		printf("%i regression%s beyond %.0f%%\n", regressions, regressions > 1 ? "s" : "", threshold);
+		return 2;
+	}
+	return 0;
+}
@@ -0,0 +1,140 @@
+/*
+	XPLProFuzz -- feeds arbitrary bytes to the plugin as if a device sent them, through XPLDevice::processSerial and
+	the rest of the flight loop, to find frames that crash or corrupt the plugin.  Runs on Linux against the stand in
+	XPLM and the memory serial port in tools/host, see XPLProHost.h.
+
+	Each input is one session:  a device is found, everything in the input is read from it over as many flight loops
+	as that takes, with the update worker sending whatever the device subscribed, then the devices are disengaged.
+	XPLCMD_RESET ends the session early, the port isn't marked present so findDevices doesn't find the device again.
+	The stand in XPLM has a dataref of every type and two commands for the input to register, named like the ones
+	in tools/corpus/fuzz.
+
+	libFuzzer (clang):
+		clang++ -g -O1 -fsanitize=fuzzer,address,undefined -pthread -DLIN=1 -Itools/host
+			-IXPLPro_Plugin_Source -IXPLPro_Plugin_Source/SDK/CHeaders/XPLM -IXPLPro_Plugin_Source/SDK/CHeaders/Widgets
+			-o XPLProFuzz tools/XPLProFuzz.cpp tools/host/HostXPLM.cpp tools/host/HostPlatform.cpp
+			XPLPro_Plugin_Source/{DataTransfer,DeviceRegistry,XPLDevice,UpdateWorker,TraceRecorder,abbreviations}.cpp
+		./XPLProFuzz -dict=tools/corpus/fuzz.dict corpus tools/corpus/fuzz
+
+	AFL, or only to run inputs again (g++, no libFuzzer):  the same with -DXPL_FUZZ_STANDALONE and without
+	-fsanitize=fuzzer.  Every file named is run, stdin if none.
+		afl-fuzz -i tools/corpus/fuzz -o findings -- ./XPLProFuzz @@
+
+	Created by the XPLPro contributors,  2026
+*/
+
+#include "XPLProHost.h"
+
+#include "XPLDevice.h"
+#include "DeviceRegistry.h"
+#include "DataTransfer.h"
+#include "UpdateWorker.h"
+
+#include <vector>
+
+#define XPLFUZZ_MAXLOOPS	64				// flight loops per input after it has all been read, for timed updates to go out
+#define XPLFUZZ_LOOPTIME	.02f
+#define XPLFUZZ_PORT		1
+
+extern DeviceRegistry myXPLDevices;
+extern int validPorts;
+extern float elapsedTime;
+extern FILE* errlog;
+
+/*
+	_fuzzDataRefs -- what the input can register, with values that aren't all zero so updates have something to send.
+		Added again for every input, writes from an earlier one don't carry over.
+*/
+static void _fuzzDataRefs(void)
+{
+	HostDataRef* ref;
+
+	ref = hostAddDataRef("fuzz/int", xplmType_Int);
+	ref->i[0] = 3;
+	ref = hostAddDataRef("fuzz/float", xplmType_Float);
+	ref->f[0] = 1.5f;
+	ref = hostAddDataRef("fuzz/double", xplmType_Double);
+	ref->d = -2.25;
+	ref = hostAddDataRef("fuzz/mixed", xplmType_Int | xplmType_Float | xplmType_Double);
+	ref->i[0] = 7;
+	ref->f[0] = 7.f;
+	ref->d = 7.;
+	ref = hostAddDataRef("fuzz/intarray", xplmType_IntArray);
+	for (int i = 0; i < XPLMAX_ELEMENTS; i++) ref->i[i] = i * 10;
+	ref = hostAddDataRef("fuzz/floatarray", xplmType_FloatArray);
+	for (int i = 0; i < XPLMAX_ELEMENTS; i++) ref->f[i] = i * .5f;
+	ref = hostAddDataRef("fuzz/string", xplmType_Data);
+	ref->s = "XPLPro fuzz string dataref";
+
+	hostAddCommand("fuzz/command");
+	hostAddCommand("fuzz/command2");
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const unsigned char* data, size_t size)
+{
+	static int initialized = 0;
+
+	if (!initialized)
+	{
+		errlog = fopen("/dev/null", "w");
+		initialized = 1;
+	}
+
+	_fuzzDataRefs();
+	elapsedTime = 0;
+
+	HostLink* link = &hostLinks[XPLFUZZ_PORT];
+
+	hostAddDevice(XPLFUZZ_PORT);
+	validPorts = 1;
+	updateWorkerStart();
+
+	hostLinkInput(XPLFUZZ_PORT, data, size);
+	for (int loop = 0; loop < XPLFUZZ_MAXLOOPS; loop++)
+	{
+		if (link->inPosition < link->inSize && myXPLDevices.count()) loop = 0;		// until it has all been read, or a reset dropped the device
+		hostFlightLoop(XPLFUZZ_LOOPTIME);
+		updateWorkerWait();											// as if the frame took long enough for the worker to keep up
+	}
+
+	disengageDevices();
+	hostLinkInput(XPLFUZZ_PORT, NULL, 0);
+
+	return 0;
+}
+
+#ifdef XPL_FUZZ_STANDALONE
+
+static int _runFile(FILE* file)
+{
+	std::vector<unsigned char> input;
+	unsigned char buffer[4096];
+	size_t count;
+
+	while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) input.insert(input.end(), buffer, buffer + count);
+
+	return LLVMFuzzerTestOneInput(input.data(), input.size());
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2) return _runFile(stdin);
+
+	for (int i = 1; i < argc; i++)
+	{
+		FILE* file = fopen(argv[i], "rb");
+
+		if (!file)
+		{
+			fprintf(stderr, "XPLProFuzz: can't open %s\n", argv[i]);
+			return 1;
+		}
+
+		_runFile(file);
+		fclose(file);
+	}
+
+	return 0;
+}
+
+#endif
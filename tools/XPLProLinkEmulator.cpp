@@ -0,0 +1,430 @@
+/*
+	XPLProLinkEmulator -- stands in for the USB serial link between the plugin and a board, on Linux.
+
+	Creates a pseudo terminal for the plugin side and passes everything through to the board side, either a real
+	board (-device /dev/ttyACM0) or a second pseudo terminal for a simulated one.  On the way bytes can be held to a
+	baud rate, delayed with latency and jitter, and dropped, duplicated or bit flipped at set rates, to see how both
+	ends recover from a bad link without touching the plugin or the library.
+
+	X-Plane under Wine finds the plugin side as a COM port after linking it, for instance:
+		ln -s /dev/pts/5 ~/.wine/dosdevices/com3
+
+	Build:  g++ -O2 -o XPLProLinkEmulator XPLProLinkEmulator.cpp
+
+	Created by the XPLPro contributors,  2026
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/ioctl.h>
+
+#include <deque>
+#include <random>
+
+#define LINK_DEFAULT_BAUD	115200				// XPL_BAUDRATE
+#define LINK_BITSPERBYTE	10					// start, 8 data, stop
+#define LINK_READSIZE		256
+#define LINK_RETRY			.002				// seconds, when the other side isn't taking bytes that are due
+
+/*
+	Rates without a B constant (250000...) are set with termios2 and BOTHER, which glibc doesn't declare.  The layout
+	is the kernel's asm-generic one, as on x86 and ARM.
+*/
+#define LINK_BOTHER			0010000
+
+struct LinkTermios2
+{
+	tcflag_t	c_iflag;
+	tcflag_t	c_oflag;
+	tcflag_t	c_cflag;
+	tcflag_t	c_lflag;
+	cc_t		c_line;
+	cc_t		c_cc[19];
+	speed_t		c_ispeed;
+	speed_t		c_ospeed;
+};
+
+#define LINK_TCGETS2		_IOR('T', 0x2A, struct LinkTermios2)
+#define LINK_TCSETS2		_IOW('T', 0x2B, struct LinkTermios2)
+
+struct LinkOptions
+{
+	const char*	device;							// board side serial port, NULL for a second pseudo terminal
+	long		baud;							// 0 for no limit
+	double		latency;						// seconds added to every byte
+	double		jitter;							// up to this many seconds more, at random
+	long		dropRate;						// per million bytes
+	long		duplicateRate;
+	long		flipRate;
+	unsigned	seed;
+};
+
+struct QueuedByte
+{
+	double		due;							// when it is written out
+	char		value;
+};
+
+/*
+	One direction of the link.  Bytes keep their order, a byte is never due before the one ahead of it has had its
+	time on the wire.
+*/
+struct LinkDirection
+{
+	const char*	name;
+	int			from;
+	int			to;
+	std::deque<QueuedByte> queue;
+	double		wireFree;						// time the last queued byte is done being sent
+
+	long		bytes;
+	long		dropped;
+	long		duplicated;
+	long		flipped;
+};
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static LinkOptions options;
+static std::mt19937 randomSource;
+
+static double _now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void _onSignal(int)
+{
+	stopRequested = 1;
+}
+
+static int _chance(long perMillion)
+{
+	if (perMillion <= 0) return 0;
+	return (long)(randomSource() % 1000000) < perMillion;
+}
+
+/*
+	_speed -- B constant for the rate, B0 if there isn't one
+*/
+static speed_t _speed(long baud)
+{
+	switch (baud)
+	{
+	case 9600:		return B9600;
+	case 19200:		return B19200;
+	case 38400:		return B38400;
+	case 57600:		return B57600;
+	case 115200:	return B115200;
+	case 230400:	return B230400;
+	case 460800:	return B460800;
+	case 500000:	return B500000;
+	case 921600:	return B921600;
+	case 1000000:	return B1000000;
+	case 2000000:	return B2000000;
+	default:		return B0;
+	}
+}
+
+/*
+	_setOtherSpeed -- any rate the driver can make, for the ones _speed has no constant for
+*/
+static int _setOtherSpeed(int fd, long baud)
+{
+	struct LinkTermios2 tio;
+
+	if (ioctl(fd, LINK_TCGETS2, &tio) < 0) return -1;
+
+	tio.c_cflag &= ~(CBAUD | CIBAUD);
+	tio.c_cflag |= LINK_BOTHER;
+	tio.c_ispeed = (speed_t)baud;
+	tio.c_ospeed = (speed_t)baud;
+
+	if (ioctl(fd, LINK_TCSETS2, &tio) < 0) return -1;
+
+	if (ioctl(fd, LINK_TCGETS2, &tio) < 0) return -1;			// the driver rounds to what it can do, or refuses
+	if (tio.c_ospeed < baud * .97 || tio.c_ospeed > baud * 1.03)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+	return 0;
+}
+
+static int _makeRaw(int fd, long baud)
+{
+	struct termios tio;
+	speed_t speed = _speed(baud);
+
+	if (tcgetattr(fd, &tio) < 0) return -1;
+
+	cfmakeraw(&tio);
+	cfsetispeed(&tio, speed != B0 ? speed : B115200);
+	cfsetospeed(&tio, speed != B0 ? speed : B115200);
+	tio.c_cflag |= CLOCAL | CREAD;
+
+	if (tcsetattr(fd, TCSANOW, &tio) < 0) return -1;
+	if (speed == B0) return _setOtherSpeed(fd, baud);
+	return 0;
+}
+
+/*
+	_openPty -- master side for us, the slave stays open too so the master doesn't see a hangup while nothing else
+		has the slave open (plugin not started yet, board sketch restarting...)
+*/
+static int _openPty(const char** slaveName, int* slave)
+{
+	int master = posix_openpt(O_RDWR | O_NOCTTY);
+
+	if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0) return -1;
+
+	*slaveName = strdup(ptsname(master));						// ptsname() reuses its buffer
+	*slave = open(*slaveName, O_RDWR | O_NOCTTY);
+	if (*slave < 0 || _makeRaw(*slave, LINK_DEFAULT_BAUD) < 0) return -1;
+
+	fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+	return master;
+}
+
+/*
+	_receive -- take what arrived on one side and queue it for the other, with the faults applied
+*/
+static int _receive(LinkDirection* link)
+{
+	char buffer[LINK_READSIZE];
+	double now = _now();
+	double byteTime = options.baud ? (double)LINK_BITSPERBYTE / options.baud : 0;
+	int count = (int)read(link->from, buffer, sizeof(buffer));
+
+	if (count <= 0) return count;
+
+	for (int i = 0; i < count; i++)
+	{
+		QueuedByte entry;
+		int copies = 1;
+
+		link->bytes++;
+
+		if (_chance(options.dropRate))
+		{
+			link->dropped++;
+			continue;
+		}
+
+		if (_chance(options.duplicateRate))
+		{
+			link->duplicated++;
+			copies = 2;
+		}
+
+		entry.value = buffer[i];
+		if (_chance(options.flipRate))
+		{
+			entry.value ^= (char)(1 << (randomSource() % 8));
+			link->flipped++;
+		}
+
+		for (int c = 0; c < copies; c++)
+		{
+			double delay = options.latency;
+
+			if (options.jitter > 0) delay += options.jitter * (randomSource() % 1000) / 1000.;
+
+			if (link->wireFree < now) link->wireFree = now;
+			link->wireFree += byteTime;
+
+			entry.due = now + delay;
+			if (entry.due < link->wireFree) entry.due = link->wireFree;
+			if (!link->queue.empty() && entry.due < link->queue.back().due) entry.due = link->queue.back().due;
+
+			link->queue.push_back(entry);
+		}
+	}
+
+	return count;
+}
+
+/*
+	_deliver -- write the bytes that are due, returns seconds until the next one or -1 if nothing is queued.  Bytes
+		the other side didn't take are tried again after LINK_RETRY.
+*/
+static double _deliver(LinkDirection* link)
+{
+	char buffer[LINK_READSIZE];
+	double now = _now();
+
+	while (!link->queue.empty() && link->queue.front().due <= now)
+	{
+		int count = 0;
+		int written;
+
+		while (count < LINK_READSIZE && count < (int)link->queue.size() && link->queue[count].due <= now)
+		{
+			buffer[count] = link->queue[count].value;
+			count++;
+		}
+
+		written = (int)write(link->to, buffer, count);
+		if (written <= 0) break;								// other side not keeping up, try again later
+		link->queue.erase(link->queue.begin(), link->queue.begin() + written);
+	}
+
+	if (link->queue.empty()) return -1;
+	if (link->queue.front().due <= now) return LINK_RETRY;
+	return link->queue.front().due - now;
+}
+
+static void _report(LinkDirection* link)
+{
+	fprintf(stderr, "%-18s bytes: %ld, dropped: %ld, duplicated: %ld, flipped: %ld, still queued: %zu\n",
+		link->name, link->bytes, link->dropped, link->duplicated, link->flipped, link->queue.size());
+}
+
+static void _usage(void)
+{
+	fprintf(stderr,
+		"usage: XPLProLinkEmulator [options]\n"
+		"  -device path     board serial port, otherwise a second pseudo terminal is made for a simulated board\n"
+		"  -baud n          limit the link to n baud, 0 for no limit (default %d)\n"
+		"  -latency ms      delay every byte\n"
+		"  -jitter ms       delay every byte up to this much more, at random\n"
+		"  -drop ppm        drop bytes, per million\n"
+		"  -duplicate ppm   send bytes twice, per million\n"
+		"  -flip ppm        flip a bit in bytes, per million\n"
+		"  -seed n          random seed, to repeat a run\n", LINK_DEFAULT_BAUD);
+}
+
+int main(int argc, char* argv[])
+{
+	const char* pluginName;
+	const char* boardName;
+	int pluginSlave;
+	int boardSlave = -1;
+	int pluginSide;
+	int boardSide;
+
+	options.device = NULL;
+	options.baud = LINK_DEFAULT_BAUD;
+	options.latency = 0;
+	options.jitter = 0;
+	options.dropRate = 0;
+	options.duplicateRate = 0;
+	options.flipRate = 0;
+	options.seed = (unsigned)time(NULL);
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (i + 1 >= argc)						{ _usage(); return 1; }
+
+		if (!strcmp(argv[i], "-device"))		options.device = argv[++i];
+		else if (!strcmp(argv[i], "-baud"))		options.baud = atol(argv[++i]);
+		else if (!strcmp(argv[i], "-latency"))	options.latency = atof(argv[++i]) / 1000.;
+		else if (!strcmp(argv[i], "-jitter"))	options.jitter = atof(argv[++i]) / 1000.;
+		else if (!strcmp(argv[i], "-drop"))		options.dropRate = atol(argv[++i]);
+		else if (!strcmp(argv[i], "-duplicate")) options.duplicateRate = atol(argv[++i]);
+		else if (!strcmp(argv[i], "-flip"))		options.flipRate = atol(argv[++i]);
+		else if (!strcmp(argv[i], "-seed"))		options.seed = (unsigned)atol(argv[++i]);
+		else									{ _usage(); return 1; }
+	}
+
+	if (options.baud < 0)						{ _usage(); return 1; }
+
+	randomSource.seed(options.seed);
+
+	pluginSide = _openPty(&pluginName, &pluginSlave);
+	if (pluginSide < 0)
+	{
+		perror("pseudo terminal for the plugin");
+		return 1;
+	}
+
+	if (options.device)
+	{
+		boardName = options.device;
+		boardSide = open(options.device, O_RDWR | O_NOCTTY | O_NONBLOCK);
+		if (boardSide < 0)
+		{
+			perror(options.device);
+			return 1;
+		}
+		if (_makeRaw(boardSide, options.baud ? options.baud : LINK_DEFAULT_BAUD) < 0)
+		{
+			fprintf(stderr, "%s: can't set %ld baud: %s\n", options.device, options.baud ? options.baud : (long)LINK_DEFAULT_BAUD, strerror(errno));
+			return 1;
+		}
+	}
+	else
+	{
+		boardSide = _openPty(&boardName, &boardSlave);
+		if (boardSide < 0)
+		{
+			perror("pseudo terminal for the board");
+			return 1;
+		}
+	}
+
+	printf("plugin side: %s\nboard side:  %s\nseed: %u\n", pluginName, boardName, options.seed);
+	fflush(stdout);
+
+	signal(SIGINT, _onSignal);
+	signal(SIGTERM, _onSignal);
+
+	LinkDirection toBoard = { "plugin -> board:", pluginSide, boardSide, {}, 0, 0, 0, 0, 0 };
+	LinkDirection toPlugin = { "board -> plugin:", boardSide, pluginSide, {}, 0, 0, 0, 0, 0 };
+
+	while (!stopRequested)
+	{
+		struct pollfd fds[2];
+		double wait[2];
+		int timeout = -1;
+
+		wait[0] = _deliver(&toBoard);
+		wait[1] = _deliver(&toPlugin);
+
+		for (int i = 0; i < 2; i++)
+		{
+			int ms;
+
+			if (wait[i] < 0) continue;
+			ms = (int)(wait[i] * 1000) + 1;
+			if (timeout < 0 || ms < timeout) timeout = ms;
+		}
+
+		fds[0].fd = pluginSide;
+		fds[0].events = POLLIN;
+		fds[1].fd = boardSide;
+		fds[1].events = POLLIN;
+
+		if (poll(fds, 2, timeout) < 0) continue;				// interrupted, check stopRequested
+
+		if (fds[0].revents & POLLIN) _receive(&toBoard);
+		if (fds[1].revents & POLLIN) _receive(&toPlugin);
+
+		if ((fds[1].revents & (POLLHUP | POLLERR)) && options.device)
+		{
+			fprintf(stderr, "%s went away\n", options.device);
+			break;
+		}
+	}
+
+	_report(&toBoard);
+	_report(&toPlugin);
+
+	close(pluginSide);
+	close(pluginSlave);
+	close(boardSide);
+	if (boardSlave >= 0) close(boardSlave);
+
+	return 0;
+}
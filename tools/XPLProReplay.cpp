@@ -0,0 +1,395 @@
+/*
+	XPLProReplay -- replays a dataref trace (Record Dataref Trace in the plugin's menu, see TraceRecorder.h) through the
+	plugin's update path, to compare the traffic and CPU time of subscription settings offline on a real flight.
+
+	The datarefs in the trace are served by the stand in XPLM in tools/host (see XPLProHost.h) and registered by one
+	device, which subscribes every element the trace has values for, with the rate and precision given.  Every frame of
+	the trace sets the values recorded in it and runs a flight loop as long as the frame took, then waits for the update
+	worker.  At the end it prints what was sent to the device and how long the flight loop and the worker took for it.
+
+		./XPLProReplay [-rate ms] [-precision p] [-fixed decimals] XPLProTrace.bin
+
+		-rate ms			updateRate of every subscription (default 0, every flight loop)
+		-precision p		precision of every subscription (default 0, every change)
+		-fixed decimals		subscribe floats with XPLREQUEST_UPDATES_FIXED instead of precision
+
+	Build:
+		g++ -O2 -pthread -DLIN=1 -Itools/host -IXPLPro_Plugin_Source -IXPLPro_Plugin_Source/SDK/CHeaders/XPLM
+			-IXPLPro_Plugin_Source/SDK/CHeaders/Widgets -o XPLProReplay tools/XPLProReplay.cpp tools/host/HostXPLM.cpp
+			tools/host/HostPlatform.cpp
+			XPLPro_Plugin_Source/{DataTransfer,DeviceRegistry,XPLDevice,UpdateWorker,TraceRecorder,abbreviations}.cpp
+
+	Created by the XPLPro contributors,  2026
+*/
+
+#include "XPLProHost.h"
+
+#include "XPLDevice.h"
+#include "DeviceRegistry.h"
+#include "DataTransfer.h"
+#include "UpdateWorker.h"
+#include "TraceRecorder.h"
+
+#include <stdarg.h>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#define XPLREPLAY_PORT		1
+
+struct ReplayDataRef
+{
+	std::string		name;
+	XPLMDataTypeID	type;
+	int				elements[XPLMAX_ELEMENTS];		// the trace has values for the element
+	int				kinds;							// XPL_TRACEKIND_ bits seen
+};
+
+struct ReplayValue
+{
+	int				ref;							// into replayDataRefs
+	int				element;
+	int				kind;
+	unsigned long long	bits;
+	std::string		string;
+};
+
+struct ReplayFrame
+{
+	float			time;							// seconds since the previous frame
+	std::vector<ReplayValue>	values;
+};
+
+extern DeviceRegistry myXPLDevices;
+extern int validPorts;
+extern float elapsedTime;
+extern FILE* errlog;
+
+static std::vector<ReplayDataRef> replayDataRefs;
+static std::vector<ReplayFrame> replayFrames;
+static long replayChanges = 0;
+
+static double _us(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+}
+
+/*
+	Trace decoding, the reverse of TraceRecorder.cpp.  _getVarint returns 0 at the end of the data.
+*/
+
+static int _getVarint(const std::vector<unsigned char>& in, size_t* position, unsigned long long* value)
+{
+	int shift = 0;
+
+	*value = 0;
+	while (*position < in.size() && shift < 64)
+	{
+		unsigned char byte = in[(*position)++];
+
+		*value |= (unsigned long long)(byte & 0x7f) << shift;
+		if (!(byte & 0x80)) return 1;
+		shift += 7;
+	}
+	return 0;
+}
+
+static long long _unzigzag(unsigned long long value)
+{
+	return (long long)(value >> 1) ^ -(long long)(value & 1);
+}
+
+static int _readTrace(const char* fileName)
+{
+	std::vector<unsigned char> in;
+	std::unordered_map<int, int> bindingRefs;				// trace binding number to replayDataRefs, as named last
+	std::unordered_map<std::string, int> nameRefs;
+	unsigned char buffer[4096];
+	size_t count, position = 9;
+	FILE* file = fopen(fileName, "rb");
+
+	if (!file)
+	{
+		fprintf(stderr, "XPLProReplay: can't open %s\n", fileName);
+		return 0;
+	}
+	while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) in.insert(in.end(), buffer, buffer + count);
+	fclose(file);
+
+	if (in.size() < 9 || memcmp(in.data(), "XPLTRACE", 8) || in[8] != XPL_TRACE_VERSION)
+	{
+		fprintf(stderr, "XPLProReplay: %s is not a version %i dataref trace\n", fileName, XPL_TRACE_VERSION);
+		return 0;
+	}
+
+	while (position < in.size())
+	{
+		unsigned long long binding, type, length, frames, columns, element, kind, entries, value;
+		unsigned char record = in[position++];
+
+		if (record == 'N')
+		{
+			if (!_getVarint(in, &position, &binding) || !_getVarint(in, &position, &type) || !_getVarint(in, &position, &length)
+				|| position + length > in.size()) break;
+
+			std::string name((const char*)in.data() + position, length);
+			position += length;
+
+			auto found = nameRefs.find(name);
+			if (found == nameRefs.end())
+			{
+				ReplayDataRef ref;
+
+				ref.name = name;
+				ref.type = (XPLMDataTypeID)type;
+				ref.kinds = 0;
+				for (int j = 0; j < XPLMAX_ELEMENTS; j++) ref.elements[j] = 0;
+
+				found = nameRefs.emplace(name, (int)replayDataRefs.size()).first;
+				replayDataRefs.push_back(ref);
+			}
+			bindingRefs[(int)binding] = found->second;
+			continue;
+		}
+
+		if (record != 'B' || !_getVarint(in, &position, &frames) || frames > in.size() - position) break;		// a byte a frame at least
+
+		size_t first = replayFrames.size();
+		replayFrames.resize(first + frames);
+		for (size_t f = 0; f < frames; f++)
+		{
+			if (!_getVarint(in, &position, &value)) break;
+			replayFrames[first + f].time = _unzigzag(value) / 1000.f;
+		}
+
+		if (!_getVarint(in, &position, &columns)) break;
+		for (unsigned long long c = 0; c < columns; c++)
+		{
+			std::vector<unsigned long long> frameNumbers;
+			unsigned long long frame = 0, previous = 0;
+
+			if (!_getVarint(in, &position, &binding) || !_getVarint(in, &position, &element) || !_getVarint(in, &position, &kind)
+				|| !_getVarint(in, &position, &entries) || entries > in.size() - position) break;
+
+			auto ref = bindingRefs.find((int)binding);
+			if (ref == bindingRefs.end() || element >= XPLMAX_ELEMENTS || kind > XPL_TRACEKIND_STRING) break;
+
+			replayDataRefs[ref->second].elements[element] = 1;
+			replayDataRefs[ref->second].kinds |= 1 << kind;
+
+			for (unsigned long long e = 0; e < entries; e++)
+			{
+				if (!_getVarint(in, &position, &value)) break;
+				frame += value;
+				frameNumbers.push_back(frame);
+			}
+
+			for (unsigned long long e = 0; e < entries && e < frameNumbers.size(); e++)
+			{
+				ReplayValue change;
+
+				change.ref = ref->second;
+				change.element = (int)element;
+				change.kind = (int)kind;
+
+				if (!_getVarint(in, &position, &value)) break;
+				switch (kind)
+				{
+				case XPL_TRACEKIND_INT:		previous += _unzigzag(value);	break;
+				case XPL_TRACEKIND_FLOAT:
+				case XPL_TRACEKIND_DOUBLE:	previous ^= value;				break;
+				case XPL_TRACEKIND_STRING:
+					if (value > in.size() - position) value = in.size() - position;
+					change.string.assign((const char*)in.data() + position, value);
+					position += value;
+					break;
+				}
+				change.bits = previous;
+
+				if (frameNumbers[e] < frames) replayFrames[first + frameNumbers[e]].values.push_back(change);
+				replayChanges++;
+			}
+		}
+	}
+
+	if (position < in.size()) fprintf(stderr, "XPLProReplay: %s is damaged at byte %zu, replaying what came before\n", fileName, position);
+	return 1;
+}
+
+/*
+	_setValue -- the recorded value, in every representation the stand in dataref has:  dead reckoning elements of
+		float datarefs are recorded as doubles.
+*/
+static void _setValue(const ReplayValue* change)
+{
+	HostDataRef* ref = hostFindDataRef(replayDataRefs[change->ref].name.c_str());
+	double value = 0;
+	float floatValue;
+
+	switch (change->kind)
+	{
+	case XPL_TRACEKIND_INT:
+		value = (double)(long long)change->bits;
+		break;
+
+	case XPL_TRACEKIND_FLOAT:
+	{
+		unsigned int floatBits = (unsigned int)change->bits;
+
+		memcpy(&floatValue, &floatBits, sizeof(floatValue));
+		value = floatValue;
+		break;
+	}
+
+	case XPL_TRACEKIND_DOUBLE:
+		memcpy(&value, &change->bits, sizeof(value));
+		break;
+
+	case XPL_TRACEKIND_STRING:
+		ref->s = change->string;
+		return;
+	}
+
+	ref->i[change->element] = (int)value;
+	ref->f[change->element] = (float)value;
+	if (change->element == 0) ref->d = value;
+}
+
+static void _appendFrame(std::string* frames, const char* format, ...)
+{
+	char frame[XPLMAX_PACKETSIZE];
+	va_list args;
+
+	va_start(args, format);
+	vsnprintf(frame, sizeof(frame), format, args);
+	va_end(args);
+
+	frames->append(frame);
+}
+
+/*
+	_subscribe -- the frames a device would send to register and subscribe everything in the trace, handles in order
+*/
+static void _subscribe(std::string* frames, int rate, float precision, int fixed)
+{
+	for (size_t n = 0; n < replayDataRefs.size(); n++)
+		_appendFrame(frames, "[b,\"%s\"]", replayDataRefs[n].name.c_str());
+
+	for (size_t n = 0; n < replayDataRefs.size(); n++)
+	{
+		ReplayDataRef* ref = &replayDataRefs[n];
+		int isFloat = ref->type & (xplmType_Float | xplmType_Double | xplmType_FloatArray);
+		int isArray = ref->type & (xplmType_IntArray | xplmType_FloatArray);
+
+		if (ref->type & xplmType_Data)
+		{
+			_appendFrame(frames, "[r,%i,%i,0]", (int)n, rate);
+			continue;
+		}
+
+		for (int j = 0; j < XPLMAX_ELEMENTS; j++)
+		{
+			if (!ref->elements[j]) continue;
+
+			if (isFloat && fixed >= 0)	_appendFrame(frames, "[8,%i,%i,%i,%i]", (int)n, rate, fixed, j);
+			else if (isArray)			_appendFrame(frames, "[t,%i,%i,%f,%i]", (int)n, rate, precision, j);
+			else						_appendFrame(frames, "[r,%i,%i,%f]", (int)n, rate, precision);
+		}
+	}
+}
+
+static void _usage(void)
+{
+	fprintf(stderr,
+		"usage: XPLProReplay [options] trace\n"
+		"  -rate ms          updateRate of every subscription (default 0)\n"
+		"  -precision p      precision of every subscription (default 0)\n"
+		"  -fixed decimals   subscribe floats as fixed point with this many decimals\n");
+}
+
+int main(int argc, char* argv[])
+{
+	const char* traceName = NULL;
+	int rate = 0;
+	float precision = 0;
+	int fixed = -1;
+	std::string frames;
+	HostLink* link = &hostLinks[XPLREPLAY_PORT];
+	XPLDevice* device;
+	double flightTime = 0, loopTime = 0, loopMax = 0, sendSum, sendMax;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (argv[i][0] != '-')							traceName = argv[i];
+		else if (i + 1 >= argc)							{ _usage(); return 1; }
+		else if (!strcmp(argv[i], "-rate"))				rate = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-precision"))		precision = (float)atof(argv[++i]);
+		else if (!strcmp(argv[i], "-fixed"))			fixed = atoi(argv[++i]);
+		else											{ _usage(); return 1; }
+	}
+
+	if (!traceName)						{ _usage(); return 1; }
+	if (!_readTrace(traceName))			return 1;
+
+	if (replayDataRefs.size() > XPL_MAXDATAREFS_PC)
+	{
+		fprintf(stderr, "XPLProReplay: %zu datarefs in the trace, the plugin takes %i\n", replayDataRefs.size(), XPL_MAXDATAREFS_PC);
+		return 1;
+	}
+
+	errlog = fopen("/dev/null", "w");
+
+	for (size_t n = 0; n < replayDataRefs.size(); n++)
+		hostAddDataRef(replayDataRefs[n].name.c_str(), replayDataRefs[n].type);
+
+	device = hostAddDevice(XPLREPLAY_PORT);
+	validPorts = 1;
+	_subscribe(&frames, rate, precision, fixed);
+	hostLinkInput(XPLREPLAY_PORT, (const unsigned char*)frames.data(), frames.size());
+	while (link->inPosition < link->inSize) device->processSerial(1 << 30);
+	hostLinkInput(XPLREPLAY_PORT, NULL, 0);
+
+	link->bytesOut = 0;
+	link->framesOut = 0;
+	updateWorkerStart();
+	updateWorkerTiming(&sendSum, &sendMax);
+
+	for (size_t f = 0; f < replayFrames.size(); f++)
+	{
+		ReplayFrame* frame = &replayFrames[f];
+		double start, took;
+
+		for (size_t v = 0; v < frame->values.size(); v++) _setValue(&frame->values[v]);
+
+		start = _us();
+		hostFlightLoop(frame->time);
+		took = _us() - start;
+
+		loopTime += took;
+		if (took > loopMax) loopMax = took;
+		flightTime += frame->time;
+
+		updateWorkerWait();
+	}
+
+	updateWorkerTiming(&sendSum, &sendMax);
+	disengageDevices();
+
+	if (!replayFrames.size() || flightTime <= 0)
+	{
+		fprintf(stderr, "XPLProReplay: nothing to replay in %s\n", traceName);
+		return 1;
+	}
+
+	printf("trace          %zu datarefs, %zu frames, %.1f s, %li value changes\n", replayDataRefs.size(), replayFrames.size(), flightTime, replayChanges);
+	printf("settings       rate %i ms, precision %g, %s\n", rate, precision, fixed >= 0 ? "fixed point" : "floats");
+	printf("sent           %li frames, %zu bytes, %.0f bytes/s\n", link->framesOut, link->bytesOut, link->bytesOut / flightTime);
+	printf("flight loop    %.2f us/frame, %.0f us max\n", loopTime / replayFrames.size(), loopMax);
+	printf("update worker  %.2f us/frame, %.0f us max\n", sendSum / replayFrames.size(), sendMax);
+
+	return 0;
+}
@@ -0,0 +1,138 @@
+/*
+	HostPlatform -- a serialClass over memory and the plugin globals that live outside the core, for the host tools.
+	See XPLProHost.h.
+
+	Created by the XPLPro contributors,  2026
+*/
+
+#include "XPLProHost.h"
+
+#include "SerialClass.h"
+#include "abbreviations.h"
+#include "XPLDevice.h"
+#include "DeviceRegistry.h"
+#include "DataTransfer.h"
+
+#include <atomic>
+
+HostLink hostLinks[XPLHOST_PORTS];
+
+extern int reloadRequested;
+
+extern DeviceRegistry myXPLDevices;
+
+// XPLProPlugin.cpp
+FILE* serialLogFile = NULL;
+FILE* errlog = NULL;
+abbreviations gAbbreviations;
+long cycleCount = 0l;
+float elapsedTime = 0;
+
+// StatusWindow.cpp
+int lastCmdAction = -1;
+std::atomic<int> lastRefSent(-1);
+std::atomic<int> lastRefElementSent(0);
+int lastRefReceived = -1;
+int lastRefElementReceived = 0;
+
+XPLDevice* hostAddDevice(int portNumber)
+{
+	serialClass* port = new serialClass;
+	int present = hostLinks[portNumber].present;
+
+	hostLinks[portNumber].present = 1;
+	port->begin(portNumber);
+	hostLinks[portNumber].present = present;
+
+	return myXPLDevices.add(port, portNumber);
+}
+
+void hostLinkInput(int portNumber, const unsigned char* data, size_t size)
+{
+	hostLinks[portNumber].in = data;
+	hostLinks[portNumber].inSize = size;
+	hostLinks[portNumber].inPosition = 0;
+}
+
+void hostFlightLoop(float elapsed)
+{
+	elapsedTime += elapsed;
+
+	_processSerial();
+	if (reloadRequested) reloadDevices();
+	_applyInboundWrites();
+	_updateDataRefs(0);
+	_updateCommands();
+
+	cycleCount++;
+}
+
+/*
+	serialClass -- hSerial is the port's HostLink.  findDevices only finds ports the tool marked present.
+*/
+
+serialClass::serialClass()
+{
+	hSerial = NULL;
+	connected = false;
+	valid = 0;
+	strcpy(portName, "host");
+}
+
+serialClass::~serialClass()
+{
+}
+
+int serialClass::begin(int portNumber)
+{
+	if (portNumber < 0 || portNumber >= XPLHOST_PORTS || !hostLinks[portNumber].present) return -1;
+
+	hSerial = &hostLinks[portNumber];
+	connected = true;
+	snprintf(portName, sizeof(portName), "host%i", portNumber);
+	return portNumber;
+}
+
+int serialClass::shutDown(void)
+{
+	hSerial = NULL;
+	connected = false;
+	return 0;
+}
+
+int serialClass::findAvailablePort(void)
+{
+	return -1;
+}
+
+int serialClass::readData(char* buffer, size_t nbChar)
+{
+	HostLink* link = (HostLink*)hSerial;
+	size_t count;
+
+	if (!link || !link->in) return 0;
+
+	count = link->inSize - link->inPosition;
+	if (count > nbChar) count = nbChar;
+
+	memcpy(buffer, link->in + link->inPosition, count);
+	link->inPosition += count;
+	return (int)count;
+}
+
+bool serialClass::writeData(const char* buffer, size_t nbChar)
+{
+	HostLink* link = (HostLink*)hSerial;
+
+	if (!link) return false;
+
+	if (link->out) link->out->append(buffer, nbChar);
+	link->bytesOut += nbChar;
+	link->framesOut++;
+	return true;
+}
+
+bool serialClass::IsConnected(void)
+{
+	return connected;
+}
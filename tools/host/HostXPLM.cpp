@@ -0,0 +1,237 @@
+/*
+	HostXPLM -- the XPLM functions the plugin's core calls, served from datarefs and commands the host tool added.
+	See XPLProHost.h.
+
+	Created by the XPLPro contributors,  2026
+*/
+
+#include "XPLProHost.h"
+
+#include <string.h>
+#include <deque>
+#include <unordered_map>
+
+static std::deque<HostDataRef> hostDataRefs;		// a deque so the handles, pointers into it, stay put
+static std::deque<HostCommand> hostCommands;
+static std::unordered_map<std::string, HostDataRef*> hostDataRefNames;		// so finding one costs about what it does in X-Plane
+
+HostDataRef* hostAddDataRef(const char* name, XPLMDataTypeID type)
+{
+	HostDataRef* ref = hostFindDataRef(name);
+
+	if (!ref)
+	{
+		hostDataRefs.emplace_back();
+		ref = &hostDataRefs.back();
+		ref->name = name;
+		hostDataRefNames[ref->name] = ref;
+	}
+
+	ref->type = type;
+	for (int i = 0; i < XPLMAX_ELEMENTS; i++)
+	{
+		ref->i[i] = 0;
+		ref->f[i] = 0;
+	}
+	ref->d = 0;
+	ref->s.clear();
+	ref->writes = 0;
+
+	return ref;
+}
+
+HostDataRef* hostFindDataRef(const char* name)
+{
+	auto found = hostDataRefNames.find(name);
+
+	if (found == hostDataRefNames.end()) return NULL;
+	return found->second;
+}
+
+HostCommand* hostAddCommand(const char* name)
+{
+	for (size_t i = 0; i < hostCommands.size(); i++)
+		if (hostCommands[i].name == name) return &hostCommands[i];
+
+	hostCommands.emplace_back();
+	HostCommand* command = &hostCommands.back();
+	command->name = name;
+	command->begins = command->ends = command->onces = 0;
+	command->handlers = 0;
+
+	return command;
+}
+
+void hostClearXPLM(void)
+{
+	hostDataRefs.clear();
+	hostDataRefNames.clear();
+	hostCommands.clear();
+}
+
+/*
+	Datarefs
+*/
+
+XPLMDataRef XPLMFindDataRef(const char* inDataRefName)
+{
+	return hostFindDataRef(inDataRefName);
+}
+
+XPLMDataTypeID XPLMGetDataRefTypes(XPLMDataRef inDataRef)
+{
+	if (!inDataRef) return xplmType_Unknown;
+	return ((HostDataRef*)inDataRef)->type;
+}
+
+int XPLMGetDatai(XPLMDataRef inDataRef)
+{
+	if (!inDataRef) return 0;
+	return ((HostDataRef*)inDataRef)->i[0];
+}
+
+float XPLMGetDataf(XPLMDataRef inDataRef)
+{
+	if (!inDataRef) return 0;
+	return ((HostDataRef*)inDataRef)->f[0];
+}
+
+double XPLMGetDatad(XPLMDataRef inDataRef)
+{
+	if (!inDataRef) return 0;
+	return ((HostDataRef*)inDataRef)->d;
+}
+
+int XPLMGetDatavi(XPLMDataRef inDataRef, int* outValues, int inOffset, int inMax)
+{
+	HostDataRef* ref = (HostDataRef*)inDataRef;
+	int count;
+
+	if (!ref) return 0;
+	if (!outValues) return XPLMAX_ELEMENTS;
+	if (inOffset < 0 || inOffset >= XPLMAX_ELEMENTS) return 0;
+
+	count = XPLMAX_ELEMENTS - inOffset < inMax ? XPLMAX_ELEMENTS - inOffset : inMax;
+	memcpy(outValues, &ref->i[inOffset], count * sizeof(int));
+	return count;
+}
+
+int XPLMGetDatavf(XPLMDataRef inDataRef, float* outValues, int inOffset, int inMax)
+{
+	HostDataRef* ref = (HostDataRef*)inDataRef;
+	int count;
+
+	if (!ref) return 0;
+	if (!outValues) return XPLMAX_ELEMENTS;
+	if (inOffset < 0 || inOffset >= XPLMAX_ELEMENTS) return 0;
+
+	count = XPLMAX_ELEMENTS - inOffset < inMax ? XPLMAX_ELEMENTS - inOffset : inMax;
+	memcpy(outValues, &ref->f[inOffset], count * sizeof(float));
+	return count;
+}
+
+int XPLMGetDatab(XPLMDataRef inDataRef, void* outValue, int inOffset, int inMaxBytes)
+{
+	HostDataRef* ref = (HostDataRef*)inDataRef;
+	int count;
+
+	if (!ref) return 0;
+	if (!outValue) return (int)ref->s.size();
+	if (inOffset < 0 || inOffset >= (int)ref->s.size()) return 0;
+
+	count = (int)ref->s.size() - inOffset < inMaxBytes ? (int)ref->s.size() - inOffset : inMaxBytes;
+	memcpy(outValue, ref->s.data() + inOffset, count);
+	return count;
+}
+
+void XPLMSetDatai(XPLMDataRef inDataRef, int inValue)
+{
+	if (!inDataRef) return;
+	((HostDataRef*)inDataRef)->i[0] = inValue;
+	((HostDataRef*)inDataRef)->writes++;
+}
+
+void XPLMSetDataf(XPLMDataRef inDataRef, float inValue)
+{
+	if (!inDataRef) return;
+	((HostDataRef*)inDataRef)->f[0] = inValue;
+	((HostDataRef*)inDataRef)->writes++;
+}
+
+void XPLMSetDatad(XPLMDataRef inDataRef, double inValue)
+{
+	if (!inDataRef) return;
+	((HostDataRef*)inDataRef)->d = inValue;
+	((HostDataRef*)inDataRef)->writes++;
+}
+
+void XPLMSetDatavi(XPLMDataRef inDataRef, int* inValues, int inoffset, int inCount)
+{
+	HostDataRef* ref = (HostDataRef*)inDataRef;
+
+	if (!ref || inoffset < 0 || inCount < 0 || inoffset + inCount > XPLMAX_ELEMENTS) return;
+	memcpy(&ref->i[inoffset], inValues, inCount * sizeof(int));
+	ref->writes++;
+}
+
+void XPLMSetDatavf(XPLMDataRef inDataRef, float* inValues, int inoffset, int inCount)
+{
+	HostDataRef* ref = (HostDataRef*)inDataRef;
+
+	if (!ref || inoffset < 0 || inCount < 0 || inoffset + inCount > XPLMAX_ELEMENTS) return;
+	memcpy(&ref->f[inoffset], inValues, inCount * sizeof(float));
+	ref->writes++;
+}
+
+void XPLMUnregisterDataAccessor(XPLMDataRef inDataRef)
+{
+}
+
+/*
+	Commands
+*/
+
+XPLMCommandRef XPLMFindCommand(const char* inName)
+{
+	for (size_t i = 0; i < hostCommands.size(); i++)
+		if (hostCommands[i].name == inName) return &hostCommands[i];
+
+	return NULL;
+}
+
+void XPLMCommandBegin(XPLMCommandRef inCommand)
+{
+	if (inCommand) ((HostCommand*)inCommand)->begins++;
+}
+
+void XPLMCommandEnd(XPLMCommandRef inCommand)
+{
+	if (inCommand) ((HostCommand*)inCommand)->ends++;
+}
+
+void XPLMCommandOnce(XPLMCommandRef inCommand)
+{
+	if (inCommand) ((HostCommand*)inCommand)->onces++;
+}
+
+void XPLMRegisterCommandHandler(XPLMCommandRef inComand, XPLMCommandCallback_f inHandler, int inBefore, void* inRefcon)
+{
+	if (inComand) ((HostCommand*)inComand)->handlers++;
+}
+
+void XPLMUnregisterCommandHandler(XPLMCommandRef inComand, XPLMCommandCallback_f inHandler, int inBefore, void* inRefcon)
+{
+	if (inComand) ((HostCommand*)inComand)->handlers--;
+}
+
+/*
+	Utilities
+*/
+
+void XPLMDebugString(const char* inString)
+{
+}
+
+void XPLMSpeakString(const char* inString)
+{
+}
@@ -0,0 +1,75 @@
+#pragma once
+/*
+	XPLProHost -- runs the plugin's core (DataTransfer, XPLDevice, UpdateWorker, DeviceRegistry, TraceRecorder) on
+	Linux without X-Plane, for the fuzz target and the benchmarks in tools/.
+
+	HostXPLM.cpp stands in for the XPLM functions the core calls and serves datarefs and commands the tool adds
+	with hostAddDataRef / hostAddCommand.  HostPlatform.cpp has a serialClass that reads what a device sends from
+	a buffer of its port's HostLink and writes nowhere (or into a string), and the globals that XPLProPlugin.cpp and
+	StatusWindow.cpp have in the plugin.
+
+	Build with the other tools, for instance:
+		g++ -O2 -pthread -DLIN=1 -Itools/host -IXPLPro_Plugin_Source
+			-IXPLPro_Plugin_Source/SDK/CHeaders/XPLM -IXPLPro_Plugin_Source/SDK/CHeaders/Widgets
+			tools/<tool>.cpp tools/host/HostXPLM.cpp tools/host/HostPlatform.cpp
+			XPLPro_Plugin_Source/{DataTransfer,DeviceRegistry,XPLDevice,UpdateWorker,TraceRecorder,abbreviations}.cpp
+
+	Created by the XPLPro contributors,  2026
+*/
+
+#define XPLM200
+
+#include "XPLProCommon.h"
+
+#include "XPLMDataAccess.h"
+#include "XPLMUtilities.h"
+
+#include <string>
+
+#define XPLHOST_PORTS		256						// port numbers as findDevices goes through them, 1 to 255
+
+class XPLDevice;
+
+struct HostDataRef
+{
+	std::string		name;
+	XPLMDataTypeID	type;
+	int				i[XPLMAX_ELEMENTS];				// int and int array values
+	float			f[XPLMAX_ELEMENTS];				// float and float array values
+	double			d;
+	std::string		s;								// xplmType_Data
+	long			writes;							// XPLMSetData* calls
+};
+
+struct HostCommand
+{
+	std::string		name;
+	long			begins;
+	long			ends;
+	long			onces;
+	int				handlers;						// registered with XPLMRegisterCommandHandler
+};
+
+struct HostLink
+{
+	int						present;				// serialClass::begin finds the port, so findDevices would too
+	const unsigned char*	in;						// what the device sends, read by serialClass::readData
+	size_t					inSize;
+	size_t					inPosition;
+	std::string*			out;					// what the plugin sends, NULL to drop it
+	size_t					bytesOut;
+	long					framesOut;				// writeData calls, one per frame
+};
+
+extern HostLink hostLinks[XPLHOST_PORTS];
+
+HostDataRef* hostAddDataRef(const char* name, XPLMDataTypeID type);		// XPLMFindDataRef finds it from now on
+HostDataRef* hostFindDataRef(const char* name);							// NULL if not added
+HostCommand* hostAddCommand(const char* name);
+void hostClearXPLM(void);													// forget all datarefs and commands
+
+XPLDevice* hostAddDevice(int portNumber);		// device on the port in the registry, as if findDevices had found it
+void hostLinkInput(int portNumber, const unsigned char* data, size_t size);	// replaces what is left to read
+
+void hostFlightLoop(float elapsed);		// the flight loop's work as in MyFlightLoopCallback, without the phase timing
+										// and without waiting for the update worker, see updateWorkerWait
@@ -0,0 +1,79 @@
+#pragma once
+/*
+	windows.h -- the little of Win32 the plugin's core uses, so it builds on Linux for the host tools.  Only found
+	by the tools' builds (-Itools/host), the plugin itself is built on Windows as before.
+
+	Created by the XPLPro contributors,  2026
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef void*			HANDLE;
+typedef unsigned long	DWORD;
+typedef int				BOOL;
+typedef unsigned int	UINT;
+typedef long long		LONGLONG;
+
+typedef union
+{
+	struct
+	{
+		DWORD	LowPart;
+		long	HighPart;
+	} u;
+	LONGLONG	QuadPart;
+} LARGE_INTEGER;
+
+typedef struct
+{
+	DWORD	cbInQue;
+	DWORD	cbOutQue;
+} COMSTAT;
+
+inline BOOL QueryPerformanceFrequency(LARGE_INTEGER* frequency)
+{
+	frequency->QuadPart = 1000000000LL;						// clock_gettime in ns
+	return 1;
+}
+
+inline BOOL QueryPerformanceCounter(LARGE_INTEGER* counter)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	counter->QuadPart = (LONGLONG)now.tv_sec * 1000000000LL + now.tv_nsec;
+	return 1;
+}
+
+inline long InterlockedIncrement(long volatile* target)
+{
+	return __atomic_add_fetch(target, 1, __ATOMIC_SEQ_CST);
+}
+
+inline void Sleep(DWORD ms)
+{
+	usleep(ms * 1000);
+}
+
+inline int sprintf_s(char* buffer, size_t size, const char* format, ...)
+{
+	va_list args;
+	int result;
+
+	va_start(args, format);
+	result = vsnprintf(buffer, size, format, args);
+	va_end(args);
+	return result;
+}
+
+inline int fopen_s(FILE** file, const char* name, const char* mode)
+{
+	*file = fopen(name, mode);
+	return *file ? 0 : 1;
+}